@@ -59,15 +59,24 @@ inline void AtomicIncrement(volatile u32& target) {
 	__sync_add_and_fetch(&target, 1);
 }
 
+// Returns true if dest was expected, and is now value.  Full barrier.
+inline bool AtomicCompareAndSwap(volatile u32& dest, u32 expected, u32 value) {
+	return __sync_bool_compare_and_swap(&dest, expected, value);
+}
+
 inline u32 AtomicLoad(volatile u32& src) {
 	return src; // 32-bit reads are always atomic.
 }
 inline u32 AtomicLoadAcquire(volatile u32& src) {
 	//keep the compiler from caching any memory references
 	u32 result = src; // 32-bit reads are always atomic.
-	//__sync_synchronize(); // TODO: May not be necessary.
+#ifdef ARM
+	// ARM loads may be reordered, so this needs a real barrier.
+	__sync_synchronize();
+#else
 	// Compiler instruction only. x86 loads always have acquire semantics.
 	__asm__ __volatile__ ( "":::"memory" );
+#endif
 	return result;
 }
 
@@ -83,6 +92,9 @@ inline void AtomicStoreRelease(volatile u32& dest, u32 value) {
 	atomic_set(&dest, value);
 #elif defined(__SYMBIAN32__)
     g_atomic_int_set(&dest, value);
+#elif defined(ARM)
+	__sync_synchronize();
+	dest = value;
 #else
 	__sync_lock_test_and_set(&dest, value); // TODO: Wrong! This function is has acquire semantics.
 #endif
@@ -59,6 +59,11 @@ inline void AtomicDecrement(volatile u32& target) {
 	InterlockedDecrement((volatile LONG*)&target);
 }
 
+// Returns true if dest was expected, and is now value.  Full barrier.
+inline bool AtomicCompareAndSwap(volatile u32& dest, u32 expected, u32 value) {
+	return (u32)InterlockedCompareExchange((volatile LONG*)&dest, (LONG)value, (LONG)expected) == expected;
+}
+
 inline u32 AtomicLoad(volatile u32& src) {
 	return src; // 32-bit reads are always atomic.
 }
@@ -18,6 +18,7 @@
 #pragma once
 
 #ifdef _WIN32
+#include <intrin.h>
 #define SLEEP(x) Sleep(x)
 #else
 #include <unistd.h>
@@ -151,4 +152,27 @@ inline u64 swap64(u64 _data) {return bswap64(_data);}
 //inline u32 swap32(const u8* _pData) {return swap32(*(const u32*)_pData);}
 //inline u64 swap64(const u8* _pData) {return swap64(*(const u64*)_pData);}
 
+// Index of the lowest / highest set bit.  bits must not be 0.
+inline int LowestSetBit(u32 bits)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, bits);
+	return (int)index;
+#else
+	return __builtin_ctz(bits);
+#endif
+}
+
+inline int HighestSetBit(u32 bits)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse(&index, bits);
+	return (int)index;
+#else
+	return 31 - __builtin_clz(bits);
+#endif
+}
+
 }  // Namespace Common
@@ -0,0 +1,106 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+
+#ifndef _MPSC_QUEUE_H_
+#define _MPSC_QUEUE_H_
+
+#include "Atomic.h"
+
+namespace Common
+{
+
+// A bounded lockless queue: any number of threads may Push(), but only one may Pop().
+// Push() doesn't wait when it's full, it fails, so the caller needs a plan B.
+//
+// Each cell has a sequence number, which says whether it's free for the writer of a
+// given position, or holds a value for the reader (Dmitry Vyukov's bounded queue.)
+template <typename T, int N>
+class MPSCQueue
+{
+public:
+	MPSCQueue()
+	{
+		Clear();
+	}
+
+	bool Push(const T& t)
+	{
+		u32 pos = AtomicLoad(m_write_pos);
+		Cell *cell;
+		while (true)
+		{
+			cell = &m_cells[pos & (N - 1)];
+			const s32 diff = (s32)(AtomicLoadAcquire(cell->sequence) - pos);
+			// Free, but another writer may get there first.
+			if (diff == 0 && AtomicCompareAndSwap(m_write_pos, pos, pos + 1))
+				break;
+			// Still has the value from a lap ago, which hasn't been read yet.
+			if (diff < 0)
+				return false;
+			pos = AtomicLoad(m_write_pos);
+		}
+
+		cell->value = t;
+		AtomicStoreRelease(cell->sequence, pos + 1);
+		return true;
+	}
+
+	// Only from the reading thread.
+	bool Pop(T& t)
+	{
+		Cell *cell = &m_cells[m_read_pos & (N - 1)];
+		if (AtomicLoadAcquire(cell->sequence) != m_read_pos + 1)
+			return false;
+
+		t = cell->value;
+		// Free for the writer one lap later.
+		AtomicStoreRelease(cell->sequence, m_read_pos + N);
+		m_read_pos++;
+		return true;
+	}
+
+	// not thread-safe
+	void Clear()
+	{
+		for (u32 i = 0; i < N; ++i)
+			m_cells[i].sequence = i;
+		m_write_pos = 0;
+		m_read_pos = 0;
+	}
+
+private:
+	// Must be a power of two.
+	enum { SIZE_CHECK = 1 / ((N & (N - 1)) == 0 ? 1 : 0) };
+
+	struct Cell
+	{
+		volatile u32 sequence;
+		T value;
+	};
+
+	Cell m_cells[N];
+	// Keep the writers' counter off the reader's cache line.
+	u8 m_pad1[64];
+	volatile u32 m_write_pos;
+	u8 m_pad2[64];
+	u32 m_read_pos;
+};
+
+}
+
+#endif
@@ -30,6 +30,10 @@ bool DisassembleMov(const unsigned char *codePtr, InstructionInfo &info, int acc
 	info.signExtend = false;
 	info.hasImmediate = false;
 	info.isMemoryWrite = false;
+	info.isSSE = false;
+	info.otherReg = -1;
+	info.scaledReg = -1;
+	info.displacement = 0;
 
 	int addressSize = 8;
 	u8 modRMbyte = 0;
@@ -50,6 +54,11 @@ bool DisassembleMov(const unsigned char *codePtr, InstructionInfo &info, int acc
 		addressSize = 4;
 		codePtr++;
 	}
+	else if (*codePtr == 0xF3)
+	{
+		info.isSSE = true;
+		codePtr++;
+	}
 
 	//Check for REX prefix
 	if ((*codePtr & 0xF0) == 0x40)
@@ -132,7 +141,7 @@ bool DisassembleMov(const unsigned char *codePtr, InstructionInfo &info, int acc
 
 	if (displacementSize == 1)
 		info.displacement = (s32)(s8)*codePtr;
-	else
+	else if (displacementSize == 4)
 		info.displacement = *((s32 *)codePtr);
 	codePtr += displacementSize;
 
@@ -176,6 +185,15 @@ bool DisassembleMov(const unsigned char *codePtr, InstructionInfo &info, int acc
 		case MOVE_REG_TO_MEM: //move reg to memory
 			break;
 
+		case MOVE_REG8_TO_MEM: //move 8-bit reg to memory
+			info.operandSize = 1;
+			break;
+
+		case 0x0F:
+			if (info.isSSE && codeByte2 == MOVSS_TO_MEM)
+				break;
+			return false;
+
 		default:
 			PanicAlert("Unhandled disasm case in write handler!\n\nPlease implement or avoid.");
 			return false;
@@ -207,6 +225,10 @@ bool DisassembleMov(const unsigned char *codePtr, InstructionInfo &info, int acc
 				info.signExtend = true;
 				info.operandSize = 2;
 				break;
+			case MOVSS_FROM_MEM:
+				if (!info.isSSE)
+					return false;
+				break;
 			default:
 				return false;
 			}
@@ -31,6 +31,8 @@ struct InstructionInfo
 	bool signExtend;
 	bool hasImmediate;
 	bool isMemoryWrite;
+	// MOVSS, regOperandReg is an XMM register.
+	bool isSSE;
 	u64 immediate;
 	s32 displacement;
 };
@@ -54,6 +56,9 @@ enum{
 	MOVE_8BIT	    = 0xC6, //move 8-bit immediate
 	MOVE_16_32BIT   = 0xC7, //move 16 or 32-bit immediate
 	MOVE_REG_TO_MEM = 0x89, //move reg to memory
+	MOVE_REG8_TO_MEM = 0x88, //move 8-bit reg to memory
+	MOVSS_FROM_MEM  = 0x10, //movss xmm, m32 (with F3 prefix)
+	MOVSS_TO_MEM    = 0x11, //movss m32, xmm (with F3 prefix)
 };
 
 enum AccessType{
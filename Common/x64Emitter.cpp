@@ -511,6 +511,7 @@ void XEmitter::NOP(int count)
 } 
 
 void XEmitter::PAUSE() {Write8(0xF3); NOP();} //use in tight spinloops for energy saving on some cpu
+void XEmitter::RDTSC() {Write8(0x0F); Write8(0x31);}
 void XEmitter::CLC()  {Write8(0xF8);} //clear carry
 void XEmitter::CMC()  {Write8(0xF5);} //flip carry
 void XEmitter::STC()  {Write8(0xF9);} //set carry
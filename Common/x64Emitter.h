@@ -299,6 +299,9 @@ public:
 	// Save energy in wait-loops on P4 only. Probably not too useful.
 	void PAUSE();
 
+	// Time stamp counter into EDX:EAX.
+	void RDTSC();
+
 	// Flag control
 	void STC();
 	void CLC();
@@ -59,6 +59,12 @@ void CConfig::Load(const char *iniFileName)
 	cpu->Get("Jit", &bJit, true);
 	//FastMemory Default set back to True when solve UNIMPL _sceAtracGetContextAddress making game crash
 	cpu->Get("FastMemory", &bFastMemory, false);
+	cpu->Get("JitDiskCache", &bJitDiskCache, false);
+	cpu->Get("JitProfile", &bJitProfile, false);
+	cpu->Get("JitIR", &bJitIR, false);
+	cpu->Get("SyscallProfile", &bSyscallProfile, false);
+	cpu->Get("EventBatchCycles", &iEventBatchCycles, 0);
+	cpu->Get("StoreKnownFunctions", &bStoreKnownFunctions, false);
 
 	IniFile::Section *graphics = iniFile.GetOrCreateSection("Graphics");
 	graphics->Get("ShowFPSCounter", &bShowFPSCounter, false);
@@ -123,6 +129,12 @@ void CConfig::Save()
 		IniFile::Section *cpu = iniFile.GetOrCreateSection("CPU");
 		cpu->Set("Jit", bJit);
 		cpu->Set("FastMemory", bFastMemory);
+		cpu->Set("JitDiskCache", bJitDiskCache);
+		cpu->Set("JitProfile", bJitProfile);
+		cpu->Set("JitIR", bJitIR);
+		cpu->Set("SyscallProfile", bSyscallProfile);
+		cpu->Set("EventBatchCycles", iEventBatchCycles);
+		cpu->Set("StoreKnownFunctions", bStoreKnownFunctions);
 
 		IniFile::Section *graphics = iniFile.GetOrCreateSection("Graphics");
 		graphics->Set("ShowFPSCounter", bShowFPSCounter);
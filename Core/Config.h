@@ -49,6 +49,15 @@ public:
 	bool bIgnoreBadMemAccess;
 	bool bFastMemory;
 	bool bJit;
+	bool bJitDiskCache;
+	bool bJitProfile;
+	bool bJitIR;
+	// Count calls and time every syscall, per function, for WriteSyscallProfileReport().
+	bool bSyscallProfile;
+	// Events due within this many cycles of each other run together, in one slice.
+	int iEventBatchCycles;
+	// Add the named functions of modules with symbols to knownfuncs.dat, for naming them in other games.
+	bool bStoreKnownFunctions;
 
 	// GFX
 	bool bDisplayFramebuffer;
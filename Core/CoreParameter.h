@@ -23,6 +23,8 @@
 enum CPUCore {
 	CPU_INTERPRETER,
 	CPU_JIT,
+	CPU_IRINTERPRETER,
+	CPU_CACHEDINTERPRETER,
 };
 
 enum GPUCore {
@@ -35,7 +37,8 @@ struct CoreParameter
 {
 	// 0 = Interpreter
 	// 1 = Jit
-	// 2 = JitIL
+	// 2 = IR interpreter
+	// 3 = Cached interpreter
 	CPUCore cpuCore;
 	GPUCore gpuCore;
 	bool enableSound;  // there aren't multiple sound cores.
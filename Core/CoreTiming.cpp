@@ -17,11 +17,14 @@
 
 
 #include <vector>
+#include <map>
+#include <algorithm>
 #include <cstdio>
 
 #include "MsgHandler.h"
 #include "StdMutex.h"
 #include "Atomic.h"
+#include "MPSCQueue.h"
 #include "CoreTiming.h"
 #include "Core.h"
 #include "HLE/sceKernelThread.h"
@@ -32,6 +35,8 @@ int CPU_HZ = 222000000;
 // is this really necessary?
 #define INITIAL_SLICE_LENGTH 20000
 #define MAX_SLICE_LENGTH 100000000
+// With batching, slices with nothing due grow up to this.
+#define MAX_EMPTY_SLICE_LENGTH 1280000
 
 namespace CoreTiming
 {
@@ -57,16 +62,40 @@ struct BaseEvent
 //	Event *next;
 };
 
+// Threadsafe events go through a lockless ring, which the CPU thread drains in MoveEvents().
+// Should that fill up, the rest waits in a list behind externalEventSection.
+enum { TS_RING_SIZE = 1024 };
+Common::MPSCQueue<BaseEvent, TS_RING_SIZE> tsRing;
+
 typedef LinkedListItem<BaseEvent> Event;
 
-Event *first;
 Event *tsFirst;
 Event *tsLast;
+volatile u32 hasTsOverflow = false;
 
 // event pools
-Event *eventPool = 0;
 Event *eventTsPool = 0;
-int allocatedTsEvents = 0;
+
+typedef std::pair<int, u64> EventKey;
+typedef std::multimap<EventKey, int> EventKeyMap;
+
+// The main queue is a binary min-heap of slot numbers, ordered by time, so scheduling and
+// running events is O(log n).  Every event is also indexed by (type, userdata), so finding
+// the ones to remove doesn't need a walk over the queue either.
+struct QueuedEvent
+{
+	BaseEvent ev;
+	// Events at the same time run in the order they were scheduled.
+	u64 order;
+	int heapIndex;
+	EventKeyMap::iterator keyIter;
+};
+
+std::vector<QueuedEvent> eventSlots;
+std::vector<int> freeEventSlots;
+std::vector<int> eventHeap;
+EventKeyMap eventsByKey;
+u64 nextEventOrder;
 // Optimization to skip MoveEvents when possible.
 volatile u32 hasTsEvents = false;
 
@@ -77,6 +106,13 @@ int slicelength;
 s64 globalTimer;
 s64 idledCycles;
 
+static int eventBatchCycles = 0;
+// Only used when batching.  Grows while the queue stays empty.
+static int emptySliceLength = INITIAL_SLICE_LENGTH;
+static std::vector<int> batchSearch;
+static u64 numSlices;
+static u64 numEventsDispatched;
+
 static std::recursive_mutex externalEventSection;
 
 // Warning: not included in save state.
@@ -94,39 +130,106 @@ int GetClockFrequencyMHz()
 }
 
 
-Event* GetNewEvent()
+Event* GetNewTsEvent()
 {
-	if(!eventPool)
+	if(!eventTsPool)
 		return new Event;
 
-	Event* ev = eventPool;
-	eventPool = ev->next;
+	Event* ev = eventTsPool;
+	eventTsPool = ev->next;
 	return ev;
 }
 
-Event* GetNewTsEvent()
+void FreeTsEvent(Event* ev)
 {
-	allocatedTsEvents++;
+	ev->next = eventTsPool;
+	eventTsPool = ev;
+}
 
-	if(!eventTsPool)
-		return new Event;
+inline bool EventBefore(int slotA, int slotB)
+{
+	const QueuedEvent &a = eventSlots[slotA];
+	const QueuedEvent &b = eventSlots[slotB];
+	return a.ev.time < b.ev.time || (a.ev.time == b.ev.time && a.order < b.order);
+}
 
-	Event* ev = eventTsPool;
-	eventTsPool = ev->next;
-	return ev;
+inline void SetHeapSlot(int heapIndex, int slot)
+{
+	eventHeap[heapIndex] = slot;
+	eventSlots[slot].heapIndex = heapIndex;
 }
 
-void FreeEvent(Event* ev)
+void SiftUp(int heapIndex)
 {
-	ev->next = eventPool;
-	eventPool = ev;
+	const int slot = eventHeap[heapIndex];
+	while (heapIndex > 0)
+	{
+		const int parent = (heapIndex - 1) / 2;
+		if (!EventBefore(slot, eventHeap[parent]))
+			break;
+		SetHeapSlot(heapIndex, eventHeap[parent]);
+		heapIndex = parent;
+	}
+	SetHeapSlot(heapIndex, slot);
 }
 
-void FreeTsEvent(Event* ev)
+void SiftDown(int heapIndex)
 {
-	ev->next = eventTsPool;
-	eventTsPool = ev;
-	allocatedTsEvents--;
+	const int size = (int)eventHeap.size();
+	const int slot = eventHeap[heapIndex];
+	while (true)
+	{
+		int child = heapIndex * 2 + 1;
+		if (child >= size)
+			break;
+		if (child + 1 < size && EventBefore(eventHeap[child + 1], eventHeap[child]))
+			child++;
+		if (!EventBefore(eventHeap[child], slot))
+			break;
+		SetHeapSlot(heapIndex, eventHeap[child]);
+		heapIndex = child;
+	}
+	SetHeapSlot(heapIndex, slot);
+}
+
+// Takes the event out of the heap and the index, and frees its slot.
+void RemoveEventSlot(int slot)
+{
+	const int heapIndex = eventSlots[slot].heapIndex;
+	const int last = eventHeap.back();
+	eventHeap.pop_back();
+	if (last != slot)
+	{
+		SetHeapSlot(heapIndex, last);
+		if (heapIndex > 0 && EventBefore(last, eventHeap[(heapIndex - 1) / 2]))
+			SiftUp(heapIndex);
+		else
+			SiftDown(heapIndex);
+	}
+
+	eventsByKey.erase(eventSlots[slot].keyIter);
+	freeEventSlots.push_back(slot);
+}
+
+inline bool HasEvents()
+{
+	return !eventHeap.empty();
+}
+
+inline const BaseEvent &FirstEvent()
+{
+	return eventSlots[eventHeap[0]].ev;
+}
+
+// All pending events, in the order they'll run.
+void GetSortedEvents(std::vector<BaseEvent> &sorted)
+{
+	std::vector<int> slots = eventHeap;
+	std::sort(slots.begin(), slots.end(), EventBefore);
+	sorted.clear();
+	sorted.reserve(slots.size());
+	for (size_t i = 0; i < slots.size(); ++i)
+		sorted.push_back(eventSlots[slots[i]].ev);
 }
 
 int RegisterEvent(const char *name, TimedCallback callback)
@@ -151,7 +254,7 @@ void RestoreRegisterEvent(int event_type, const char *name, TimedCallback callba
 
 void UnregisterAllEvents()
 {
-	if (first)
+	if (HasEvents())
 		PanicAlert("Cannot unregister events with events pending");
 	event_types.clear();
 }
@@ -163,6 +266,12 @@ void Init()
 	globalTimer = 0;
 	idledCycles = 0;
 	hasTsEvents = 0;
+	hasTsOverflow = 0;
+	tsRing.Clear();
+	numSlices = 0;
+	numEventsDispatched = 0;
+	emptySliceLength = INITIAL_SLICE_LENGTH;
+	nextEventOrder = 0;
 }
 
 void Shutdown()
@@ -171,12 +280,10 @@ void Shutdown()
 	ClearPendingEvents();
 	UnregisterAllEvents();
 
-	while(eventPool)
-	{
-		Event *ev = eventPool;
-		eventPool = ev->next;
-		delete ev;
-	}
+	// Give the memory back, the queue can get large.
+	std::vector<QueuedEvent>().swap(eventSlots);
+	std::vector<int>().swap(freeEventSlots);
+	std::vector<int>().swap(eventHeap);
 
 	std::lock_guard<std::recursive_mutex> lk(externalEventSection);
 	while(eventTsPool)
@@ -202,17 +309,24 @@ u64 GetIdleTicks()
 // schedule things to be executed on the main thread.
 void ScheduleEvent_Threadsafe(s64 cyclesIntoFuture, int event_type, u64 userdata)
 {
-	std::lock_guard<std::recursive_mutex> lk(externalEventSection);
-	Event *ne = GetNewTsEvent();
-	ne->time = globalTimer + cyclesIntoFuture;
-	ne->type = event_type;
-	ne->next = 0;
-	ne->userdata = userdata;
-	if(!tsFirst)
-		tsFirst = ne;
-	if(tsLast)
-		tsLast->next = ne;
-	tsLast = ne;
+	BaseEvent ev;
+	ev.time = globalTimer + cyclesIntoFuture;
+	ev.type = event_type;
+	ev.userdata = userdata;
+
+	if (!tsRing.Push(ev))
+	{
+		std::lock_guard<std::recursive_mutex> lk(externalEventSection);
+		Event *ne = GetNewTsEvent();
+		*(BaseEvent *)ne = ev;
+		ne->next = 0;
+		if(!tsFirst)
+			tsFirst = ne;
+		if(tsLast)
+			tsLast->next = ne;
+		tsLast = ne;
+		Common::AtomicStoreRelease(hasTsOverflow, 1);
+	}
 
 	Common::AtomicStoreRelease(hasTsEvents, 1);
 }
@@ -232,30 +346,33 @@ void ScheduleEvent_Threadsafe_Immediate(int event_type, u64 userdata)
 
 void ClearPendingEvents()
 {
-	while (first)
-	{
-		Event *e = first->next;
-		FreeEvent(first);
-		first = e;
-	}
+	eventSlots.clear();
+	freeEventSlots.clear();
+	eventHeap.clear();
+	eventsByKey.clear();
 }
 
-void AddEventToQueue(Event* ne)
+void AddEventToQueue(const BaseEvent &ev)
 {
-	Event* prev = NULL;
-	Event** pNext = &first;
-	for(;;)
+	int slot;
+	if (freeEventSlots.empty())
 	{
-		Event*& next = *pNext;
-		if(!next || ne->time < next->time)
-		{
-			ne->next = next;
-			next = ne;
-			break;
-		}
-		prev = next;
-		pNext = &prev->next;
+		slot = (int)eventSlots.size();
+		eventSlots.push_back(QueuedEvent());
+	}
+	else
+	{
+		slot = freeEventSlots.back();
+		freeEventSlots.pop_back();
 	}
+
+	QueuedEvent &qe = eventSlots[slot];
+	qe.ev = ev;
+	qe.order = nextEventOrder++;
+	qe.keyIter = eventsByKey.insert(EventKeyMap::value_type(EventKey(ev.type, ev.userdata), slot));
+
+	eventHeap.push_back(slot);
+	SiftUp((int)eventHeap.size() - 1);
 }
 
 // This must be run ONLY from within the cpu thread
@@ -263,56 +380,44 @@ void AddEventToQueue(Event* ne)
 // than Advance 
 void ScheduleEvent(s64 cyclesIntoFuture, int event_type, u64 userdata)
 {
-	Event *ne = GetNewEvent();
-	ne->userdata = userdata;
-	ne->type = event_type;
-	ne->time = GetTicks() + cyclesIntoFuture;
+	BaseEvent ne;
+	ne.userdata = userdata;
+	ne.type = event_type;
+	ne.time = GetTicks() + cyclesIntoFuture;
 	AddEventToQueue(ne);
+
+	// Batched slices run longer, so don't let the current one run past it.
+	// Keeps GetTicks() the same.  Without batching, timing stays as it always was.
+	const s64 sliceEnd = globalTimer + slicelength;
+	emptySliceLength = INITIAL_SLICE_LENGTH;
+	if (eventBatchCycles != 0 && ne.time < sliceEnd)
+	{
+		const int cut = (int)(sliceEnd - ne.time);
+		slicelength -= cut;
+		currentMIPS->downcount -= cut;
+	}
 }
 
 // Returns cycles left in timer.
 u64 UnscheduleEvent(int event_type, u64 userdata)
 {
-	u64 result = 0;
-	if (!first)
-		return result;
-	while(first)
+	// If there are several, the latest one decides.
+	s64 latest = 0;
+	bool found = false;
+	EventKeyMap::iterator iter = eventsByKey.lower_bound(EventKey(event_type, userdata));
+	while (iter != eventsByKey.end() && iter->first == EventKey(event_type, userdata))
 	{
-		if (first->type == event_type && first->userdata == userdata)
-		{
-			result = first->time - globalTimer;
-
-			Event *next = first->next;
-			FreeEvent(first);
-			first = next;
-		}
-		else
-		{
-			break;
-		}
-	}
-	if (!first)
-		return result;
-	Event *prev = first;
-	Event *ptr = prev->next;
-	while (ptr)
-	{
-		if (ptr->type == event_type && ptr->userdata == userdata)
-		{
-			result = ptr->time - globalTimer;
-
-			prev->next = ptr->next;
-			FreeEvent(ptr);
-			ptr = prev->next;
-		}
-		else
-		{
-			prev = ptr;
-			ptr = ptr->next;
-		}
+		const int slot = iter->second;
+		++iter;
+		if (!found || eventSlots[slot].ev.time > latest)
+			latest = eventSlots[slot].ev.time;
+		found = true;
+		RemoveEventSlot(slot);
 	}
 
-	return result;
+	if (!found)
+		return 0;
+	return latest - globalTimer;
 }
 
 // Warning: not included in save state.
@@ -323,94 +428,27 @@ void RegisterAdvanceCallback(void (*callback)(int cyclesExecuted))
 
 bool IsScheduled(int event_type) 
 {
-	if (!first)
-		return false;
-	Event *e = first;
-	while (e) {
-		if (e->type == event_type)
-			return true;
-		e = e->next;
-	}
-	return false;
+	EventKeyMap::iterator iter = eventsByKey.lower_bound(EventKey(event_type, 0));
+	return iter != eventsByKey.end() && iter->first.first == event_type;
 }
 
 void RemoveEvent(int event_type)
 {
-	if (!first)
-		return;
-	while(first)
+	EventKeyMap::iterator iter = eventsByKey.lower_bound(EventKey(event_type, 0));
+	while (iter != eventsByKey.end() && iter->first.first == event_type)
 	{
-		if (first->type == event_type)
-		{
-			Event *next = first->next;
-			FreeEvent(first);
-			first = next;
-		}
-		else
-		{
-			break;
-		}
-	}
-	if (!first)
-		return;
-	Event *prev = first;
-	Event *ptr = prev->next;
-	while (ptr)
-	{
-		if (ptr->type == event_type)
-		{
-			prev->next = ptr->next;
-			FreeEvent(ptr);
-			ptr = prev->next;
-		}
-		else
-		{
-			prev = ptr;
-			ptr = ptr->next;
-		}
+		const int slot = iter->second;
+		++iter;
+		RemoveEventSlot(slot);
 	}
 }
 
+// CPU thread only, like RemoveEvent().
 void RemoveThreadsafeEvent(int event_type)
 {
-	std::lock_guard<std::recursive_mutex> lk(externalEventSection);
-	if (!tsFirst)
-	{
-		return;
-	}
-	while(tsFirst)
-	{
-		if (tsFirst->type == event_type)
-		{
-			Event *next = tsFirst->next;
-			FreeTsEvent(tsFirst);
-			tsFirst = next;
-		}
-		else
-		{
-			break;
-		}
-	}
-	if (!tsFirst)
-	{
-		return;
-	}
-	Event *prev = tsFirst;
-	Event *ptr = prev->next;
-	while (ptr)
-	{
-		if (ptr->type == event_type)
-		{	
-			prev->next = ptr->next;
-			FreeTsEvent(ptr);
-			ptr = prev->next;
-		}
-		else
-		{
-			prev = ptr;
-			ptr = ptr->next;
-		}
-	}
+	// Whatever is still on its way ends up in the main queue anyway.
+	MoveEvents();
+	RemoveEvent(event_type);
 }
 
 void RemoveAllEvents(int event_type)
@@ -422,16 +460,17 @@ void RemoveAllEvents(int event_type)
 //This raise only the events required while the fifo is processing data
 void ProcessFifoWaitEvents()
 {
-	while (first)
+	while (HasEvents())
 	{
-		if (first->time <= globalTimer)
+		if (FirstEvent().time <= globalTimer)
 		{
 //			LOG(CPU, "[Scheduler] %s		 (%lld, %lld) ", 
 //				first->name ? first->name : "?", (u64)globalTimer, (u64)first->time);
-			Event* evt = first;
-			first = first->next;
-			event_types[evt->type].callback(evt->userdata, (int)(globalTimer - evt->time));
-			FreeEvent(evt);
+			// The callback may well schedule more, so take it out first.
+			const BaseEvent evt = FirstEvent();
+			RemoveEventSlot(eventHeap[0]);
+			event_types[evt.type].callback(evt.userdata, (int)(globalTimer - evt.time));
+			numEventsDispatched++;
 		}
 		else
 		{
@@ -444,25 +483,60 @@ void MoveEvents()
 {
 	Common::AtomicStoreRelease(hasTsEvents, 0);
 
-	std::lock_guard<std::recursive_mutex> lk(externalEventSection);
-		// Move events from async queue into main queue
-	while (tsFirst)
+	// Move events from async queue into main queue
+	BaseEvent ev;
+	while (tsRing.Pop(ev))
+		AddEventToQueue(ev);
+
+	if (Common::AtomicLoadAcquire(hasTsOverflow))
 	{
-		Event *next = tsFirst->next;
-		AddEventToQueue(tsFirst);
-		tsFirst = next;
+		std::lock_guard<std::recursive_mutex> lk(externalEventSection);
+		Common::AtomicStoreRelease(hasTsOverflow, 0);
+		while (tsFirst)
+		{
+			Event *next = tsFirst->next;
+			AddEventToQueue(*tsFirst);
+			FreeTsEvent(tsFirst);
+			tsFirst = next;
+		}
+		tsLast = NULL;
 	}
-	tsLast = NULL;
+}
+
+void SetEventBatchCycles(int cycles)
+{
+	eventBatchCycles = cycles < 0 ? 0 : cycles;
+}
+
+void GetSliceStats(u64 &slices, u64 &eventsDispatched)
+{
+	slices = numSlices;
+	eventsDispatched = numEventsDispatched;
+}
 
-	// Move free events to threadsafe pool
-	while(allocatedTsEvents > 0 && eventPool)
+// The time of the last event due by limit.  Only subtrees of the heap with an early
+// enough root can have any, so this only looks at those events and their children.
+s64 LastEventBefore(s64 limit)
+{
+	s64 last = FirstEvent().time;
+	const int size = (int)eventHeap.size();
+	batchSearch.clear();
+	batchSearch.push_back(0);
+	while (!batchSearch.empty())
 	{
-		Event *ev = eventPool;
-		eventPool = ev->next;
-		ev->next = eventTsPool;
-		eventTsPool = ev;
-		allocatedTsEvents--;
+		const int heapIndex = batchSearch.back();
+		batchSearch.pop_back();
+		const s64 time = eventSlots[eventHeap[heapIndex]].ev.time;
+		if (time > limit)
+			continue;
+		if (time > last)
+			last = time;
+		if (heapIndex * 2 + 1 < size)
+			batchSearch.push_back(heapIndex * 2 + 1);
+		if (heapIndex * 2 + 2 < size)
+			batchSearch.push_back(heapIndex * 2 + 2);
 	}
+	return last;
 }
 
 void AdvanceQuick()
@@ -472,17 +546,30 @@ void AdvanceQuick()
 	currentMIPS->downcount = slicelength;
 
 	ProcessFifoWaitEvents();
+	numSlices++;
 
-	if (!first)
+	if (!HasEvents())
 	{
-		// WARN_LOG(CPU, "WARNING - no events in queue. Setting currentMIPS->downcount to 10000");
-		currentMIPS->downcount += 10000;
+		if (eventBatchCycles == 0)
+		{
+			// WARN_LOG(CPU, "WARNING - no events in queue. Setting currentMIPS->downcount to 10000");
+			currentMIPS->downcount += 10000;
+		}
+		else
+		{
+			// Nothing is due, so let each empty slice run twice as long as the last.
+			// Scheduling anything, threadsafe events included, starts it over.
+			slicelength = emptySliceLength;
+			currentMIPS->downcount = slicelength;
+			emptySliceLength = std::min(emptySliceLength * 2, MAX_EMPTY_SLICE_LENGTH);
+		}
 	}
 	else
 	{
-		slicelength = (int)(first->time - globalTimer);
-		if (slicelength > MAX_SLICE_LENGTH)
-			slicelength = MAX_SLICE_LENGTH;
+		s64 sliceEnd = FirstEvent().time;
+		if (eventBatchCycles != 0)
+			sliceEnd = LastEventBefore(sliceEnd + eventBatchCycles);
+		slicelength = (int)std::min(sliceEnd - globalTimer, (s64)MAX_SLICE_LENGTH);
 		currentMIPS->downcount = slicelength;
 	}
 	if (advanceCallback)
@@ -492,18 +579,21 @@ void AdvanceQuick()
 void Advance()
 {
 	if (Common::AtomicLoadAcquire(hasTsEvents))
+	{
 		MoveEvents();
+		emptySliceLength = INITIAL_SLICE_LENGTH;
+	}
 
 	AdvanceQuick();
 }
 
 void LogPendingEvents()
 {
-	Event *ptr = first;
-	while (ptr)
+	std::vector<BaseEvent> sorted;
+	GetSortedEvents(sorted);
+	for (size_t i = 0; i < sorted.size(); ++i)
 	{
-		//INFO_LOG(CPU, "PENDING: Now: %lld Pending: %lld Type: %d", globalTimer, ptr->time, ptr->type);
-		ptr = ptr->next;
+		//INFO_LOG(CPU, "PENDING: Now: %lld Pending: %lld Type: %d", globalTimer, sorted[i].time, sorted[i].type);
 	}
 }
 
@@ -513,10 +603,10 @@ void Idle(int maxIdle)
 	if (maxIdle != 0 && cyclesDown > maxIdle)
 		cyclesDown = maxIdle;
 
-	if (first && cyclesDown > 0)
+	if (HasEvents() && cyclesDown > 0)
 	{
 		int cyclesExecuted = slicelength - currentMIPS->downcount;
-		int cyclesNextEvent = (int) (first->time - globalTimer);
+		int cyclesNextEvent = (int) (FirstEvent().time - globalTimer);
 
 		if (cyclesNextEvent < cyclesExecuted + cyclesDown)
 		{
@@ -537,11 +627,13 @@ void Idle(int maxIdle)
 
 std::string GetScheduledEventsSummary()
 {
-	Event *ptr = first;
+	std::vector<BaseEvent> sorted;
+	GetSortedEvents(sorted);
 	std::string text = "Scheduled events\n";
 	text.reserve(1000);
-	while (ptr)
+	for (size_t i = 0; i < sorted.size(); ++i)
 	{
+		const BaseEvent *ptr = &sorted[i];
 		unsigned int t = ptr->type;
 		if (t >= event_types.size())
 			PanicAlert("Invalid event type"); // %i", t);
@@ -551,7 +643,6 @@ std::string GetScheduledEventsSummary()
 		char temp[512];
 		sprintf(temp, "%s : %i %08x%08x\n", name, (int)ptr->time, (u32)(ptr->userdata >> 32), (u32)(ptr->userdata));
 		text += temp;
-		ptr = ptr->next;
 	}
 	return text;
 }
@@ -561,8 +652,42 @@ void Event_DoState(PointerWrap &p, BaseEvent *ev)
 	p.Do(*ev);
 }
 
+// Same format as DoLinkedList() on the sorted list this used to be.
+void EventQueue_DoState(PointerWrap &p)
+{
+	if (p.mode == PointerWrap::MODE_READ)
+	{
+		ClearPendingEvents();
+		while (true)
+		{
+			u8 shouldExist = 0;
+			p.Do(shouldExist);
+			if (shouldExist != 1)
+				break;
+			BaseEvent ev;
+			Event_DoState(p, &ev);
+			AddEventToQueue(ev);
+		}
+	}
+	else
+	{
+		std::vector<BaseEvent> sorted;
+		GetSortedEvents(sorted);
+		for (size_t i = 0; i < sorted.size(); ++i)
+		{
+			u8 shouldExist = 1;
+			p.Do(shouldExist);
+			Event_DoState(p, &sorted[i]);
+		}
+		u8 shouldExist = 0;
+		p.Do(shouldExist);
+	}
+}
+
 void DoState(PointerWrap &p)
 {
+	// Anything in the ring is saved (and loaded) with the main queue.
+	MoveEvents();
 	std::lock_guard<std::recursive_mutex> lk(externalEventSection);
 
 	int n = (int) event_types.size();
@@ -570,8 +695,14 @@ void DoState(PointerWrap &p)
 	// These (should) be filled in later by the modules.
 	event_types.resize(n, EventType(AntiCrashCallback, "INVALID EVENT"));
 
-	p.DoLinkedList<BaseEvent, GetNewEvent, FreeEvent, Event_DoState>(first, (Event **) NULL);
+	EventQueue_DoState(p);
 	p.DoLinkedList<BaseEvent, GetNewTsEvent, FreeTsEvent, Event_DoState>(tsFirst, &tsLast);
+	// Older states may have some here, let MoveEvents() pick them up.
+	if (tsFirst)
+	{
+		Common::AtomicStoreRelease(hasTsOverflow, 1);
+		Common::AtomicStoreRelease(hasTsEvents, 1);
+	}
 
 	p.Do(CPU_HZ);
 	p.Do(slicelength);
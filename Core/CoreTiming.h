@@ -123,6 +123,12 @@ namespace CoreTiming
 	int GetClockFrequencyMHz();
 	extern int slicelength;
 
+	// Lets a slice run on past the next event, to also reach any others due within this many
+	// cycles, so they all run in one Advance().  They may run up to this many cycles late.
+	void SetEventBatchCycles(int cycles);
+	// Since Init(), for the debug stats.  Not in save states.
+	void GetSliceStats(u64 &slices, u64 &eventsDispatched);
+
 }; // end of namespace
 
 #endif
@@ -20,6 +20,8 @@
 #include "SymbolMap.h"
 #include "FixedSizeUnorderedSet.h"
 #include "../MIPS/JitCommon/JitCommon.h"
+#include "../MIPS/IR/IRInterpreter.h"
+#include "../MIPS/MIPSCachedInterpreter.h"
 #include <cstdio>
 
 #define MAX_BREAKPOINTS 16
@@ -135,6 +137,10 @@ void CBreakPoints::InvalidateJit(u32 _iAddress)
 	// Don't want to clear cache while running, I think?
 	if (MIPSComp::jit && Core_IsInactive())
 		MIPSComp::jit->ClearCacheAt(_iAddress);
+	if (MIPSComp::irInterpreter && Core_IsInactive())
+		MIPSComp::irInterpreter->ClearCacheAt(_iAddress);
+	if (MIPSComp::cachedInterpreter && Core_IsInactive())
+		MIPSComp::cachedInterpreter->ClearCacheAt(_iAddress);
 }
 
 void CBreakPoints::InvalidateJit()
@@ -142,6 +148,10 @@ void CBreakPoints::InvalidateJit()
 	// Don't want to clear cache while running, I think?
 	if (MIPSComp::jit && Core_IsInactive())
 		MIPSComp::jit->ClearCache();
+	if (MIPSComp::irInterpreter && Core_IsInactive())
+		MIPSComp::irInterpreter->ClearCache();
+	if (MIPSComp::cachedInterpreter && Core_IsInactive())
+		MIPSComp::cachedInterpreter->ClearCache();
 }
 
 int CBreakPoints::GetNumBreakpoints()
@@ -20,33 +20,179 @@ extern "C"
 #include "zlib.h"
 };
 
+#include "../../ext/snappy/snappy-c.h"
+
+#include "base/timeutil.h"
 #include "BlockDevices.h"
+#include "CommonFuncs.h"
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#elif !defined(__SYMBIAN32__)
+#include <sys/mman.h>
+#include <unistd.h>
+#define BLOCKDEVICE_USE_MMAP
+#endif
+
+BlockDeviceStats blockDeviceStats;
+
+bool BlockDevice::ReadBlocks(u32 minBlock, int count, u8 *outPtr)
+{
+	bool result = true;
+	for (int i = 0; i < count; ++i)
+		result = ReadBlock(minBlock + i, outPtr + i * GetBlockSize()) && result;
+	return result;
+}
+
 FileBlockDevice::FileBlockDevice(std::string _filename)
-: filename(_filename)
+: filename(_filename), mapped(NULL), nextBlock(0), sequentialReads(0), advisedUntil(0)
 {
+#ifdef _WIN32
+	mappingHandle = NULL;
+#endif
 	f = fopen(_filename.c_str(), "rb");
-	fseek(f,0,SEEK_END);
-	filesize = ftell(f);
-	fseek(f,0,SEEK_SET);
+	fseeko(f,0,SEEK_END);
+	filesize = ftello(f);
+	fseeko(f,0,SEEK_SET);
+	MapFile();
 }
 
 FileBlockDevice::~FileBlockDevice()
 {
+	UnmapFile();
 	fclose(f);
 }
 
+void FileBlockDevice::MapFile()
+{
+	// Don't bother trying if it can't fit in the address space anyway.
+	if (filesize == 0 || filesize != (u64)(size_t)filesize)
+		return;
+
+#ifdef _WIN32
+	HANDLE file = (HANDLE)_get_osfhandle(_fileno(f));
+	mappingHandle = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle != NULL)
+	{
+		mapped = (const u8 *)MapViewOfFile((HANDLE)mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if (mapped == NULL)
+		{
+			CloseHandle((HANDLE)mappingHandle);
+			mappingHandle = NULL;
+		}
+	}
+#elif defined(BLOCKDEVICE_USE_MMAP)
+	void *ptr = mmap(NULL, (size_t)filesize, PROT_READ, MAP_SHARED, fileno(f), 0);
+	if (ptr != MAP_FAILED)
+		mapped = (const u8 *)ptr;
+#endif
+
+	if (mapped == NULL)
+		INFO_LOG(LOADER, "Could not map %s, reading it through stdio instead", filename.c_str());
+}
+
+void FileBlockDevice::UnmapFile()
+{
+	if (mapped == NULL)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile((LPCVOID)mapped);
+	CloseHandle((HANDLE)mappingHandle);
+	mappingHandle = NULL;
+#elif defined(BLOCKDEVICE_USE_MMAP)
+	munmap((void *)mapped, (size_t)filesize);
+#endif
+	mapped = NULL;
+}
+
+void FileBlockDevice::AdviseRead(u32 minBlock, int count)
+{
+	if (minBlock == nextBlock)
+		++sequentialReads;
+	else
+	{
+		sequentialReads = 0;
+		advisedUntil = 0;
+	}
+	nextBlock = minBlock + count;
+
+#if defined(BLOCKDEVICE_USE_MMAP) && defined(MADV_WILLNEED)
+	// After a few reads in a row, have the kernel fetch the next stretch while we're busy.
+	// Only once the reads get halfway into what was already asked for, not every read.
+	static const u64 READ_AHEAD_BYTES = 512 * 1024;
+	if (sequentialReads >= 2)
+	{
+		static const u64 pageMask = ~(u64)(sysconf(_SC_PAGESIZE) - 1);
+		u64 start = ((u64)nextBlock * GetBlockSize()) & pageMask;
+		u64 end = std::min(start + READ_AHEAD_BYTES, filesize);
+		if (start + READ_AHEAD_BYTES / 2 > advisedUntil && start < end && advisedUntil < end)
+		{
+			start = std::max(start, advisedUntil);
+			madvise((void *)(mapped + start), (size_t)(end - start), MADV_WILLNEED);
+			advisedUntil = end;
+		}
+	}
+#endif
+}
+
+void FileBlockDevice::CopyMapped(u64 pos, size_t bytes, u8 *outPtr)
+{
+	size_t avail = 0;
+	if (pos < filesize)
+		avail = filesize - pos < bytes ? (size_t)(filesize - pos) : bytes;
+	if (avail != 0)
+		memcpy(outPtr, mapped + pos, avail);
+	if (avail != bytes)
+	{
+		DEBUG_LOG(LOADER, "Could not read %d bytes at %lld", (int)bytes, (long long)pos);
+		memset(outPtr + avail, 0, bytes - avail);
+	}
+}
+
 bool FileBlockDevice::ReadBlock(int blockNumber, u8 *outPtr) 
 {
-	fseek(f, blockNumber * GetBlockSize(), SEEK_SET);
+	if (mapped != NULL)
+	{
+		AdviseRead((u32)blockNumber, 1);
+		CopyMapped((u64)(u32)blockNumber * GetBlockSize(), 2048, outPtr);
+		return true;
+	}
+
+	fseeko(f, (u64)(u32)blockNumber * GetBlockSize(), SEEK_SET);
 	if(fread(outPtr, 1, 2048, f) != 2048)
 		DEBUG_LOG(LOADER, "Could not read 2048 bytes from block");
 
 	return true;
 }
 
+bool FileBlockDevice::ReadBlocks(u32 minBlock, int count, u8 *outPtr)
+{
+	// Blocks are stored as-is, so this is just one big read.
+	const size_t bytes = (size_t)count * GetBlockSize();
+	if (mapped != NULL)
+	{
+		AdviseRead(minBlock, count);
+		CopyMapped((u64)minBlock * GetBlockSize(), bytes, outPtr);
+		return (u64)minBlock * GetBlockSize() + bytes <= filesize;
+	}
+
+	fseeko(f, (u64)minBlock * GetBlockSize(), SEEK_SET);
+	size_t readBytes = fread(outPtr, 1, bytes, f);
+	if (readBytes != bytes)
+	{
+		DEBUG_LOG(LOADER, "Could not read %d blocks from block %d", count, minBlock);
+		memset(outPtr + readBytes, 0, bytes - readBytes);
+		return false;
+	}
+
+	return true;
+}
+
 // .CSO format
 
 // complessed ISO(9660) header format
@@ -75,12 +221,27 @@ typedef struct ciso_header
 
 // TODO: Need much better error handling.
 
+// Decompressed blocks kept per CSO (512 KB.)
+static const int CISO_CACHE_BLOCKS = 256;
+// Longer runs are streaming reads (videos, etc.) which would only flush the cache.
+static const int CISO_CACHE_MAX_RUN = CISO_CACHE_BLOCKS / 4;
+static const u32 CISO_CACHE_EMPTY = 0xFFFFFFFF;
+// Once reads are sequential, this many chunks past the read are inflated in the background.
+static const u32 CISO_PREFETCH_CHUNK_BLOCKS = 16;
+static const u32 CISO_PREFETCH_CHUNKS = 4;
+static const int CISO_PREFETCH_THREADS = 2;
+// Room for the chunks being read plus the ones prefetched past them.
+static const u32 CISO_STREAM_CHUNKS = CISO_PREFETCH_CHUNKS * 2;
+// Reads starting this close to where the last one ended still count as sequential.
+// Odd sized reads often start again in the sector the last one ended in.
+static const u32 CISO_SEQUENTIAL_SLACK = 4;
+
 CISOFileBlockDevice::CISOFileBlockDevice(std::string _filename)
-: filename(_filename)
+: filename(_filename), cacheTick(0), nextReadBlock(CISO_CACHE_EMPTY), prefetchExit(false)
 {
 	// CISO format is EXTREMELY crappy and incomplete. All tools make broken CISO.
 
-	f = fopen(_filename.c_str(), "rb");
+	FILE *f = fopen(_filename.c_str(), "rb");
 	CISO_H hdr;
 	size_t readSize = fread(&hdr, sizeof(CISO_H), 1, f);
 	if (readSize != 1 || memcmp(hdr.magic, "CISO", 4) != 0)
@@ -113,14 +274,253 @@ CISOFileBlockDevice::CISOFileBlockDevice(std::string _filename)
 	index = new u32[indexSize];
 	if(fread(index, sizeof(u32), indexSize, f) != indexSize)
 		memset(index, 0, indexSize * sizeof(u32));
+
+	InitReader(reader, f);
+
+	cacheData.resize(CISO_CACHE_BLOCKS * 2048);
+	cacheBlocks.resize(CISO_CACHE_BLOCKS, CISO_CACHE_EMPTY);
+	cacheLastUsed.resize(CISO_CACHE_BLOCKS, 0);
+
+	if (reader.zstream != NULL && numBlocks != 0)
+	{
+		streamChunks.resize(CISO_STREAM_CHUNKS);
+		for (size_t i = 0; i < streamChunks.size(); ++i)
+		{
+			streamChunks[i].chunk = CISO_CACHE_EMPTY;
+			streamChunks[i].lastUsed = 0;
+			streamChunks[i].data.resize(CISO_PREFETCH_CHUNK_BLOCKS * 2048);
+			streamChunks[i].blockOk.resize(CISO_PREFETCH_CHUNK_BLOCKS, 0);
+		}
+		for (int i = 0; i < CISO_PREFETCH_THREADS; ++i)
+			prefetchThreads.push_back(new std::thread(&CISOFileBlockDevice::PrefetchThread, this));
+	}
 }
 
 CISOFileBlockDevice::~CISOFileBlockDevice()
 {
-	fclose(f);
+	{
+		std::lock_guard<std::mutex> guard(prefetchLock);
+		prefetchExit = true;
+		prefetchWake.notify_all();
+	}
+	for (size_t i = 0; i < prefetchThreads.size(); ++i)
+	{
+		prefetchThreads[i]->join();
+		delete prefetchThreads[i];
+	}
+
+	ShutdownReader(reader);
 	delete [] index;
 }
 
+void CISOFileBlockDevice::InitReader(Reader &r, FILE *f)
+{
+	r.f = f;
+	r.zstream = new z_stream;
+	r.zstream->zalloc = Z_NULL;
+	r.zstream->zfree = Z_NULL;
+	r.zstream->opaque = Z_NULL;
+	if (inflateInit2(r.zstream, -15) != Z_OK)
+	{
+		ERROR_LOG(LOADER, "inflateInit ERROR : %s", r.zstream->msg ? r.zstream->msg : "???");
+		delete r.zstream;
+		r.zstream = NULL;
+	}
+}
+
+void CISOFileBlockDevice::ShutdownReader(Reader &r)
+{
+	if (r.zstream != NULL)
+	{
+		inflateEnd(r.zstream);
+		delete r.zstream;
+		r.zstream = NULL;
+	}
+	if (r.f != NULL)
+		fclose(r.f);
+	r.f = NULL;
+}
+
+bool CISOFileBlockDevice::IsCached(u32 blockNumber)
+{
+	std::lock_guard<std::mutex> guard(cacheLock);
+	return cacheSlots.find(blockNumber) != cacheSlots.end() || FindStreamChunk(blockNumber) != -1;
+}
+
+bool CISOFileBlockDevice::CopyCachedBlock(u32 blockNumber, u8 *outPtr)
+{
+	std::lock_guard<std::mutex> guard(cacheLock);
+	std::map<u32, int>::iterator it = cacheSlots.find(blockNumber);
+	if (it != cacheSlots.end())
+	{
+		cacheLastUsed[it->second] = ++cacheTick;
+		memcpy(outPtr, &cacheData[it->second * 2048], 2048);
+		return true;
+	}
+
+	int slot = FindStreamChunk(blockNumber);
+	if (slot == -1)
+		return false;
+	StreamChunk &stream = streamChunks[slot];
+	stream.lastUsed = ++cacheTick;
+	memcpy(outPtr, &stream.data[(blockNumber % CISO_PREFETCH_CHUNK_BLOCKS) * 2048], 2048);
+	return true;
+}
+
+// The stream chunk holding a good copy of the block, or -1.  Needs cacheLock.
+int CISOFileBlockDevice::FindStreamChunk(u32 blockNumber)
+{
+	const u32 chunk = blockNumber / CISO_PREFETCH_CHUNK_BLOCKS;
+	for (size_t i = 0; i < streamChunks.size(); ++i)
+	{
+		if (streamChunks[i].chunk == chunk && streamChunks[i].blockOk[blockNumber % CISO_PREFETCH_CHUNK_BLOCKS])
+			return (int)i;
+	}
+	return -1;
+}
+
+void CISOFileBlockDevice::StoreStreamChunk(u32 chunk, const u8 *data, const std::vector<u8> &blockOk)
+{
+	std::lock_guard<std::mutex> guard(cacheLock);
+	// Replaces the chunk read longest ago.  The newly stored ones haven't been read yet, so they stay.
+	int slot = 0;
+	for (int i = 1; i < (int)streamChunks.size(); ++i)
+	{
+		if (streamChunks[i].lastUsed < streamChunks[slot].lastUsed)
+			slot = i;
+	}
+
+	StreamChunk &stream = streamChunks[slot];
+	stream.chunk = chunk;
+	stream.lastUsed = ++cacheTick;
+	memcpy(&stream.data[0], data, blockOk.size() * 2048);
+	std::fill(stream.blockOk.begin(), stream.blockOk.end(), 0);
+	std::copy(blockOk.begin(), blockOk.end(), stream.blockOk.begin());
+}
+
+void CISOFileBlockDevice::CacheBlock(u32 blockNumber, const u8 *data)
+{
+	std::lock_guard<std::mutex> guard(cacheLock);
+	std::map<u32, int>::iterator it = cacheSlots.find(blockNumber);
+	if (it != cacheSlots.end())
+	{
+		cacheLastUsed[it->second] = ++cacheTick;
+		return;
+	}
+
+	// Just a linear search for the oldest, it's nothing next to inflating a block.
+	int slot = 0;
+	for (int i = 1; i < CISO_CACHE_BLOCKS; ++i)
+	{
+		if (cacheLastUsed[i] < cacheLastUsed[slot])
+			slot = i;
+	}
+
+	if (cacheBlocks[slot] != CISO_CACHE_EMPTY)
+		cacheSlots.erase(cacheBlocks[slot]);
+	cacheBlocks[slot] = blockNumber;
+	cacheLastUsed[slot] = ++cacheTick;
+	cacheSlots[blockNumber] = slot;
+	memcpy(&cacheData[slot * 2048], data, 2048);
+}
+
+void CISOFileBlockDevice::QueuePrefetch(u32 nextBlock)
+{
+	std::lock_guard<std::mutex> guard(prefetchLock);
+	const u32 firstChunk = nextBlock / CISO_PREFETCH_CHUNK_BLOCKS;
+	for (u32 chunk = firstChunk; chunk < firstChunk + CISO_PREFETCH_CHUNKS; ++chunk)
+	{
+		const u32 minBlock = chunk * CISO_PREFETCH_CHUNK_BLOCKS;
+		if (minBlock >= numBlocks)
+			break;
+		if (pendingChunks.find(chunk) != pendingChunks.end() || activeChunks.find(chunk) != activeChunks.end())
+			continue;
+		const u32 lastBlock = std::min(minBlock + CISO_PREFETCH_CHUNK_BLOCKS, numBlocks) - 1;
+		if (IsCached(minBlock) && IsCached(lastBlock))
+			continue;
+
+		pendingChunks.insert(chunk);
+		prefetchQueue.push_back(chunk);
+		prefetchWake.notify_one();
+	}
+}
+
+void CISOFileBlockDevice::CancelPrefetch()
+{
+	// Chunks already being inflated just finish, the rest are skipped.
+	std::lock_guard<std::mutex> guard(prefetchLock);
+	pendingChunks.clear();
+	prefetchQueue.clear();
+}
+
+bool CISOFileBlockDevice::WaitForPrefetch(u32 minBlock, int count)
+{
+	bool waited = false;
+	std::unique_lock<std::mutex> guard(prefetchLock);
+	const u32 lastChunk = (minBlock + count - 1) / CISO_PREFETCH_CHUNK_BLOCKS;
+	for (u32 chunk = minBlock / CISO_PREFETCH_CHUNK_BLOCKS; chunk <= lastChunk; ++chunk)
+	{
+		// Not started yet, we're about to read it anyway.
+		if (pendingChunks.erase(chunk) != 0)
+			continue;
+		while (activeChunks.find(chunk) != activeChunks.end())
+		{
+			prefetchDone.wait(guard);
+			waited = true;
+		}
+	}
+	return waited;
+}
+
+void CISOFileBlockDevice::PrefetchThread(CISOFileBlockDevice *device)
+{
+	device->RunPrefetch();
+}
+
+void CISOFileBlockDevice::RunPrefetch()
+{
+	// Each thread needs its own file position and zlib state.
+	Reader r;
+	InitReader(r, fopen(filename.c_str(), "rb"));
+	if (r.f == NULL || r.zstream == NULL)
+	{
+		ERROR_LOG(LOADER, "Unable to start CSO prefetch for %s", filename.c_str());
+		ShutdownReader(r);
+		return;
+	}
+
+	std::vector<u8> buffer(CISO_PREFETCH_CHUNK_BLOCKS * 2048);
+	std::unique_lock<std::mutex> guard(prefetchLock);
+	while (!prefetchExit)
+	{
+		if (prefetchQueue.empty())
+		{
+			prefetchWake.wait(guard);
+			continue;
+		}
+
+		const u32 chunk = prefetchQueue.front();
+		prefetchQueue.pop_front();
+		// Cancelled, or the emu thread got to it first.
+		if (pendingChunks.erase(chunk) == 0)
+			continue;
+		activeChunks.insert(chunk);
+		guard.unlock();
+
+		const u32 minBlock = chunk * CISO_PREFETCH_CHUNK_BLOCKS;
+		const int count = (int)std::min(CISO_PREFETCH_CHUNK_BLOCKS, numBlocks - minBlock);
+		ReadUncached(r, minBlock, count, &buffer[0]);
+		StoreStreamChunk(chunk, &buffer[0], r.blockOk);
+
+		guard.lock();
+		activeChunks.erase(chunk);
+		prefetchDone.notify_all();
+	}
+
+	guard.unlock();
+	ShutdownReader(r);
+}
+
 bool CISOFileBlockDevice::ReadBlock(int blockNumber, u8 *outPtr) 
 {
 	if ((u32)blockNumber >= numBlocks)
@@ -129,59 +529,367 @@ bool CISOFileBlockDevice::ReadBlock(int blockNumber, u8 *outPtr)
 		return false;
 	}
 
-	u32 idx = index[blockNumber];
-	u32 idx2 = index[blockNumber+1];
-	u8 inbuffer[4096]; //too big
-	z_stream z;
+	return ReadBlocks(blockNumber, 1, outPtr);
+}
+
+bool CISOFileBlockDevice::ReadBlocks(u32 minBlock, int count, u8 *outPtr)
+{
+	if (count <= 0)
+		return true;
+	if (minBlock >= numBlocks || (u32)count > numBlocks - minBlock)
+		return BlockDevice::ReadBlocks(minBlock, count, outPtr);
+
+	// Streaming (movies, music, etc.)  Get the next blocks inflating while the game uses these.
+	const bool sequential = nextReadBlock != CISO_CACHE_EMPTY && minBlock + CISO_SEQUENTIAL_SLACK >= nextReadBlock && minBlock <= nextReadBlock + CISO_SEQUENTIAL_SLACK;
+	nextReadBlock = minBlock + count;
+	if (!prefetchThreads.empty())
+	{
+		if (sequential)
+			QueuePrefetch(nextReadBlock);
+		else
+			CancelPrefetch();
+	}
+
+	bool result = true;
+	int i = 0;
+	while (i < count)
+	{
+		if (CopyCachedBlock(minBlock + i, outPtr + i * 2048))
+		{
+			blockDeviceStats.cacheHits++;
+			++i;
+			continue;
+		}
+
+		// Read the whole run of uncached blocks at once.
+		int end = i + 1;
+		while (end < count && !IsCached(minBlock + end))
+			++end;
+
+		const int run = end - i;
+		// If it's being inflated in the background, wait for it rather than doing it twice.
+		if (!prefetchThreads.empty() && WaitForPrefetch(minBlock + i, run))
+			continue;
+
+		blockDeviceStats.cacheMisses += run;
+		time_update();
+		const double startTime = time_now_d();
+		result = ReadUncached(reader, minBlock + i, run, outPtr + i * 2048) && result;
+		time_update();
+		blockDeviceStats.decompressTime += time_now_d() - startTime;
+
+		if (run <= CISO_CACHE_MAX_RUN)
+		{
+			for (int j = i; j < end; ++j)
+			{
+				if (reader.blockOk[j - i])
+					CacheBlock(minBlock + j, outPtr + j * 2048);
+			}
+		}
+		i = end;
+	}
+	return result;
+}
 
-	int plain = idx & 0x80000000;
+bool CISOFileBlockDevice::ReadUncached(Reader &r, u32 minBlock, int count, u8 *outPtr)
+{
+	// The compressed blocks are contiguous in the file, so read them all at once.
+	const u64 firstPos = (u64)(index[minBlock] & 0x7FFFFFFF) << indexShift;
+	const u64 lastPos = (u64)(index[minBlock + count] & 0x7FFFFFFF) << indexShift;
+	r.blockOk.assign(count, 0);
+	if (lastPos < firstPos)
+	{
+		memset(outPtr, 0, count * 2048);
+		return false;
+	}
 
-	idx = (idx & 0x7FFFFFFF) << indexShift;
-	idx2 = (idx2 & 0x7FFFFFFF) << indexShift;
+	r.readBuffer.resize((size_t)(lastPos - firstPos));
+	fseeko(r.f, firstPos, SEEK_SET);
+	const u64 readSize = r.readBuffer.empty() ? 0 : fread(&r.readBuffer[0], 1, r.readBuffer.size(), r.f);
 
-	u32 compressedReadPos = idx;
-	u32 compressedReadSize = idx2 - idx;
+	bool result = true;
+	for (int i = 0; i < count; ++i)
+	{
+		const u32 idx = index[minBlock + i];
+		const bool plain = (idx & 0x80000000) != 0;
+		u64 start = ((u64)(idx & 0x7FFFFFFF) << indexShift) - firstPos;
+		u64 end = ((u64)(index[minBlock + i + 1] & 0x7FFFFFFF) << indexShift) - firstPos;
+		// Short read or a broken index, just hand over what we have.
+		if (end > readSize)
+			end = readSize;
+		if (start > end)
+			start = end;
 
-	fseek(f, compressedReadPos, SEEK_SET);
-	u32 readSize = (u32)fread(inbuffer, 1, compressedReadSize, f);
+		const u8 *inPtr = r.readBuffer.empty() ? NULL : &r.readBuffer[0] + start;
+		r.blockOk[i] = DecompressBlock(r, minBlock + i, inPtr, (u32)(end - start), plain, outPtr + i * GetBlockSize());
+		result = r.blockOk[i] && result;
+	}
+	return result;
+}
 
+bool CISOFileBlockDevice::DecompressBlock(Reader &r, int blockNumber, const u8 *inPtr, u32 inSize, bool plain, u8 *outPtr)
+{
+	memset(outPtr, 0, 2048);
 	if (plain)
 	{
-		memset(outPtr, 0, 2048);
-		memcpy(outPtr, inbuffer, readSize);
+		memcpy(outPtr, inPtr, inSize > 2048 ? 2048 : inSize);
+		// Short means the file or index is broken, at least don't pretend it's all there.
+		return inSize >= 2048;
 	}
-	else
+
+	if (r.zstream == NULL)
+		return false;
+
+	z_stream &z = *r.zstream;
+	inflateReset(&z);
+	z.avail_in = inSize;
+	z.next_out = outPtr;
+	z.avail_out = blockSize;
+	z.next_in = (u8 *)inPtr;
+
+	int status = inflate(&z, Z_FULL_FLUSH);
+	if(status != Z_STREAM_END)
+		//if (status != Z_OK)
 	{
-		memset(outPtr, 0, 2048);
-		z.zalloc = Z_NULL;
-		z.zfree = Z_NULL;
-		z.opaque = Z_NULL;
-		if(inflateInit2(&z, -15) != Z_OK)
+		ERROR_LOG(LOADER, "block %d:inflate : %s[%d]\n", blockNumber, (z.msg) ? z.msg : "error", status);
+		return false;
+	}
+	int cmp_size = blockSize - z.avail_out;
+	if (cmp_size != (int)blockSize)
+	{
+		ERROR_LOG(LOADER, "block %d : block size error %d != %d\n", blockNumber, cmp_size, blockSize);
+		return false;
+	}
+	return true;
+}
+
+PSZFileBlockDevice::PSZFileBlockDevice(std::string _filename)
+: filename(_filename), numSectors(0), zstream(NULL), decodedTick(0)
+{
+	memset(&header, 0, sizeof(header));
+	for (int i = 0; i < DECODED_CACHE_SIZE; ++i)
+	{
+		decodedBlock[i] = 0xFFFFFFFF;
+		decodedLastUsed[i] = 0;
+	}
+
+	f = fopen(_filename.c_str(), "rb");
+	if (f == NULL || fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, "PSZI", 4) != 0)
+	{
+		ERROR_LOG(LOADER, "Invalid PSZ image: %s", filename.c_str());
+		header.numBlocks = 0;
+		return;
+	}
+	if (header.version > PSZ_VERSION)
+		ERROR_LOG(LOADER, "PSZ version %d too high!", header.version);
+	// Other sizes would still work, but the reader relies on a power of 2 multiple of sectors.
+	if (header.blockSize < PSZ_MIN_BLOCK_SIZE || header.blockSize > PSZ_MAX_BLOCK_SIZE || (header.blockSize & (header.blockSize - 1)) != 0)
+	{
+		ERROR_LOG(LOADER, "PSZ unsupported block size %d", header.blockSize);
+		header.numBlocks = 0;
+		return;
+	}
+
+	// The header is trusted for sizes below, so check it adds up before allocating anything.
+	fseeko(f, 0, SEEK_END);
+	const u64 fileSize = ftello(f);
+	const u64 expectedBlocks = (header.totalBytes + header.blockSize - 1) / header.blockSize;
+	if (header.totalBytes / 2048 > 0xFFFFFFFF || header.numBlocks != expectedBlocks
+		|| header.headerSize > fileSize || ((u64)header.numBlocks + 1) * sizeof(u64) > fileSize - header.headerSize)
+	{
+		ERROR_LOG(LOADER, "PSZ header inconsistent: %d blocks for %lld bytes", header.numBlocks, (long long)header.totalBytes);
+		header.numBlocks = 0;
+		return;
+	}
+
+	index.resize(header.numBlocks + 1);
+	fseeko(f, header.headerSize, SEEK_SET);
+	if (fread(&index[0], sizeof(u64), index.size(), f) != index.size())
+	{
+		ERROR_LOG(LOADER, "PSZ index truncated");
+		header.numBlocks = 0;
+		return;
+	}
+	numSectors = (u32)(header.totalBytes / 2048);
+
+	zstream = new z_stream;
+	zstream->zalloc = Z_NULL;
+	zstream->zfree = Z_NULL;
+	zstream->opaque = Z_NULL;
+	if (inflateInit2(zstream, -15) != Z_OK)
+	{
+		ERROR_LOG(LOADER, "inflateInit ERROR : %s", zstream->msg ? zstream->msg : "???");
+		delete zstream;
+		zstream = NULL;
+	}
+
+	for (int i = 0; i < DECODED_CACHE_SIZE; ++i)
+		decoded[i].resize(header.blockSize);
+	DEBUG_LOG(LOADER, "PSZ: blockSize=%d numBlocks=%d", header.blockSize, header.numBlocks);
+}
+
+PSZFileBlockDevice::~PSZFileBlockDevice()
+{
+	if (zstream != NULL)
+	{
+		inflateEnd(zstream);
+		delete zstream;
+	}
+	if (f != NULL)
+		fclose(f);
+}
+
+bool PSZFileBlockDevice::DecodeBlock(u32 block, u8 *outPtr)
+{
+	if (block >= header.numBlocks)
+		return false;
+
+	const u64 pos = index[block] & PSZ_OFFSET_MASK;
+	const u64 nextPos = index[block + 1] & PSZ_OFFSET_MASK;
+	const int codec = (int)(index[block] >> PSZ_CODEC_SHIFT);
+	if (nextPos < pos || nextPos - pos > header.blockSize * 2)
+	{
+		ERROR_LOG(LOADER, "PSZ block %d: bad index", block);
+		return false;
+	}
+
+	readBuffer.resize((size_t)(nextPos - pos));
+	fseeko(f, pos, SEEK_SET);
+	const size_t readSize = readBuffer.empty() ? 0 : fread(&readBuffer[0], 1, readBuffer.size(), f);
+	if (readSize != readBuffer.size())
+	{
+		ERROR_LOG(LOADER, "PSZ block %d: short read", block);
+		return false;
+	}
+
+	// The last block may be short, the rest is zeroes.
+	u32 blockBytes = header.blockSize;
+	if ((u64)(block + 1) * header.blockSize > header.totalBytes)
+		blockBytes = (u32)(header.totalBytes - (u64)block * header.blockSize);
+	memset(outPtr + blockBytes, 0, header.blockSize - blockBytes);
+
+	switch (codec)
+	{
+	case PSZ_CODEC_STORE:
+		if (readSize != blockBytes)
+			break;
+		memcpy(outPtr, &readBuffer[0], blockBytes);
+		return true;
+
+	case PSZ_CODEC_DEFLATE:
+		if (zstream == NULL)
+			break;
+		inflateReset(zstream);
+		zstream->next_in = &readBuffer[0];
+		zstream->avail_in = (uInt)readSize;
+		zstream->next_out = outPtr;
+		zstream->avail_out = blockBytes;
+		if (inflate(zstream, Z_FINISH) == Z_STREAM_END && zstream->avail_out == 0)
+			return true;
+		break;
+
+	case PSZ_CODEC_SNAPPY:
 		{
-			ERROR_LOG(LOADER, "deflateInit ERROR : %s\n", (z.msg) ? z.msg : "???");
-			return false;
+			size_t outSize = blockBytes;
+			if (snappy_uncompress((const char *)&readBuffer[0], readSize, (char *)outPtr, &outSize) == SNAPPY_OK && outSize == blockBytes)
+				return true;
 		}
-		z.avail_in = readSize;
-		z.next_out = outPtr;
-		z.avail_out = blockSize;
-		z.next_in = inbuffer;
-
-		int status = inflate(&z, Z_FULL_FLUSH);
-		if(status != Z_STREAM_END)
-			//if (status != Z_OK)
+		break;
+
+	default:
+		ERROR_LOG(LOADER, "PSZ block %d: unknown codec %d", block, codec);
+		return false;
+	}
+
+	ERROR_LOG(LOADER, "PSZ block %d: decompression failed (codec %d)", block, codec);
+	return false;
+}
+
+const u8 *PSZFileBlockDevice::GetDecodedBlock(u32 block)
+{
+	int slot = 0;
+	for (int i = 0; i < DECODED_CACHE_SIZE; ++i)
+	{
+		if (decodedBlock[i] == block)
 		{
-			ERROR_LOG(LOADER, "block %d:inflate : %s[%d]\n", blockNumber, (z.msg) ? z.msg : "error", status);
-			inflateEnd(&z);
-			return 1;
+			decodedLastUsed[i] = ++decodedTick;
+			blockDeviceStats.cacheHits++;
+			return &decoded[i][0];
 		}
-		int cmp_size = blockSize - z.avail_out;
-		if (cmp_size != (int)blockSize)
+		if (decodedLastUsed[i] < decodedLastUsed[slot])
+			slot = i;
+	}
+
+	blockDeviceStats.cacheMisses++;
+	time_update();
+	const double startTime = time_now_d();
+	bool success = DecodeBlock(block, &decoded[slot][0]);
+	time_update();
+	blockDeviceStats.decompressTime += time_now_d() - startTime;
+	if (!success)
+	{
+		decodedBlock[slot] = 0xFFFFFFFF;
+		return NULL;
+	}
+
+	decodedBlock[slot] = block;
+	decodedLastUsed[slot] = ++decodedTick;
+	return &decoded[slot][0];
+}
+
+bool PSZFileBlockDevice::ReadBlock(int blockNumber, u8 *outPtr)
+{
+	return ReadBlocks((u32)blockNumber, 1, outPtr);
+}
+
+bool PSZFileBlockDevice::ReadBlocks(u32 minBlock, int count, u8 *outPtr)
+{
+	// The image failed to open, and blockSize may not even be valid.
+	if (numSectors == 0)
+	{
+		if (count > 0)
+			memset(outPtr, 0, count * 2048);
+		return false;
+	}
+
+	const u32 sectorsPerBlock = header.blockSize / 2048;
+	bool result = true;
+	while (count > 0)
+	{
+		const u32 block = minBlock / sectorsPerBlock;
+		const u32 offset = minBlock % sectorsPerBlock;
+		int sectors = (int)(sectorsPerBlock - offset);
+		if (sectors > count)
+			sectors = count;
+
+		const u8 *data = minBlock < numSectors ? GetDecodedBlock(block) : NULL;
+		if (data != NULL)
+			memcpy(outPtr, data + offset * 2048, sectors * 2048);
+		else
 		{
-			ERROR_LOG(LOADER, "block %d : block size error %d != %d\n", blockNumber, cmp_size, blockSize);
-			inflateEnd(&z);
-			return false;
+			memset(outPtr, 0, sectors * 2048);
+			result = false;
 		}
-		inflateEnd(&z);
+
+		minBlock += sectors;
+		outPtr += sectors * 2048;
+		count -= sectors;
 	}
-	return true;
+	return result;
+}
+
+BlockDevice *constructBlockDevice(const char *filename)
+{
+	// Check for CISO and PSZ, anything else is a plain ISO.
+	FILE *f = fopen(filename, "rb");
+	char buffer[4];
+	size_t size = f != NULL ? fread(buffer, 1, 4, f) : 0;
+	if (f != NULL)
+		fclose(f);
+	if (size == 4 && !memcmp(buffer, "CISO", 4))
+		return new CISOFileBlockDevice(filename);
+	else if (size == 4 && !memcmp(buffer, "PSZI", 4))
+		return new PSZFileBlockDevice(filename);
+	else
+		return new FileBlockDevice(filename);
 }
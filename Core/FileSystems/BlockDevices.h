@@ -19,18 +19,48 @@
 
 // Abstractions around read-only blockdevices, such as PSP UMD discs.
 // CISOFileBlockDevice implements compressed iso images, CISO format.
+// PSZFileBlockDevice implements our own compressed format, with larger blocks and faster codecs.
 //
 // The ISOFileSystemReader reads from a BlockDevice, so it automatically works
 // with CISO images.
 
 #include "../../Globals.h"
+#include "StdConditionVariable.h"
+#include "StdMutex.h"
+#include "StdThread.h"
+#include <deque>
+#include <map>
+#include <set>
 #include <string>
+#include <vector>
+
+struct z_stream_s;
+
+// Shown with the other debug stats, reset each frame.
+struct BlockDeviceStats
+{
+	void ResetFrame()
+	{
+		cacheHits = 0;
+		cacheMisses = 0;
+		decompressTime = 0.0;
+	}
+
+	u32 cacheHits;
+	u32 cacheMisses;
+	// In seconds.
+	double decompressTime;
+};
+
+extern BlockDeviceStats blockDeviceStats;
 
 class BlockDevice
 {
 public:
 	virtual ~BlockDevice() {}
 	virtual bool ReadBlock(int blockNumber, u8 *outPtr) = 0;
+	// Reads count consecutive blocks into outPtr.  The default just calls ReadBlock() for each.
+	virtual bool ReadBlocks(u32 minBlock, int count, u8 *outPtr);
 	int GetBlockSize() const { return 2048;}  // forced, it cannot be changed by subclasses
 	virtual u32 GetNumBlocks() = 0;
 };
@@ -42,15 +72,79 @@ public:
 	CISOFileBlockDevice(std::string _filename);
 	~CISOFileBlockDevice();
 	bool ReadBlock(int blockNumber, u8 *outPtr);
+	bool ReadBlocks(u32 minBlock, int count, u8 *outPtr);
 	u32 GetNumBlocks() { return numBlocks;}
 
 private:
+	// What it takes to read and inflate blocks.  The emu thread and each prefetch thread have their own.
+	struct Reader
+	{
+		FILE *f;
+		// Reused for every block (with inflateReset), NULL if zlib failed to initialize.
+		z_stream_s *zstream;
+		// Compressed data, kept around to avoid reallocating per read.
+		std::vector<u8> readBuffer;
+		// Whether each block of the last ReadUncached() came out right.  Only those get cached.
+		std::vector<u8> blockOk;
+	};
+
+	void InitReader(Reader &reader, FILE *f);
+	void ShutdownReader(Reader &reader);
+	bool ReadUncached(Reader &reader, u32 minBlock, int count, u8 *outPtr);
+	bool DecompressBlock(Reader &reader, int blockNumber, const u8 *inPtr, u32 inSize, bool plain, u8 *outPtr);
+
+	bool IsCached(u32 blockNumber);
+	bool CopyCachedBlock(u32 blockNumber, u8 *outPtr);
+	void CacheBlock(u32 blockNumber, const u8 *data);
+	int FindStreamChunk(u32 blockNumber);
+	void StoreStreamChunk(u32 chunk, const u8 *data, const std::vector<u8> &blockOk);
+
+	void QueuePrefetch(u32 nextBlock);
+	void CancelPrefetch();
+	bool WaitForPrefetch(u32 minBlock, int count);
+	static void PrefetchThread(CISOFileBlockDevice *device);
+	void RunPrefetch();
+
 	std::string filename;
-	FILE *f;
 	u32 *index;
 	int indexShift;
 	u32 blockSize;
 	u32 numBlocks;
+	Reader reader;
+
+	// LRU of decompressed blocks, so rereading hot files doesn't inflate them again.
+	// Shared with the prefetch threads, so only touch it with cacheLock held.
+	std::mutex cacheLock;
+	std::vector<u8> cacheData;
+	std::vector<u32> cacheBlocks;
+	std::vector<u32> cacheLastUsed;
+	std::map<u32, int> cacheSlots;
+	u32 cacheTick;
+
+	// What the prefetch threads inflated, kept apart from the LRU so streaming doesn't flush it.
+	// Also under cacheLock.
+	struct StreamChunk
+	{
+		u32 chunk;
+		u32 lastUsed;
+		std::vector<u8> data;
+		std::vector<u8> blockOk;
+	};
+	std::vector<StreamChunk> streamChunks;
+
+	// Next block after the last read, to detect sequential reads.
+	u32 nextReadBlock;
+
+	// Chunks of blocks queued for the prefetch threads to inflate into streamChunks ahead of the game.
+	// Lock order is prefetchLock, then cacheLock.
+	std::mutex prefetchLock;
+	std::condition_variable prefetchWake;
+	std::condition_variable prefetchDone;
+	std::deque<u32> prefetchQueue;
+	std::set<u32> pendingChunks;
+	std::set<u32> activeChunks;
+	std::vector<std::thread *> prefetchThreads;
+	bool prefetchExit;
 };
 
 
@@ -60,10 +154,89 @@ public:
 	FileBlockDevice(std::string _filename);
 	~FileBlockDevice();
 	bool ReadBlock(int blockNumber, u8 *outPtr);
+	bool ReadBlocks(u32 minBlock, int count, u8 *outPtr);
 	u32 GetNumBlocks() {return (u32)(filesize / GetBlockSize());}
 
 private:
+	void MapFile();
+	void UnmapFile();
+	void AdviseRead(u32 minBlock, int count);
+	void CopyMapped(u64 pos, size_t bytes, u8 *outPtr);
+
 	std::string filename;
 	FILE *f;
-	size_t filesize;
+	u64 filesize;
+	// The whole image, mapped read only so instances share the page cache.
+	// NULL if it couldn't be mapped (e.g. no address space), then we fall back to fread.
+	const u8 *mapped;
+#ifdef _WIN32
+	void *mappingHandle;
+#endif
+	// Used to detect sequential reads, to ask the OS to read ahead.
+	u32 nextBlock;
+	int sequentialReads;
+	// Byte offset up to which read ahead has already been requested.
+	u64 advisedUntil;
 };
+
+
+// PSZ format: a PSZHeader, then numBlocks + 1 little endian u64 index entries, then the blocks.
+// Each entry has the file offset of its block in the low 60 bits and the codec in the top 4.
+// The last entry only marks where the last block ends.
+struct PSZHeader
+{
+	char magic[4];  // "PSZI"
+	u32 headerSize;  // sizeof(PSZHeader), the index follows.
+	u16 version;
+	u16 reserved1;
+	u32 blockSize;  // Uncompressed, a power of 2 between PSZ_MIN_BLOCK_SIZE and PSZ_MAX_BLOCK_SIZE.
+	u64 totalBytes;
+	u32 numBlocks;
+	u32 reserved2;
+};
+
+enum PSZCodec
+{
+	PSZ_CODEC_STORE = 0,
+	PSZ_CODEC_DEFLATE = 1,  // Raw deflate, no zlib header.
+	PSZ_CODEC_SNAPPY = 2,
+};
+
+static const u16 PSZ_VERSION = 1;
+static const u32 PSZ_MIN_BLOCK_SIZE = 16 * 1024;
+static const u32 PSZ_MAX_BLOCK_SIZE = 128 * 1024;
+static const int PSZ_CODEC_SHIFT = 60;
+static const u64 PSZ_OFFSET_MASK = (1ULL << PSZ_CODEC_SHIFT) - 1;
+
+class PSZFileBlockDevice : public BlockDevice
+{
+public:
+	PSZFileBlockDevice(std::string _filename);
+	~PSZFileBlockDevice();
+	bool ReadBlock(int blockNumber, u8 *outPtr);
+	bool ReadBlocks(u32 minBlock, int count, u8 *outPtr);
+	u32 GetNumBlocks() { return numSectors; }
+
+private:
+	const u8 *GetDecodedBlock(u32 block);
+	bool DecodeBlock(u32 block, u8 *outPtr);
+
+	std::string filename;
+	FILE *f;
+	PSZHeader header;
+	std::vector<u64> index;
+	// In 2048 byte sectors, which is what callers see.
+	u32 numSectors;
+	z_stream_s *zstream;
+	std::vector<u8> readBuffer;
+
+	// A few recently decoded blocks, since sectors are usually read in order.
+	enum { DECODED_CACHE_SIZE = 4 };
+	std::vector<u8> decoded[DECODED_CACHE_SIZE];
+	u32 decodedBlock[DECODED_CACHE_SIZE];
+	u32 decodedLastUsed[DECODED_CACHE_SIZE];
+	u32 decodedTick;
+};
+
+// Opens the right kind of BlockDevice for the file, based on its magic.
+BlockDevice *constructBlockDevice(const char *filename);
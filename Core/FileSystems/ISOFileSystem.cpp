@@ -399,10 +399,10 @@ size_t ISOFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size)
 		if (e.file != 0 && e.file->isBlockSectorMode)
 		{
 			// Whole sectors! Shortcut to this simple code.
-			for (int i = 0; i < size; i++)
+			if (size > 0)
 			{
-				blockDevice->ReadBlock(e.seekPos, pointer + i * 2048);
-				e.seekPos++;
+				blockDevice->ReadBlocks(e.seekPos, (int)size, pointer);
+				e.seekPos += (unsigned int)size;
 			}
 			return (size_t)size;
 		}
@@ -438,7 +438,8 @@ size_t ISOFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size)
 
 		u8 theSector[2048];
 
-		while (remain > 0)
+		// Only the partial sectors at either end need to bounce through theSector.
+		if (remain > 0 && posInSector != 0)
 		{
 			blockDevice->ReadBlock(secNum, theSector);
 			size_t bytesToCopy = 2048 - posInSector;
@@ -449,9 +450,27 @@ size_t ISOFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size)
 			totalRead += (u32)bytesToCopy;
 			pointer += bytesToCopy;
 			remain -= bytesToCopy;
-			posInSector = 0;
 			secNum++;
 		}
+
+		if (remain >= 2048)
+		{
+			int sectors = (int)(remain / 2048);
+			blockDevice->ReadBlocks(secNum, sectors, pointer);
+			size_t bytesRead = (size_t)sectors * 2048;
+			totalRead += (u32)bytesRead;
+			pointer += bytesRead;
+			remain -= bytesRead;
+			secNum += sectors;
+		}
+
+		if (remain > 0)
+		{
+			blockDevice->ReadBlock(secNum, theSector);
+			memcpy(pointer, theSector, (size_t)remain);
+			totalRead += (u32)remain;
+			remain = 0;
+		}
 		e.seekPos += (unsigned int)size;
 		return totalRead;
 	}
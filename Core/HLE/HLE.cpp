@@ -17,12 +17,15 @@
 
 #include "base/timeutil.h"
 #include "HLE.h"
+#include <algorithm>
 #include <map>
+#include <string>
 #include <vector>
 #include "../MemMap.h"
 #include "../Config.h"
 
 #include "HLETables.h"
+#include "ReplaceTables.h"
 #include "../System.h"
 #include "sceDisplay.h"
 #include "sceIo.h"
@@ -30,6 +33,7 @@
 #include "sceKernelMemory.h"
 #include "sceKernelThread.h"
 #include "sceKernelInterrupt.h"
+#include "../MIPS/MIPS.h"
 #include "../MIPS/MIPSCodeUtils.h"
 #include "../Host.h"
 
@@ -51,10 +55,52 @@ enum
 	HLE_AFTER_DEBUG_BREAK = 0x20,
 };
 
+// Bucket 0 is under 1us, bucket n is [2^(n-1), 2^n) us, and the last bucket takes the rest.
+static const int SYSCALL_PROFILE_BUCKETS = 24;
+
+struct SyscallProfile
+{
+	u32 calls;
+	double totalUs;
+	u32 histogram[SYSCALL_PROFILE_BUCKETS];
+};
+
 static std::vector<HLEModule> moduleDB;
+// Indexed by module, then function.  Only filled while g_Config.bSyscallProfile is set.
+static std::vector<std::vector<SyscallProfile> > syscallProfiles;
 static std::vector<Syscall> unresolvedSyscalls;
 static std::vector<Syscall> exportedCalls;
-static int hleAfterSyscall = HLE_AFTER_NOTHING;
+
+// Lookup indices over moduleDB and the syscall lists above.  PRX loading resolves every import
+// through these, so they're built as modules register and as syscalls are stored.
+struct HLENameLess
+{
+	bool operator ()(const char *a, const char *b) const
+	{
+		return strcmp(a, b) < 0;
+	}
+};
+
+struct HLEFuncNameLess
+{
+	bool operator ()(const std::pair<int, const char *> &a, const std::pair<int, const char *> &b) const
+	{
+		if (a.first != b.first)
+			return a.first < b.first;
+		return strcmp(a.second, b.second) < 0;
+	}
+};
+
+typedef std::pair<std::string, u32> SyscallKey;
+
+static std::map<const char *, int, HLENameLess> moduleIndices;
+// Keyed by (module index << 32) | nid.
+static std::map<u64, int> funcIndices;
+static std::map<std::pair<int, const char *>, u32, HLEFuncNameLess> funcNibsByName;
+// First exported address for each (module, nid), same as the first match in exportedCalls.
+static std::map<SyscallKey, u32> exportedAddrs;
+static std::multimap<SyscallKey, u32> unresolvedAddrs;
+int hleAfterSyscall = HLE_AFTER_NOTHING;
 static const char *hleAfterSyscallReschedReason;
 
 void HLEInit()
@@ -68,50 +114,73 @@ void HLEDoState(PointerWrap &p)
 	p.Do(unresolvedSyscalls, sc);
 	p.Do(exportedCalls, sc);
 	p.DoMarker("HLE");
+
+	if (p.mode == p.MODE_READ)
+	{
+		exportedAddrs.clear();
+		for (size_t i = 0; i < exportedCalls.size(); ++i)
+			exportedAddrs.insert(std::make_pair(SyscallKey(exportedCalls[i].moduleName, exportedCalls[i].nid), exportedCalls[i].symAddr));
+		unresolvedAddrs.clear();
+		for (size_t i = 0; i < unresolvedSyscalls.size(); ++i)
+			unresolvedAddrs.insert(std::make_pair(SyscallKey(unresolvedSyscalls[i].moduleName, unresolvedSyscalls[i].nid), unresolvedSyscalls[i].symAddr));
+	}
 }
 
 void HLEShutdown()
 {
 	hleAfterSyscall = HLE_AFTER_NOTHING;
 	moduleDB.clear();
+	moduleIndices.clear();
+	funcIndices.clear();
+	funcNibsByName.clear();
+	syscallProfiles.clear();
 	unresolvedSyscalls.clear();
+	unresolvedAddrs.clear();
 	exportedCalls.clear();
+	exportedAddrs.clear();
+	Replacement_Shutdown();
 }
 
 void RegisterModule(const char *name, int numFunctions, const HLEFunction *funcTable)
 {
 	HLEModule module = {name, numFunctions, funcTable};
+	const int moduleIndex = (int)moduleDB.size();
 	moduleDB.push_back(module);
+
+	// insert() keeps the first entry, so duplicates resolve the same way the old linear scans did.
+	moduleIndices.insert(std::make_pair(name, moduleIndex));
+	for (int i = 0; i < numFunctions; i++)
+	{
+		funcIndices.insert(std::make_pair(((u64)moduleIndex << 32) | funcTable[i].ID, i));
+		if (funcTable[i].name != NULL)
+			funcNibsByName.insert(std::make_pair(std::make_pair(moduleIndex, funcTable[i].name), funcTable[i].ID));
+	}
 }
 
 int GetModuleIndex(const char *moduleName)
 {
-	for (size_t i = 0; i < moduleDB.size(); i++)
-		if (strcmp(moduleName, moduleDB[i].name) == 0)
-			return (int)i;
+	std::map<const char *, int, HLENameLess>::const_iterator it = moduleIndices.find(moduleName);
+	if (it != moduleIndices.end())
+		return it->second;
 	return -1;
 }
 
 int GetFuncIndex(int moduleIndex, u32 nib)
 {
-	const HLEModule &module = moduleDB[moduleIndex];
-	for (int i = 0; i < module.numFunctions; i++)
-	{
-		if (module.funcTable[i].ID == nib)
-			return i;
-	}
+	std::map<u64, int>::const_iterator it = funcIndices.find(((u64)moduleIndex << 32) | nib);
+	if (it != funcIndices.end())
+		return it->second;
 	return -1;
 }
 
 u32 GetNibByName(const char *moduleName, const char *function)
 {
 	int moduleIndex = GetModuleIndex(moduleName);
-	const HLEModule &module = moduleDB[moduleIndex];
-	for (int i = 0; i < module.numFunctions; i++)
-	{
-		if (!strcmp(module.funcTable[i].name, function))
-			return module.funcTable[i].ID;
-	}
+	if (moduleIndex == -1)
+		return -1;
+	std::map<std::pair<int, const char *>, u32, HLEFuncNameLess>::const_iterator it = funcNibsByName.find(std::make_pair(moduleIndex, function));
+	if (it != funcNibsByName.end())
+		return it->second;
 	return -1;
 }
 
@@ -137,13 +206,10 @@ const char *GetFuncName(const char *moduleName, u32 nib)
 
 	// Was this function exported previously?
 	static char temp[256];
-	for (auto it = exportedCalls.begin(), end = exportedCalls.end(); it != end; ++it)
+	if (exportedAddrs.find(SyscallKey(moduleName, nib)) != exportedAddrs.end())
 	{
-		if (!strcmp(it->moduleName, moduleName) && it->nid == nib)
-		{
-			sprintf(temp, "[EXP: 0x%08x]", nib);
-			return temp;
-		}
+		sprintf(temp, "[EXP: 0x%08x]", nib);
+		return temp;
 	}
 
 	// No good, we can't find it.
@@ -191,14 +257,12 @@ void WriteSyscall(const char *moduleName, u32 nib, u32 address)
 	else
 	{
 		// Did another module export this already?
-		for (auto it = exportedCalls.begin(), end = exportedCalls.end(); it != end; ++it)
+		std::map<SyscallKey, u32>::const_iterator exported = exportedAddrs.find(SyscallKey(moduleName, nib));
+		if (exported != exportedAddrs.end())
 		{
-			if (!strcmp(it->moduleName, moduleName) && it->nid == nib)
-			{
-				Memory::Write_U32(MIPS_MAKE_J(it->symAddr), address); // j symAddr
-				Memory::Write_U32(MIPS_MAKE_NOP(), address + 4); // nop (delay slot)
-				return;
-			}
+			Memory::Write_U32(MIPS_MAKE_J(exported->second), address); // j symAddr
+			Memory::Write_U32(MIPS_MAKE_NOP(), address + 4); // nop (delay slot)
+			return;
 		}
 
 		// Module inexistent.. for now; let's store the syscall for it to be resolved later
@@ -207,6 +271,7 @@ void WriteSyscall(const char *moduleName, u32 nib, u32 address)
 		strncpy(sysc.moduleName, moduleName, KERNELOBJECT_MAX_NAME_LENGTH);
 		sysc.moduleName[KERNELOBJECT_MAX_NAME_LENGTH] = '\0';
 		unresolvedSyscalls.push_back(sysc);
+		unresolvedAddrs.insert(std::make_pair(SyscallKey(sysc.moduleName, nib), address));
 
 		// Write a trap so we notice this func if it's called before resolving.
 		Memory::Write_U32(MIPS_MAKE_JR_RA(), address); // jr ra
@@ -218,23 +283,25 @@ void ResolveSyscall(const char *moduleName, u32 nib, u32 address)
 {
 	_dbg_assert_msg_(HLE, moduleName != NULL, "Invalid module name.");
 
-	for (size_t i = 0; i < unresolvedSyscalls.size(); i++)
-	{
-		Syscall *sysc = &unresolvedSyscalls[i];
-		if (strncmp(sysc->moduleName, moduleName, 32) == 0 && sysc->nid == nib)
-		{
-			INFO_LOG(HLE,"Resolving %s/%08x",moduleName,nib);
-			// Note: doing that, we can't trace external module calls, so maybe something else should be done to debug more efficiently
-			// Note that this should be J not JAL, as otherwise control will return to the stub..
-			Memory::Write_U32(MIPS_MAKE_J(address), sysc->symAddr);
-			Memory::Write_U32(MIPS_MAKE_NOP(), sysc->symAddr + 4);
-		}
-	}
-
 	Syscall ex = {"", address, nib};
 	strncpy(ex.moduleName, moduleName, KERNELOBJECT_MAX_NAME_LENGTH);
 	ex.moduleName[KERNELOBJECT_MAX_NAME_LENGTH] = '\0';
+
+	typedef std::multimap<SyscallKey, u32>::const_iterator UnresolvedIter;
+	std::pair<UnresolvedIter, UnresolvedIter> range = unresolvedAddrs.equal_range(SyscallKey(moduleName, nib));
+	for (UnresolvedIter it = range.first; it != range.second; ++it)
+	{
+		INFO_LOG(HLE,"Resolving %s/%08x",moduleName,nib);
+		// Note: doing that, we can't trace external module calls, so maybe something else should be done to debug more efficiently
+		// Note that this should be J not JAL, as otherwise control will return to the stub..
+		Memory::Write_U32(MIPS_MAKE_J(address), it->second);
+		Memory::Write_U32(MIPS_MAKE_NOP(), it->second + 4);
+		// The stub may belong to a module that has already run.
+		currentMIPS->InvalidateICache(it->second, 8);
+	}
+
 	exportedCalls.push_back(ex);
+	exportedAddrs.insert(std::make_pair(SyscallKey(ex.moduleName, nib), address));
 }
 
 const char *GetFuncName(int moduleIndex, int func)
@@ -308,7 +375,7 @@ bool hleExecuteDebugBreak(const HLEFunction &func)
 	return true;
 }
 
-inline void hleFinishSyscall(int modulenum, int funcnum)
+void hleFinishSyscall(int modulenum, int funcnum)
 {
 	if ((hleAfterSyscall & HLE_AFTER_CURRENT_CALLBACKS) != 0)
 		__KernelForceCallbacks();
@@ -375,18 +442,140 @@ inline void updateSyscallStats(int modulenum, int funcnum, double total)
 	}
 }
 
+inline void updateSyscallProfile(int modulenum, int funcnum, double seconds)
+{
+	if (modulenum >= (int)moduleDB.size() || funcnum >= moduleDB[modulenum].numFunctions)
+		return;
+	if (modulenum >= (int)syscallProfiles.size())
+		syscallProfiles.resize(moduleDB.size());
+	std::vector<SyscallProfile> &funcs = syscallProfiles[modulenum];
+	if (funcs.empty())
+	{
+		SyscallProfile blank = {0};
+		funcs.resize(moduleDB[modulenum].numFunctions, blank);
+	}
+
+	SyscallProfile &prof = funcs[funcnum];
+	const double us = seconds * 1000000.0;
+	int bucket = 0;
+	for (double limit = 1.0; us >= limit && bucket < SYSCALL_PROFILE_BUCKETS - 1; limit *= 2.0)
+		++bucket;
+	prof.calls++;
+	prof.totalUs += us;
+	prof.histogram[bucket]++;
+}
+
+void ResetSyscallProfile()
+{
+	syscallProfiles.clear();
+}
+
+struct SyscallProfileEntry
+{
+	int modulenum;
+	int funcnum;
+	const SyscallProfile *prof;
+};
+
+struct SyscallProfileEntryGreater
+{
+	bool operator ()(const SyscallProfileEntry &a, const SyscallProfileEntry &b) const
+	{
+		return a.prof->totalUs > b.prof->totalUs;
+	}
+};
+
+void WriteSyscallProfileReport(FILE *file, bool json)
+{
+	std::vector<SyscallProfileEntry> order;
+	std::vector<double> moduleUs(syscallProfiles.size(), 0.0);
+	std::vector<u32> moduleCalls(syscallProfiles.size(), 0);
+	for (size_t m = 0; m < syscallProfiles.size() && m < moduleDB.size(); ++m)
+	{
+		for (size_t f = 0; f < syscallProfiles[m].size(); ++f)
+		{
+			const SyscallProfile &prof = syscallProfiles[m][f];
+			if (prof.calls == 0)
+				continue;
+			SyscallProfileEntry entry = {(int)m, (int)f, &prof};
+			order.push_back(entry);
+			moduleUs[m] += prof.totalUs;
+			moduleCalls[m] += prof.calls;
+		}
+	}
+	std::sort(order.begin(), order.end(), SyscallProfileEntryGreater());
+
+	if (!json)
+	{
+		fprintf(file, "module,function,nid,calls,total_us");
+		for (int b = 0; b < SYSCALL_PROFILE_BUCKETS - 1; ++b)
+			fprintf(file, ",lt_%uus", 1U << b);
+		fprintf(file, ",ge_%uus\n", 1U << (SYSCALL_PROFILE_BUCKETS - 2));
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			const HLEFunction &func = moduleDB[order[i].modulenum].funcTable[order[i].funcnum];
+			const SyscallProfile &prof = *order[i].prof;
+			fprintf(file, "%s,%s,%08x,%u,%.3f", moduleDB[order[i].modulenum].name, func.name, func.ID, prof.calls, prof.totalUs);
+			for (int b = 0; b < SYSCALL_PROFILE_BUCKETS; ++b)
+				fprintf(file, ",%u", prof.histogram[b]);
+			fprintf(file, "\n");
+		}
+		return;
+	}
+
+	fprintf(file, "{\n\t\"buckets\": \"bucket 0 is under 1us, bucket n is [2^(n-1), 2^n) us, the last is everything above\",\n");
+	fprintf(file, "\t\"modules\": [");
+	bool first = true;
+	for (size_t m = 0; m < moduleCalls.size(); ++m)
+	{
+		if (moduleCalls[m] == 0)
+			continue;
+		fprintf(file, "%s\n\t\t{\"module\": \"%s\", \"calls\": %u, \"totalUs\": %.3f}", first ? "" : ",", moduleDB[m].name, moduleCalls[m], moduleUs[m]);
+		first = false;
+	}
+	fprintf(file, "\n\t],\n\t\"functions\": [");
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		const HLEFunction &func = moduleDB[order[i].modulenum].funcTable[order[i].funcnum];
+		const SyscallProfile &prof = *order[i].prof;
+		fprintf(file, "%s\n\t\t{\"module\": \"%s\", \"function\": \"%s\", \"nid\": \"%08x\", \"calls\": %u, \"totalUs\": %.3f, \"histogram\": [",
+			i == 0 ? "" : ",", moduleDB[order[i].modulenum].name, func.name, func.ID, prof.calls, prof.totalUs);
+		for (int b = 0; b < SYSCALL_PROFILE_BUCKETS; ++b)
+			fprintf(file, "%s%u", b == 0 ? "" : ", ", prof.histogram[b]);
+		fprintf(file, "]}");
+	}
+	fprintf(file, "\n\t]\n}\n");
+}
+
+const HLEFunction *GetSyscallInfo(u32 op)
+{
+	u32 callno = (op >> 6) & 0xFFFFF; //20 bits
+	int funcnum = callno & 0xFFF;
+	int modulenum = (callno & 0xFF000) >> 12;
+	if (funcnum == 0xfff || op == 0xffff || modulenum >= (int)moduleDB.size())
+		return NULL;
+	if (funcnum >= moduleDB[modulenum].numFunctions)
+		return NULL;
+	return &moduleDB[modulenum].funcTable[funcnum];
+}
+
 void CallSyscall(u32 op)
 {
-	if (g_Config.bShowDebugStats)
+	// Only pay for the timer when the stats are actually shown or profiled.
+	const bool timing = g_Config.bShowDebugStats || g_Config.bSyscallProfile;
+	double start = 0.0;
+	if (timing)
+	{
 		time_update();
-	double start = time_now_d();
+		start = time_now_d();
+	}
 	u32 callno = (op >> 6) & 0xFFFFF; //20 bits
 	int funcnum = callno & 0xFFF;
 	int modulenum = (callno & 0xFF000) >> 12;
 	if (funcnum == 0xfff || op == 0xffff)
 	{
 		_dbg_assert_msg_(HLE,0,"Unknown syscall");
-		ERROR_LOG(HLE,"Unknown syscall: Module: %s", modulenum > (int) moduleDB.size() ? "(unknown)" : moduleDB[modulenum].name); 
+		ERROR_LOG(HLE,"Unknown syscall: Module: %s", modulenum >= (int) moduleDB.size() ? "(unknown)" : moduleDB[modulenum].name); 
 		return;
 	}
 	HLEFunc func = moduleDB[modulenum].funcTable[funcnum].func;
@@ -401,9 +590,13 @@ void CallSyscall(u32 op)
 	{
 		ERROR_LOG(HLE,"Unimplemented HLE function %s", moduleDB[modulenum].funcTable[funcnum].name);
 	}
-	if (g_Config.bShowDebugStats)
+	if (timing)
 	{
 		time_update();
-		updateSyscallStats(modulenum, funcnum, time_now_d() - start);
+		const double total = time_now_d() - start;
+		if (g_Config.bShowDebugStats)
+			updateSyscallStats(modulenum, funcnum, total);
+		if (g_Config.bSyscallProfile)
+			updateSyscallProfile(modulenum, funcnum, total);
 	}
 }
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <cstdio>
+
 #include "../Globals.h"
 #include "../MIPS/MIPS.h"
 
@@ -94,5 +96,15 @@ u32 GetNibByName(const char *module, const char *function);
 u32 GetSyscallOp(const char *module, u32 nib);
 void WriteSyscall(const char *module, u32 nib, u32 address);
 void CallSyscall(u32 op);
+// Returns NULL for invalid ops.  Used by the JIT to call HLE functions directly.
+const HLEFunction *GetSyscallInfo(u32 op);
+// Nonzero when something must run after the current syscall (see hleFinishSyscall.)
+extern int hleAfterSyscall;
+void hleFinishSyscall(int modulenum, int funcnum);
+
+// Writes the counts and host time histograms collected while g_Config.bSyscallProfile was set.
+// Must be called before HLEShutdown(), since the function names come from the module tables.
+void WriteSyscallProfileReport(FILE *file, bool json);
+void ResetSyscallProfile();
 void ResolveSyscall(const char *moduleName, u32 nib, u32 address);
 
@@ -0,0 +1,347 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <map>
+#include <vector>
+#include <cstring>
+
+#include "ChunkFile.h"
+#include "Core/CoreTiming.h"
+#include "Core/MemMap.h"
+#include "sceKernel.h"
+#include "sceKernelThread.h"
+
+// Most objects only need to remember which thread is waiting.  Objects that keep more
+// per waiter provide their own overload of this for their wait info struct.
+inline SceUID __KernelWaitInfoThreadID(SceUID threadID)
+{
+	return threadID;
+}
+
+// Stops the timeout for a thread that's being woken, and tells it how long it had left.
+inline void __KernelCancelWaitTimeout(int timerEvent, SceUID threadID, u32 timeoutPtr)
+{
+	if (timeoutPtr != 0 && timerEvent != -1)
+	{
+		// Remove any event for this thread.
+		u64 cyclesLeft = CoreTiming::UnscheduleEvent(timerEvent, threadID);
+		Memory::Write_U32((u32) cyclesToUs(cyclesLeft), timeoutPtr);
+	}
+}
+
+// The threads waiting on a kernel sync object, in the order they should be woken.
+// With priority ordering, threads go behind any others of the same priority (as on the PSP,
+// this uses the priority the thread had when it started to wait.)  Otherwise it's a FIFO.
+//
+// Waiters live in a linked list of pooled nodes, with the last node of each priority and a
+// bitmap of used priorities kept on the side, plus a map from thread to node.  Adding, waking,
+// and removing a waiter (even by thread, as on timeout) never scan the list.
+template <typename WaitInfo>
+class KernelWaitQueue
+{
+public:
+	enum { NUM_PRIORITIES = 128 };
+
+	KernelWaitQueue()
+	{
+		clear();
+	}
+
+	inline bool empty() const
+	{
+		return count == 0;
+	}
+
+	inline size_t size() const
+	{
+		return count;
+	}
+
+	// Iteration goes begin() -> next(i) -> ... until end(), in wake order.
+	inline int begin()
+	{
+		if (prioritiesStale)
+			RestorePriorities();
+		return first;
+	}
+
+	inline int end() const
+	{
+		return -1;
+	}
+
+	inline int next(int i) const
+	{
+		return nodes[i].next;
+	}
+
+	inline WaitInfo &operator [](int i)
+	{
+		return nodes[i].info;
+	}
+
+	inline WaitInfo &front()
+	{
+		if (prioritiesStale)
+			RestorePriorities();
+		return nodes[first].info;
+	}
+
+	void push(const WaitInfo &info, bool usePriority)
+	{
+		if (prioritiesStale)
+			RestorePriorities();
+
+		// Without priority, it goes at the very back.
+		int priority = 0;
+		if (usePriority)
+			priority = PriorityIndex(__KernelGetThreadPrio(__KernelWaitInfoThreadID(info)));
+		else if (Back() != -1)
+			priority = nodes[Back()].priority;
+
+		int i = AllocNode();
+		nodes[i].info = info;
+		Link(i, priority);
+	}
+
+	void pop_front()
+	{
+		if (prioritiesStale)
+			RestorePriorities();
+		erase(first);
+	}
+
+	// Returns the next waiter, so it can be used while iterating.
+	int erase(int i)
+	{
+		int nextNode = nodes[i].next;
+		Unlink(i);
+		byThread.erase(nodes[i].byThreadIt);
+
+		nodes[i].next = freeNodes;
+		freeNodes = i;
+		--count;
+		return nextNode;
+	}
+
+	// If the thread is in here more than once, this is the one that wakes first.
+	int find(SceUID threadID) const
+	{
+		typename ThreadMap::const_iterator it = byThread.lower_bound(threadID);
+		typename ThreadMap::const_iterator end = byThread.upper_bound(threadID);
+		if (it == end)
+			return -1;
+
+		int found = it->second;
+		for (++it; it != end; ++it)
+		{
+			const Node &n = nodes[it->second];
+			if (n.priority < nodes[found].priority || (n.priority == nodes[found].priority && n.order < nodes[found].order))
+				found = it->second;
+		}
+		return found;
+	}
+
+	bool contains(SceUID threadID) const
+	{
+		return find(threadID) != -1;
+	}
+
+	bool remove(SceUID threadID)
+	{
+		int i = find(threadID);
+		if (i == -1)
+			return false;
+		erase(i);
+		return true;
+	}
+
+	void clear()
+	{
+		// Keeps the pool's memory around for the next waiters.
+		nodes.clear();
+		byThread.clear();
+		first = -1;
+		freeNodes = -1;
+		count = 0;
+		nextOrder = 0;
+		prioritiesStale = false;
+		for (int i = 0; i < NUM_PRIORITIES; ++i)
+			tails[i] = -1;
+		memset(usedPriorities, 0, sizeof(usedPriorities));
+	}
+
+	// Same format as the std::vector<WaitInfo> this used to be.
+	void DoState(PointerWrap &p)
+	{
+		std::vector<WaitInfo> list;
+		list.reserve(count);
+		for (int i = first; i != -1; i = nodes[i].next)
+			list.push_back(nodes[i].info);
+
+		WaitInfo dv = WaitInfo();
+		p.Do(list, dv);
+
+		if (p.mode == PointerWrap::MODE_READ)
+		{
+			clear();
+			for (size_t i = 0; i < list.size(); ++i)
+			{
+				int n = AllocNode();
+				nodes[n].info = list[i];
+				Link(n, 0);
+			}
+			// The threads might not be loaded yet, so their priorities have to wait
+			// until the queue is next used.
+			prioritiesStale = !list.empty();
+		}
+	}
+
+private:
+	typedef std::multimap<SceUID, int> ThreadMap;
+
+	struct Node
+	{
+		WaitInfo info;
+		int priority;
+		// Increases along each run of the same priority.
+		u64 order;
+		int prev;
+		int next;
+		typename ThreadMap::iterator byThreadIt;
+	};
+
+	static inline int PriorityIndex(u32 priority)
+	{
+		return priority >= NUM_PRIORITIES ? NUM_PRIORITIES - 1 : (int)priority;
+	}
+
+	// The last waiter that goes before anyone of this priority, or -1 if it'd be first.
+	int LastBefore(int priority) const
+	{
+		int word = priority / 32;
+		u32 bits = usedPriorities[word] & ((1U << (priority & 31)) - 1);
+		while (bits == 0)
+		{
+			if (--word < 0)
+				return -1;
+			bits = usedPriorities[word];
+		}
+		return tails[word * 32 + Common::HighestSetBit(bits)];
+	}
+
+	// The last waiter, or -1 if there aren't any.
+	int Back() const
+	{
+		for (int word = NUM_PRIORITIES / 32 - 1; word >= 0; --word)
+		{
+			if (usedPriorities[word] != 0)
+				return tails[word * 32 + Common::HighestSetBit(usedPriorities[word])];
+		}
+		return -1;
+	}
+
+	int AllocNode()
+	{
+		int i = freeNodes;
+		if (i != -1)
+			freeNodes = nodes[i].next;
+		else
+		{
+			i = (int)nodes.size();
+			nodes.push_back(Node());
+		}
+		++count;
+		return i;
+	}
+
+	void Link(int i, int priority)
+	{
+		Node &n = nodes[i];
+		n.priority = priority;
+		n.order = nextOrder++;
+		n.byThreadIt = byThread.insert(std::make_pair(__KernelWaitInfoThreadID(n.info), i));
+		n.prev = tails[priority] != -1 ? tails[priority] : LastBefore(priority);
+		n.next = n.prev != -1 ? nodes[n.prev].next : first;
+
+		if (n.prev != -1)
+			nodes[n.prev].next = i;
+		else
+			first = i;
+		if (n.next != -1)
+			nodes[n.next].prev = i;
+
+		tails[priority] = i;
+		usedPriorities[priority / 32] |= 1U << (priority & 31);
+	}
+
+	void Unlink(int i)
+	{
+		Node &n = nodes[i];
+		if (tails[n.priority] == i)
+		{
+			if (n.prev != -1 && nodes[n.prev].priority == n.priority)
+				tails[n.priority] = n.prev;
+			else
+			{
+				tails[n.priority] = -1;
+				usedPriorities[n.priority / 32] &= ~(1U << (n.priority & 31));
+			}
+		}
+
+		if (n.prev != -1)
+			nodes[n.prev].next = n.next;
+		else
+			first = n.next;
+		if (n.next != -1)
+			nodes[n.next].prev = n.prev;
+	}
+
+	// Priorities aren't saved, so after loading a state they come from the threads again.
+	// The saved order is already the wake order, so this keeps it, and only raises a priority
+	// where that's needed for the runs of each priority to stay in order.
+	void RestorePriorities()
+	{
+		for (int p = 0; p < NUM_PRIORITIES; ++p)
+			tails[p] = -1;
+		memset(usedPriorities, 0, sizeof(usedPriorities));
+
+		int priority = 0;
+		for (int i = first; i != -1; i = nodes[i].next)
+		{
+			int threadPriority = PriorityIndex(__KernelGetThreadPrio(__KernelWaitInfoThreadID(nodes[i].info)));
+			if (threadPriority > priority)
+				priority = threadPriority;
+			nodes[i].priority = priority;
+			tails[priority] = i;
+			usedPriorities[priority / 32] |= 1U << (priority & 31);
+		}
+		prioritiesStale = false;
+	}
+
+	std::vector<Node> nodes;
+	ThreadMap byThread;
+	int first;
+	int freeNodes;
+	size_t count;
+	u64 nextOrder;
+	bool prioritiesStale;
+	int tails[NUM_PRIORITIES];
+	u32 usedPriorities[NUM_PRIORITIES / 32];
+};
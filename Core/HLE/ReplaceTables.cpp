@@ -0,0 +1,204 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+
+#include "HLE.h"
+#include "ReplaceTables.h"
+#include "../MemMap.h"
+#include "../MIPS/MIPS.h"
+#include "../MIPS/MIPSAnalyst.h"
+
+static int Replace_memcpy()
+{
+	u32 destPtr = PARAM(0);
+	u32 srcPtr = PARAM(1);
+	u32 bytes = PARAM(2);
+	if (bytes != 0)
+	{
+		if (Memory::IsValidRange(destPtr, bytes) && Memory::IsValidRange(srcPtr, bytes))
+			memmove(Memory::GetPointer(destPtr), Memory::GetPointer(srcPtr), bytes);
+		else
+		{
+			for (u32 i = 0; i < bytes; i++)
+				Memory::Write_U8(Memory::Read_U8(srcPtr + i), destPtr + i);
+		}
+	}
+	RETURN(destPtr);
+	return 10 + bytes / 4;
+}
+
+static int Replace_memset()
+{
+	u32 destPtr = PARAM(0);
+	u8 value = PARAM(1);
+	u32 bytes = PARAM(2);
+	if (bytes != 0)
+	{
+		if (Memory::IsValidRange(destPtr, bytes))
+			memset(Memory::GetPointer(destPtr), value, bytes);
+		else
+		{
+			for (u32 i = 0; i < bytes; i++)
+				Memory::Write_U8(value, destPtr + i);
+		}
+	}
+	RETURN(destPtr);
+	return 10 + bytes / 4;
+}
+
+static int Replace_strlen()
+{
+	u32 srcPtr = PARAM(0);
+	u32 len = 0;
+	while (Memory::Read_U8(srcPtr + len) != 0)
+		len++;
+	RETURN(len);
+	return 10 + len;
+}
+
+static int Replace_sqrtf()
+{
+	RETURNF(sqrtf(currentMIPS->f[12]));
+	return 40;
+}
+
+static int Replace_sinf()
+{
+	RETURNF(sinf(currentMIPS->f[12]));
+	return 80;
+}
+
+static int Replace_cosf()
+{
+	RETURNF(cosf(currentMIPS->f[12]));
+	return 80;
+}
+
+// Names as in the PSP SDK's newlib and libm.
+static const ReplacementTableEntry entries[] =
+{
+	{"memcpy", &Replace_memcpy},
+	{"memmove", &Replace_memcpy},
+	{"memset", &Replace_memset},
+	{"strlen", &Replace_strlen},
+	{"sqrtf", &Replace_sqrtf},
+	{"sinf", &Replace_sinf},
+	{"cosf", &Replace_cosf},
+};
+
+static const int numEntries = (int)(sizeof(entries) / sizeof(entries[0]));
+
+struct ReplacedFunction
+{
+	int index;
+	// Checked again when compiling, in case something else was loaded there since.
+	u32 hash;
+	u32 size;
+};
+
+static std::map<u32, ReplacedFunction> replacedFunctions;
+static u32 replacementHits[numEntries];
+
+void Replacement_Init()
+{
+	replacedFunctions.clear();
+	memset(replacementHits, 0, sizeof(replacementHits));
+}
+
+void Replacement_Shutdown()
+{
+	replacedFunctions.clear();
+}
+
+void Replacement_MatchFunctions()
+{
+	int matched = 0;
+	for (int i = 0; i < MIPSAnalyst::GetNumFunctions(); i++)
+	{
+		const char *name = MIPSAnalyst::GetFunctionName(i);
+		for (int j = 0; j < numEntries; j++)
+		{
+			if (strcmp(name, entries[j].name) != 0)
+				continue;
+
+			const u32 start = MIPSAnalyst::GetFunctionStart(i);
+			const u32 size = MIPSAnalyst::GetFunctionSize(i);
+			ReplacedFunction replaced = {j, MIPSAnalyst::HashFunction(start, size), size};
+			replacedFunctions[start] = replaced;
+			INFO_LOG(HLE, "Replacing %s at %08x with a native version", name, start);
+			matched++;
+			break;
+		}
+	}
+	if (matched != 0)
+		INFO_LOG(HLE, "Replaced %i guest functions", matched);
+}
+
+int GetReplacementFuncIndex(u32 address)
+{
+	std::map<u32, ReplacedFunction>::const_iterator iter = replacedFunctions.find(address);
+	if (iter == replacedFunctions.end())
+		return -1;
+	const ReplacedFunction &replaced = iter->second;
+	if (!Memory::IsValidRange(address, replaced.size) || MIPSAnalyst::HashFunction(address, replaced.size) != replaced.hash)
+		return -1;
+	return replaced.index;
+}
+
+void Replacement_ForgetFunctions(u32 startAddr, u32 endAddr)
+{
+	replacedFunctions.erase(replacedFunctions.lower_bound(startAddr), replacedFunctions.lower_bound(endAddr));
+}
+
+const ReplacementTableEntry *GetReplacementFunc(int index)
+{
+	return &entries[index];
+}
+
+u32 *GetReplacementHitCounter(int index)
+{
+	return &replacementHits[index];
+}
+
+static bool CompareHits(int a, int b)
+{
+	return replacementHits[a] > replacementHits[b];
+}
+
+void Replacement_GetStats(char *out, size_t outSize)
+{
+	int order[numEntries];
+	for (int i = 0; i < numEntries; i++)
+		order[i] = i;
+	std::sort(order, order + numEntries, CompareHits);
+
+	size_t pos = 0;
+	out[0] = 0;
+	for (int i = 0; i < numEntries && replacementHits[order[i]] != 0; i++)
+	{
+		int written = snprintf(out + pos, outSize - pos, "%s%s %u", pos == 0 ? "" : ", ", entries[order[i]].name, replacementHits[order[i]]);
+		if (written < 0 || pos + written >= outSize)
+			break;
+		pos += written;
+	}
+	if (pos == 0)
+		snprintf(out, outSize, "(none)");
+}
@@ -0,0 +1,55 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include "../../Globals.h"
+
+// Native stand-ins for hot guest library functions (memcpy, strlen, ...), statically
+// linked into most games.  The guest copies are found by name: from the ELF symbols,
+// or from the hash map MIPSAnalyst loads (see __KernelLoadKnownFunctions.)
+//
+// The JIT calls the replacement at the start of the function instead of compiling it,
+// then returns to $ra.
+
+// Takes its args from and returns in currentMIPS, like a syscall.  Returns the number
+// of cycles to charge for the call.
+typedef int (*ReplaceFunc)();
+
+struct ReplacementTableEntry
+{
+	const char *name;
+	ReplaceFunc replaceFunc;
+};
+
+void Replacement_Init();
+void Replacement_Shutdown();
+
+// Looks for replaceable functions among the ones MIPSAnalyst knows by name.
+void Replacement_MatchFunctions();
+// Drops the replacements starting in [startAddr, endAddr), for unloaded code.
+void Replacement_ForgetFunctions(u32 startAddr, u32 endAddr);
+
+// Returns -1 if the function starting at this address isn't replaced, or no longer
+// has the hash and size it had when it was matched.
+int GetReplacementFuncIndex(u32 address);
+const ReplacementTableEntry *GetReplacementFunc(int index);
+// Bumped by the JIT on each call, for the debug stats.
+u32 *GetReplacementHitCounter(int index);
+
+// Something like "memcpy 1234, strlen 56", most called first.
+void Replacement_GetStats(char *out, size_t outSize);
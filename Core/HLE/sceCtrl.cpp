@@ -166,18 +166,16 @@ void __CtrlSetAnalog(float x, float y)
 	ctrlCurrent.analog[1] = (u8)(-y * 127.f + 128.f);
 }
 
-int __CtrlReadSingleBuffer(u32 ctrlDataPtr, bool negative)
+int __CtrlReadSingleBuffer(PSPPointer<_ctrl_data> data, bool negative)
 {
-	_ctrl_data data;
-	if (Memory::IsValidAddress(ctrlDataPtr))
+	if (data.IsValid())
 	{
-		memcpy(&data, &ctrlBufs[ctrlBufRead], sizeof(_ctrl_data));
+		*data = ctrlBufs[ctrlBufRead];
 		ctrlBufRead = (ctrlBufRead + 1) % NUM_CTRL_BUFFERS;
 
 		if (negative)
-			data.buttons = ~data.buttons;
+			data->buttons = ~data->buttons;
 
-		Memory::WriteStruct(ctrlDataPtr, &data);
 		return 1;
 	}
 
@@ -204,10 +202,11 @@ int __CtrlReadBuffer(u32 ctrlDataPtr, u32 nBufs, bool negative, bool peek)
 	ctrlBufRead = (ctrlBuf - availBufs + NUM_CTRL_BUFFERS) % NUM_CTRL_BUFFERS;
 
 	int done = 0;
+	PSPPointer<_ctrl_data> data = PSPPointer<_ctrl_data>::Create(ctrlDataPtr);
 	for (u32 i = 0; i < availBufs; ++i)
 	{
-		done += __CtrlReadSingleBuffer(ctrlDataPtr, negative);
-		ctrlDataPtr += sizeof(_ctrl_data);
+		done += __CtrlReadSingleBuffer(data, negative);
+		data += 1;
 	}
 
 	if (peek)
@@ -235,7 +234,7 @@ retry:
 			goto retry;
 
 		u32 ctrlDataPtr = __KernelGetWaitValue(threadID, error);
-		int retVal = __CtrlReadSingleBuffer(ctrlDataPtr, wVal == CTRL_WAIT_NEGATIVE);
+		int retVal = __CtrlReadSingleBuffer(PSPPointer<_ctrl_data>::Create(ctrlDataPtr), wVal == CTRL_WAIT_NEGATIVE);
 		__KernelResumeThreadFromWait(threadID, retVal);
 	}
 }
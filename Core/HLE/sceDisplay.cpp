@@ -28,6 +28,7 @@
 #include "../Core/CoreParameter.h"
 #include "../MIPS/MIPS.h"
 #include "../HLE/HLE.h"
+#include "../HLE/ReplaceTables.h"
 #include "sceAudio.h"
 #include "../Host.h"
 #include "../Config.h"
@@ -37,6 +38,7 @@
 #include "sceKernel.h"
 #include "sceKernelThread.h"
 #include "sceKernelInterrupt.h"
+#include "../FileSystems/BlockDevices.h"
 
 // TODO: This file should not depend directly on GLES code.
 #include "../../GPU/GLES/Framebuffer.h"
@@ -211,10 +213,45 @@ float calculateFPS()
 	return fps;
 }
 
+// Over the last second, like the FPS.
+static void CalculateSliceStats(float &slicesPerSecond, float &eventsPerSlice)
+{
+	static u64 lastSlices = 0;
+	static u64 lastEvents = 0;
+	static double lastTime = 0.0;
+	static float lastSlicesPerSecond = 0.0f;
+	static float lastEventsPerSlice = 0.0f;
+
+	time_update();
+	double now = time_now_d();
+
+	if (now >= lastTime + 1.0)
+	{
+		u64 slices, events;
+		CoreTiming::GetSliceStats(slices, events);
+		if (slices > lastSlices)
+		{
+			lastSlicesPerSecond = (float)((slices - lastSlices) / (now - lastTime));
+			lastEventsPerSlice = (float)(events - lastEvents) / (float)(slices - lastSlices);
+		}
+
+		lastSlices = slices;
+		lastEvents = events;
+		lastTime = now;
+	}
+	slicesPerSecond = lastSlicesPerSecond;
+	eventsPerSlice = lastEventsPerSlice;
+}
+
 void DebugStats()
 {
 	gpu->UpdateStats();
 	char stats[2048];
+	char replaced[256];
+	Replacement_GetStats(replaced, sizeof(replaced));
+	float slicesPerSecond, eventsPerSlice;
+	CalculateSliceStats(slicesPerSecond, eventsPerSlice);
+	const u32 cacheLookups = blockDeviceStats.cacheHits + blockDeviceStats.cacheMisses;
 
 	sprintf(stats,
 		"Frames: %i\n"
@@ -222,6 +259,8 @@ void DebugStats()
 		"Kernel processing time: %0.2f ms\n"
 		"Slowest syscall: %s : %0.2f ms\n"
 		"Most active syscall: %s : %0.2f ms\n"
+		"Timing slices: %0.0f/s, events per slice: %0.2f\n"
+		"CSO cache: %u hits, %u misses (%0.1f%% hit), inflate time: %0.2f ms\n"
 		"Draw calls: %i, flushes %i\n"
 		"Cached Draw calls: %i\n"
 		"Num Tracked Vertex Arrays: %i\n"
@@ -233,7 +272,8 @@ void DebugStats()
 		"Texture invalidations: %i\n"
 		"Vertex shaders loaded: %i\n"
 		"Fragment shaders loaded: %i\n"
-		"Combined shaders loaded: %i\n",
+		"Combined shaders loaded: %i\n"
+		"Replaced functions: %s\n",
 		gpuStats.numFrames,
 		gpuStats.msProcessingDisplayLists * 1000.0f,
 		kernelStats.msInSyscalls * 1000.0f,
@@ -241,6 +281,12 @@ void DebugStats()
 		kernelStats.slowestSyscallTime * 1000.0f,
 		kernelStats.summedSlowestSyscallName ? kernelStats.summedSlowestSyscallName : "(none)",
 		kernelStats.summedSlowestSyscallTime * 1000.0f,
+		slicesPerSecond,
+		eventsPerSlice,
+		blockDeviceStats.cacheHits,
+		blockDeviceStats.cacheMisses,
+		cacheLookups == 0 ? 0.0f : (100.0f * blockDeviceStats.cacheHits) / cacheLookups,
+		blockDeviceStats.decompressTime * 1000.0f,
 		gpuStats.numDrawCalls,
 		gpuStats.numFlushes,
 		gpuStats.numCachedDrawCalls,
@@ -254,7 +300,8 @@ void DebugStats()
 		gpuStats.numTextureInvalidations,
 		gpuStats.numVertexShaders,
 		gpuStats.numFragmentShaders,
-		gpuStats.numShaders
+		gpuStats.numShaders,
+		replaced
 		);
 
 	float zoom = 0.3f; /// g_Config.iWindowZoom;
@@ -267,6 +314,7 @@ void DebugStats()
 
 	gpuStats.resetFrame();
 	kernelStats.ResetFrame();
+	blockDeviceStats.ResetFrame();
 }
 
 // Let's collect all the throttling and frameskipping logic here.
@@ -143,6 +143,7 @@ public:
 		sprintf(ptr, "Seekpos: %08x", (u32)pspFileSystem.GetSeekPos(handle));
 	}
 	static u32 GetMissingErrorCode() { return SCE_KERNEL_ERROR_BADF; }
+	static int GetStaticIDType() { return PPSSPP_KERNEL_TMID_File; }
 	int GetIDType() const { return PPSSPP_KERNEL_TMID_File; }
 
 	virtual void DoState(PointerWrap &p) {
@@ -339,12 +340,11 @@ void __IoGetStat(SceIoStat *stat, PSPFileInfo &info) {
 }
 
 u32 sceIoGetstat(const char *filename, u32 addr) {
-	SceIoStat stat;
+	PSPPointer<SceIoStat> stat = PSPPointer<SceIoStat>::Create(addr);
 	PSPFileInfo info = pspFileSystem.GetFileInfo(filename);
 	if (info.exists) {
-		__IoGetStat(&stat, info);
-		if (Memory::IsValidAddress(addr)) {
-			Memory::WriteStruct(addr, &stat);
+		if (stat.IsValid()) {
+			__IoGetStat(&*stat, info);
 			DEBUG_LOG(HLE, "sceIoGetstat(%s, %08x) : sector = %08x", filename, addr, info.startSector);
 			return 0;
 		} else {
@@ -408,7 +408,7 @@ u32 sceIoRead(int id, u32 data_addr, int size) {
 			return ERROR_KERNEL_BAD_FILE_DESCRIPTOR;
 		}
 		else if (Memory::IsValidAddress(data_addr)) {
-			u8 *data = (u8*) Memory::GetPointer(data_addr);
+			u8 *data = Memory::GetPointerUnchecked(data_addr);
 			if(f->npdrm){
 				f->asyncResult = (u32) npdrmRead(f, data, size);
 			}else{
@@ -1091,6 +1091,7 @@ public:
 	const char *GetName() {return name.c_str();}
 	const char *GetTypeName() {return "DirListing";}
 	static u32 GetMissingErrorCode() { return SCE_KERNEL_ERROR_BADF; }
+	static int GetStaticIDType() { return PPSSPP_KERNEL_TMID_DirList; }
 	int GetIDType() const { return PPSSPP_KERNEL_TMID_DirList; }
 
 	virtual void DoState(PointerWrap &p) {
@@ -1135,7 +1136,11 @@ u32 sceIoDread(int id, u32 dirent_addr) {
 	u32 error;
 	DirListing *dir = kernelObjects.Get<DirListing>(id, error);
 	if (dir) {
-		SceIoDirEnt *entry = (SceIoDirEnt*) Memory::GetPointer(dirent_addr);
+		PSPPointer<SceIoDirEnt> entry = PSPPointer<SceIoDirEnt>::Create(dirent_addr);
+		if (!entry.IsValid()) {
+			ERROR_LOG(HLE, "sceIoDread(%d, %08x): bad address", id, dirent_addr);
+			return SCE_KERNEL_ERROR_ILLEGAL_ADDR;
+		}
 
 		if (dir->index == (int) dir->listing.size()) {
 			DEBUG_LOG(HLE, "sceIoDread( %d %08x ) - end of the line", id, dirent_addr);
@@ -334,8 +334,9 @@ int sceKernelDcacheWritebackInvalidateAll()
 u32 sceKernelIcacheInvalidateAll()
 {
 #ifdef LOG_CACHE
-	NOTICE_LOG(CPU, "Icache invalidated - should clear JIT someday");
+	NOTICE_LOG(CPU, "Icache invalidated");
 #endif
+	currentMIPS->InvalidateICache(0, 0xFFFFFFFF);
 	return 0;
 }
 
@@ -343,35 +344,151 @@ u32 sceKernelIcacheInvalidateAll()
 u32 sceKernelIcacheClearAll()
 {
 #ifdef LOG_CACHE
-	NOTICE_LOG(CPU, "Icache cleared - should clear JIT someday");
+	NOTICE_LOG(CPU, "Icache cleared");
 #endif
-	DEBUG_LOG(CPU, "Icache cleared - should clear JIT someday");
+	DEBUG_LOG(CPU, "Icache cleared");
+	currentMIPS->InvalidateICache(0, 0xFFFFFFFF);
+	return 0;
+}
+
+int sceKernelIcacheInvalidateRange(u32 addr, int size)
+{
+#ifdef LOG_CACHE
+	NOTICE_LOG(CPU, "sceKernelIcacheInvalidateRange(%08x, %i)", addr, size);
+#endif
+	if (size < 0)
+		return SCE_KERNEL_ERROR_INVALID_SIZE;
+
+	if (size > 0 && addr != 0) {
+		currentMIPS->InvalidateICache(addr, size);
+	}
 	return 0;
 }
 
 KernelObjectPool::KernelObjectPool()
 {
 	memset(occupied, 0, sizeof(bool)*maxCount);
+	Clear();
 }
 
 SceUID KernelObjectPool::Create(KernelObject *obj, int rangeBottom, int rangeTop)
 {
 	if (rangeTop > maxCount)
 		rangeTop = maxCount;
-	for (int i = rangeBottom; i < rangeTop; i++)
+	int i = FindFreeSlot(rangeBottom, rangeTop);
+	if (i != -1)
 	{
-		if (!occupied[i])
-		{
-			occupied[i] = true;
-			pool[i] = obj;
-			pool[i]->uid = i + handleOffset;
-			return i + handleOffset;
-		}
+		Occupy(i, obj);
+		return i + handleOffset;
 	}
 	_dbg_assert_(HLE, 0);
 	return 0;
 }
 
+// The lowest free slot in the range, or -1.  Same as looking at each in turn, but skips full words.
+int KernelObjectPool::FindFreeSlot(int rangeBottom, int rangeTop) const
+{
+	if (rangeBottom < 0)
+		rangeBottom = 0;
+	if (rangeBottom >= rangeTop)
+		return -1;
+
+	int word = rangeBottom / 32;
+	u32 bits = freeSlots[word] & (0xFFFFFFFF << (rangeBottom & 31));
+	if (bits == 0)
+	{
+		const int firstWord = word + 1;
+		word = -1;
+		for (int group = firstWord / 32; group < maxCount / 32 / 32; ++group)
+		{
+			u32 groupBits = freeSlotWords[group];
+			if (group == firstWord / 32)
+				groupBits &= 0xFFFFFFFF << (firstWord & 31);
+			if (groupBits != 0)
+			{
+				word = group * 32 + Common::LowestSetBit(groupBits);
+				break;
+			}
+		}
+		if (word == -1)
+			return -1;
+		bits = freeSlots[word];
+	}
+
+	int i = word * 32 + Common::LowestSetBit(bits);
+	return i < rangeTop ? i : -1;
+}
+
+void KernelObjectPool::Occupy(int index, KernelObject *obj)
+{
+	occupied[index] = true;
+	pool[index] = obj;
+	pool[index]->uid = index + handleOffset;
+	++count;
+
+	freeSlots[index / 32] &= ~(1U << (index & 31));
+	if (freeSlots[index / 32] == 0)
+		freeSlotWords[index / 1024] &= ~(1U << ((index / 32) & 31));
+
+	// Add to the end of the list for its type.  The first object's prev is the last one.
+	const int type = obj->GetIDType();
+	types[index] = type;
+	nextOfType[index] = -1;
+	std::map<int, int>::iterator first = firstOfType.find(type);
+	if (first == firstOfType.end())
+	{
+		firstOfType[type] = index;
+		prevOfType[index] = index;
+	}
+	else
+	{
+		int last = prevOfType[first->second];
+		nextOfType[last] = index;
+		prevOfType[index] = last;
+		prevOfType[first->second] = index;
+	}
+}
+
+void KernelObjectPool::Release(int index)
+{
+	occupied[index] = false;
+	pool[index] = 0;
+	--count;
+
+	freeSlots[index / 32] |= 1U << (index & 31);
+	freeSlotWords[index / 1024] |= 1U << ((index / 32) & 31);
+
+	std::map<int, int>::iterator first = firstOfType.find(types[index]);
+	const int prev = prevOfType[index];
+	const int next = nextOfType[index];
+	if (first->second == index)
+	{
+		if (next == -1)
+			firstOfType.erase(first);
+		else
+		{
+			prevOfType[next] = prev;
+			first->second = next;
+		}
+	}
+	else
+	{
+		nextOfType[prev] = next;
+		if (next != -1)
+			prevOfType[next] = prev;
+		else
+			prevOfType[first->second] = prev;
+	}
+}
+
+SceUID KernelObjectPool::GetFirstOfType(int type) const
+{
+	std::map<int, int>::const_iterator first = firstOfType.find(type);
+	if (first == firstOfType.end())
+		return 0;
+	return first->second + handleOffset;
+}
+
 bool KernelObjectPool::IsValid(SceUID handle)
 {
 	int index = handle - handleOffset;
@@ -393,6 +510,11 @@ void KernelObjectPool::Clear()
 		occupied[i]=false;
 	}
 	memset(pool, 0, sizeof(KernelObject*)*maxCount);
+
+	count = 0;
+	firstOfType.clear();
+	memset(freeSlots, 0xFF, sizeof(freeSlots));
+	memset(freeSlotWords, 0xFF, sizeof(freeSlotWords));
 }
 
 KernelObject *&KernelObjectPool::operator [](SceUID handle)
@@ -423,12 +545,6 @@ void KernelObjectPool::List()
 
 int KernelObjectPool::GetCount()
 {
-	int count = 0;
-	for (int i=0; i<maxCount; i++)
-	{
-		if (occupied[i])
-			count++;
-	}
 	return count;
 }
 
@@ -453,12 +569,14 @@ void KernelObjectPool::DoState(PointerWrap &p)
 		if (p.mode == p.MODE_READ)
 		{
 			p.Do(type);
-			pool[i] = CreateByIDType(type);
-			pool[i]->uid = i + handleOffset;
+			KernelObject *obj = CreateByIDType(type);
 
 			// Already logged an error.
-			if (pool[i] == NULL)
+			if (obj == NULL)
 				return;
+
+			// Goes through the same bookkeeping as Create().
+			Occupy(i, obj);
 		}
 		else
 		{
@@ -307,6 +307,7 @@ int sceKernelDcacheWritebackInvalidateAll();
 void sceKernelGetThreadStackFreeSize();
 u32 sceKernelIcacheInvalidateAll();
 u32 sceKernelIcacheClearAll();
+int sceKernelIcacheInvalidateRange(u32 addr, int size);
 
 #define KERNELOBJECT_MAX_NAME_LENGTH 31
 
@@ -324,8 +325,9 @@ public:
 	virtual int GetIDType() const = 0;
 	virtual void GetQuickInfo(char *ptr, int size) {strcpy(ptr,"-");}
 
-	// Implement this in all subclasses:
+	// Implement these in all subclasses:
 	// static u32 GetMissingErrorCode()
+	// static int GetStaticIDType()
 
 	virtual void DoState(PointerWrap &p)
 	{
@@ -351,8 +353,9 @@ public:
 		u32 error;
 		if (Get<T>(handle, error))
 		{
-			occupied[handle-handleOffset] = false;
-			delete pool[handle-handleOffset];
+			KernelObject *obj = pool[handle - handleOffset];
+			Release(handle - handleOffset);
+			delete obj;
 		}
 		return error;
 	};
@@ -370,32 +373,26 @@ public:
 		}
 		else
 		{
-			T* t = dynamic_cast<T*>(pool[handle - handleOffset]);
-			if (t == 0)
+			// The type was remembered when the object was added, so no need for a dynamic_cast.
+			if (types[handle - handleOffset] != T::GetStaticIDType())
 			{
 				ERROR_LOG(HLE, "Kernel: Wrong type object %i (%08x)", handle, handle);
 				outError = T::GetMissingErrorCode(); //FIX
 				return 0;
 			}
 			outError = SCE_KERNEL_ERROR_OK;
-			return t;
+			return static_cast<T *>(pool[handle - handleOffset]);
 		}
 	}
 
 	template <class T>
 	T* GetByModuleByEntryAddr(u32 entryAddr)
 	{
-		for (int i=0; i <4096; i++)
+		for (SceUID id = GetFirstOfType(T::GetStaticIDType()); id != 0; id = GetNextOfType(id))
 		{
-			T* t = dynamic_cast<T*>(pool[i]);
-
-			if (t)
-			{
-				if (t->nm.entry_addr == entryAddr)
-				{
-					return t;
-				}
-			}
+			T* t = static_cast<T *>(pool[id - handleOffset]);
+			if (t->nm.entry_addr == entryAddr)
+				return t;
 		}
 		return 0;
 	}
@@ -404,11 +401,20 @@ public:
 
 	bool GetIDType(SceUID handle, int *type) const
 	{
-		KernelObject *t = pool[handle - handleOffset];
-		*type = t->GetIDType();
+		if (handle < handleOffset || handle >= handleOffset+maxCount || !occupied[handle-handleOffset])
+			return false;
+		*type = types[handle - handleOffset];
 		return true;
 	}
 
+	// Walks the objects of one type, oldest first.  Both return 0 when there are no more.
+	SceUID GetFirstOfType(int type) const;
+	SceUID GetNextOfType(SceUID handle) const
+	{
+		int next = nextOfType[handle - handleOffset];
+		return next == -1 ? 0 : next + handleOffset;
+	}
+
 	KernelObject *&operator [](SceUID handle);
 	void List();
 	void Clear();
@@ -419,8 +425,24 @@ private:
 		maxCount=4096,
 		handleOffset=0x100
 	};
+
+	int FindFreeSlot(int rangeBottom, int rangeTop) const;
+	void Occupy(int index, KernelObject *obj);
+	void Release(int index);
+
 	KernelObject *pool[maxCount];
 	bool occupied[maxCount];
+	int count;
+
+	// Type of each object, and its neighbours in the list of objects of that type.
+	int types[maxCount];
+	int nextOfType[maxCount];
+	int prevOfType[maxCount];
+	std::map<int, int> firstOfType;
+
+	// A bit for each free slot, and a bit for each word of those with any bit set.
+	u32 freeSlots[maxCount / 32];
+	u32 freeSlotWords[maxCount / 32 / 32];
 };
 
 extern KernelObjectPool kernelObjects;
@@ -25,6 +25,7 @@
 #include "sceKernel.h"
 #include "sceKernelThread.h"
 #include "sceKernelEventFlag.h"
+#include "KernelWaitQueue.h"
 
 void __KernelEventFlagTimeout(u64 userdata, int cycleslate);
 
@@ -46,6 +47,11 @@ struct EventFlagTh
 	u32 outAddr;
 };
 
+inline SceUID __KernelWaitInfoThreadID(const EventFlagTh &th)
+{
+	return th.tid;
+}
+
 class EventFlag : public KernelObject
 {
 public:
@@ -62,18 +68,18 @@ public:
 	static u32 GetMissingErrorCode() {
 		return SCE_KERNEL_ERROR_UNKNOWN_EVFID;
 	}
+	static int GetStaticIDType() { return SCE_KERNEL_TMID_EventFlag; }
 	int GetIDType() const { return SCE_KERNEL_TMID_EventFlag; }
 
 	virtual void DoState(PointerWrap &p)
 	{
 		p.Do(nef);
-		EventFlagTh eft = {0};
-		p.Do(waitingThreads, eft);
+		p.Do(waitingThreads);
 		p.DoMarker("EventFlag");
 	}
 
 	NativeEventFlag nef;
-	std::vector<EventFlagTh> waitingThreads;
+	KernelWaitQueue<EventFlagTh> waitingThreads;
 };
 
 
@@ -161,13 +167,7 @@ bool __KernelUnlockEventFlagForThread(EventFlag *e, EventFlagTh &th, u32 &error,
 			Memory::Write_U32(e->nef.currentPattern, th.outAddr);
 	}
 
-	if (timeoutPtr != 0 && eventFlagWaitTimer != -1)
-	{
-		// Remove any event for this thread.
-		u64 cyclesLeft = CoreTiming::UnscheduleEvent(eventFlagWaitTimer, th.tid);
-		Memory::Write_U32((u32) cyclesToUs(cyclesLeft), timeoutPtr);
-	}
-
+	__KernelCancelWaitTimeout(eventFlagWaitTimer, th.tid, timeoutPtr);
 	__KernelResumeThreadFromWait(th.tid, result);
 	wokeThreads = true;
 	return true;
@@ -177,9 +177,8 @@ bool __KernelClearEventFlagThreads(EventFlag *e, int reason)
 {
 	u32 error;
 	bool wokeThreads = false;
-	std::vector<EventFlagTh>::iterator iter, end;
-	for (iter = e->waitingThreads.begin(), end = e->waitingThreads.end(); iter != end; ++iter)
-		__KernelUnlockEventFlagForThread(e, *iter, error, reason, wokeThreads);
+	for (int i = e->waitingThreads.begin(); i != e->waitingThreads.end(); i = e->waitingThreads.next(i))
+		__KernelUnlockEventFlagForThread(e, e->waitingThreads[i], error, reason, wokeThreads);
 	e->waitingThreads.clear();
 
 	return wokeThreads;
@@ -292,15 +291,12 @@ u32 sceKernelSetEventFlag(SceUID id, u32 bitsToSet)
 
 		e->nef.currentPattern |= bitsToSet;
 
-		for (size_t i = 0; i < e->waitingThreads.size(); ++i)
+		for (int i = e->waitingThreads.begin(); i != e->waitingThreads.end(); )
 		{
-			EventFlagTh *t = &e->waitingThreads[i];
-			if (__KernelUnlockEventFlagForThread(e, *t, error, 0, wokeThreads))
-			{
-				e->waitingThreads.erase(e->waitingThreads.begin() + i);
-				// Try the one that used to be in this place next.
-				--i;
-			}
+			if (__KernelUnlockEventFlagForThread(e, e->waitingThreads[i], error, 0, wokeThreads))
+				i = e->waitingThreads.erase(i);
+			else
+				i = e->waitingThreads.next(i);
 		}
 
 		if (wokeThreads)
@@ -327,21 +323,17 @@ void __KernelEventFlagTimeout(u64 userdata, int cycleslate)
 	EventFlag *e = kernelObjects.Get<EventFlag>(flagID, error);
 	if (e)
 	{
-		for (size_t i = 0; i < e->waitingThreads.size(); i++)
+		int i = e->waitingThreads.find(threadID);
+		if (i != e->waitingThreads.end())
 		{
-			EventFlagTh *t = &e->waitingThreads[i];
-			if (t->tid == threadID)
-			{
-				bool wokeThreads;
-
-				// This thread isn't waiting anymore, but we'll remove it from waitingThreads later.
-				// The reason is, if it times out, but what it was waiting on is DELETED prior to it
-				// actually running, it will get a DELETE result instead of a TIMEOUT.
-				// So, we need to remember it or we won't be able to mark it DELETE instead later.
-				__KernelUnlockEventFlagForThread(e, *t, error, SCE_KERNEL_ERROR_WAIT_TIMEOUT, wokeThreads);
-				e->nef.numWaitThreads--;
-				break;
-			}
+			bool wokeThreads;
+
+			// This thread isn't waiting anymore, but we'll remove it from waitingThreads later.
+			// The reason is, if it times out, but what it was waiting on is DELETED prior to it
+			// actually running, it will get a DELETE result instead of a TIMEOUT.
+			// So, we need to remember it or we won't be able to mark it DELETE instead later.
+			__KernelUnlockEventFlagForThread(e, e->waitingThreads[i], error, SCE_KERNEL_ERROR_WAIT_TIMEOUT, wokeThreads);
+			e->nef.numWaitThreads--;
 		}
 	}
 }
@@ -365,15 +357,7 @@ void __KernelSetEventFlagTimeout(EventFlag *e, u32 timeoutPtr)
 
 void __KernelEventFlagRemoveThread(EventFlag *e, SceUID threadID)
 {
-	for (size_t i = 0; i < e->waitingThreads.size(); i++)
-	{
-		EventFlagTh *t = &e->waitingThreads[i];
-		if (t->tid == threadID)
-		{
-			e->waitingThreads.erase(e->waitingThreads.begin() + i);
-			break;
-		}
-	}
+	e->waitingThreads.remove(threadID);
 }
 
 int sceKernelWaitEventFlag(SceUID id, u32 bits, u32 wait, u32 outBitsPtr, u32 timeoutPtr)
@@ -415,7 +399,7 @@ int sceKernelWaitEventFlag(SceUID id, u32 bits, u32 wait, u32 outBitsPtr, u32 ti
 			th.wait = wait;
 			// If < 5ms, sometimes hardware doesn't write this, but it's unpredictable.
 			th.outAddr = timeout == 0 ? 0 : outBitsPtr;
-			e->waitingThreads.push_back(th);
+			e->waitingThreads.push(th, false);
 
 			__KernelSetEventFlagTimeout(e, timeoutPtr);
 			__KernelWaitCurThread(WAITTYPE_EVENTFLAG, id, 0, timeoutPtr, false, "event flag waited");
@@ -468,7 +452,7 @@ int sceKernelWaitEventFlagCB(SceUID id, u32 bits, u32 wait, u32 outBitsPtr, u32
 			th.wait = wait;
 			// If < 5ms, sometimes hardware doesn't write this, but it's unpredictable.
 			th.outAddr = timeout == 0 ? 0 : outBitsPtr;
-			e->waitingThreads.push_back(th);
+			e->waitingThreads.push(th, false);
 
 			__KernelSetEventFlagTimeout(e, timeoutPtr);
 			__KernelWaitCurThread(WAITTYPE_EVENTFLAG, id, 0, timeoutPtr, true, "event flag waited");
@@ -21,6 +21,7 @@
 #include "HLE.h"
 #include "Core/CoreTiming.h"
 #include "ChunkFile.h"
+#include "KernelWaitQueue.h"
 
 #define SCE_KERNEL_MBA_THPRI 0x100
 #define SCE_KERNEL_MBA_MSPRI 0x400
@@ -33,6 +34,12 @@ struct MbxWaitingThread
 	SceUID first;
 	u32 second;
 };
+
+inline SceUID __KernelWaitInfoThreadID(const MbxWaitingThread &th)
+{
+	return th.first;
+}
+
 void __KernelMbxTimeout(u64 userdata, int cyclesLate);
 
 static int mbxWaitTimer = -1;
@@ -52,29 +59,13 @@ struct Mbx : public KernelObject
 	const char *GetName() {return nmb.name;}
 	const char *GetTypeName() {return "Mbx";}
 	static u32 GetMissingErrorCode() { return SCE_KERNEL_ERROR_UNKNOWN_MBXID; }
+	static int GetStaticIDType() { return SCE_KERNEL_TMID_Mbox; }
 	int GetIDType() const { return SCE_KERNEL_TMID_Mbox; }
 
 	void AddWaitingThread(SceUID id, u32 addr)
 	{
-		bool inserted = false;
-		if (nmb.attr & SCE_KERNEL_MBA_THPRI)
-		{
-			for (std::vector<MbxWaitingThread>::iterator it = waitingThreads.begin(); it != waitingThreads.end(); it++)
-			{
-				if (__KernelGetThreadPrio(id) < __KernelGetThreadPrio((*it).first))
-				{
-					MbxWaitingThread waiting = {id, addr};
-					waitingThreads.insert(it, waiting);
-					inserted = true;
-					break;
-				}
-			}
-		}
-		if (!inserted)
-		{
-			MbxWaitingThread waiting = {id, addr};
-			waitingThreads.push_back(waiting);
-		}
+		MbxWaitingThread waiting = {id, addr};
+		waitingThreads.push(waiting, (nmb.attr & SCE_KERNEL_MBA_THPRI) != 0);
 	}
 
 	inline void AddInitialMessage(u32 ptr)
@@ -165,14 +156,13 @@ struct Mbx : public KernelObject
 	virtual void DoState(PointerWrap &p)
 	{
 		p.Do(nmb);
-		MbxWaitingThread mwt = {0};
-		p.Do(waitingThreads, mwt);
+		p.Do(waitingThreads);
 		p.DoMarker("Mbx");
 	}
 
 	NativeMbx nmb;
 
-	std::vector<MbxWaitingThread> waitingThreads;
+	KernelWaitQueue<MbxWaitingThread> waitingThreads;
 };
 
 void __KernelMbxInit()
@@ -201,13 +191,7 @@ bool __KernelUnlockMbxForThread(Mbx *m, MbxWaitingThread &th, u32 &error, int re
 	if (waitID != m->GetUID())
 		return true;
 
-	if (timeoutPtr != 0 && mbxWaitTimer != -1)
-	{
-		// Remove any event for this thread.
-		u64 cyclesLeft = CoreTiming::UnscheduleEvent(mbxWaitTimer, th.first);
-		Memory::Write_U32((u32) cyclesToUs(cyclesLeft), timeoutPtr);
-	}
-
+	__KernelCancelWaitTimeout(mbxWaitTimer, th.first, timeoutPtr);
 	__KernelResumeThreadFromWait(th.first, result);
 	wokeThreads = true;
 	return true;
@@ -256,35 +240,7 @@ void __KernelWaitMbx(Mbx *m, u32 timeoutPtr)
 
 void __KernelMbxRemoveThread(Mbx *m, SceUID threadID)
 {
-	for (size_t i = 0; i < m->waitingThreads.size(); i++)
-	{
-		MbxWaitingThread *t = &m->waitingThreads[i];
-		if (t->first == threadID)
-		{
-			m->waitingThreads.erase(m->waitingThreads.begin() + i);
-			break;
-		}
-	}
-}
-
-std::vector<MbxWaitingThread>::iterator __KernelMbxFindPriority(std::vector<MbxWaitingThread> &waiting)
-{
-	_dbg_assert_msg_(HLE, !waiting.empty(), "__KernelMutexFindPriority: Trying to find best of no threads.");
-
-	std::vector<MbxWaitingThread>::iterator iter, end, best = waiting.end();
-	u32 best_prio = 0xFFFFFFFF;
-	for (iter = waiting.begin(), end = waiting.end(); iter != end; ++iter)
-	{
-		u32 iter_prio = __KernelGetThreadPrio(iter->first);
-		if (iter_prio < best_prio)
-		{
-			best = iter;
-			best_prio = iter_prio;
-		}
-	}
-
-	_dbg_assert_msg_(HLE, best != waiting.end(), "__KernelMutexFindPriority: Returning invalid best thread.");
-	return best;
+	m->waitingThreads.remove(threadID);
 }
 
 SceUID sceKernelCreateMbx(const char *name, u32 attr, u32 optAddr)
@@ -331,7 +287,7 @@ int sceKernelDeleteMbx(SceUID id)
 		DEBUG_LOG(HLE, "sceKernelDeleteMbx(%i)", id);
 
 		bool wokeThreads = false;
-		for (size_t i = 0; i < m->waitingThreads.size(); i++)
+		for (int i = m->waitingThreads.begin(); i != m->waitingThreads.end(); i = m->waitingThreads.next(i))
 			__KernelUnlockMbxForThread(m, m->waitingThreads[i], error, SCE_KERNEL_ERROR_WAIT_DELETE, wokeThreads);
 		m->waitingThreads.clear();
 
@@ -367,17 +323,11 @@ int sceKernelSendMbx(SceUID id, u32 packetAddr)
 	if (m->nmb.numMessages == 0)
 	{
 		bool wokeThreads = false;
-		std::vector<MbxWaitingThread>::iterator iter;
 		while (!wokeThreads && !m->waitingThreads.empty())
 		{
-			if ((m->nmb.attr & SCE_KERNEL_MBA_THPRI) != 0)
-				iter = __KernelMbxFindPriority(m->waitingThreads);
-			else
-				iter = m->waitingThreads.begin();
-
-			MbxWaitingThread t = *iter;
+			MbxWaitingThread t = m->waitingThreads.front();
 			__KernelUnlockMbxForThread(m, t, error, 0, wokeThreads);
-			m->waitingThreads.erase(iter);
+			m->waitingThreads.pop_front();
 
 			if (wokeThreads)
 			{
@@ -530,7 +480,7 @@ int sceKernelCancelReceiveMbx(SceUID id, u32 numWaitingThreadsAddr)
 	DEBUG_LOG(HLE, "sceKernelCancelReceiveMbx(%i, %08x): cancelling %d threads", id, numWaitingThreadsAddr, count);
 
 	bool wokeThreads = false;
-	for (size_t i = 0; i < m->waitingThreads.size(); i++)
+	for (int i = m->waitingThreads.begin(); i != m->waitingThreads.end(); i = m->waitingThreads.next(i))
 		__KernelUnlockMbxForThread(m, m->waitingThreads[i], error, SCE_KERNEL_ERROR_WAIT_CANCEL, wokeThreads);
 	m->waitingThreads.clear();
 
@@ -25,6 +25,7 @@
 #include "sceKernel.h"
 #include "sceKernelThread.h"
 #include "sceKernelMemory.h"
+#include "KernelWaitQueue.h"
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -68,6 +69,7 @@ struct FPL : public KernelObject
 	const char *GetName() {return nf.name;}
 	const char *GetTypeName() {return "FPL";}
 	static u32 GetMissingErrorCode() { return SCE_KERNEL_ERROR_UNKNOWN_FPLID; }
+	static int GetStaticIDType() { return SCE_KERNEL_TMID_Fpl; }
 	int GetIDType() const { return SCE_KERNEL_TMID_Fpl; }
 
 	int findFreeBlock() {
@@ -114,6 +116,11 @@ struct VplWaitingThread
 	u32 addrPtr;
 };
 
+inline SceUID __KernelWaitInfoThreadID(const VplWaitingThread &th)
+{
+	return th.threadID;
+}
+
 struct SceKernelVplInfo
 {
 	SceSize size;
@@ -129,6 +136,7 @@ struct VPL : public KernelObject
 	const char *GetName() {return nv.name;}
 	const char *GetTypeName() {return "VPL";}
 	static u32 GetMissingErrorCode() { return SCE_KERNEL_ERROR_UNKNOWN_VPLID; }
+	static int GetStaticIDType() { return SCE_KERNEL_TMID_Vpl; }
 	int GetIDType() const { return SCE_KERNEL_TMID_Vpl; }
 
 	VPL() : alloc(8) {}
@@ -137,15 +145,14 @@ struct VPL : public KernelObject
 	{
 		p.Do(nv);
 		p.Do(address);
-		VplWaitingThread dv = {0};
-		p.Do(waitingThreads, dv);
+		p.Do(waitingThreads);
 		alloc.DoState(p);
 		p.DoMarker("VPL");
 	}
 
 	SceKernelVplInfo nv;
 	u32 address;
-	std::vector<VplWaitingThread> waitingThreads;
+	KernelWaitQueue<VplWaitingThread> waitingThreads;
 	BlockAllocator alloc;
 };
 
@@ -410,6 +417,7 @@ public:
 		sprintf(ptr, "MemPart: %08x - %08x	size: %08x", address, address + sz, sz);
 	}
 	static u32 GetMissingErrorCode() { return SCE_KERNEL_ERROR_UNKNOWN_UID; }
+	static int GetStaticIDType() { return PPSSPP_KERNEL_TMID_PMB; }
 	int GetIDType() const { return PPSSPP_KERNEL_TMID_PMB; }
 
 	PartitionMemoryBlock(BlockAllocator *_alloc, const char *_name, u32 size, MemblockType type, u32 alignment)
@@ -802,13 +810,7 @@ bool __KernelUnlockVplForThread(VPL *vpl, VplWaitingThread &threadInfo, u32 &err
 		vpl->nv.numWaitThreads--;
 	}
 
-	if (timeoutPtr != 0 && vplWaitTimer != -1)
-	{
-		// Remove any event for this thread.
-		u64 cyclesLeft = CoreTiming::UnscheduleEvent(vplWaitTimer, threadID);
-		Memory::Write_U32((u32) cyclesToUs(cyclesLeft), timeoutPtr);
-	}
-
+	__KernelCancelWaitTimeout(vplWaitTimer, threadID, timeoutPtr);
 	__KernelResumeThreadFromWait(threadID, result);
 	wokeThreads = true;
 	return true;
@@ -816,28 +818,15 @@ bool __KernelUnlockVplForThread(VPL *vpl, VplWaitingThread &threadInfo, u32 &err
 
 void __KernelVplRemoveThread(VPL *vpl, SceUID threadID)
 {
-	for (size_t i = 0; i < vpl->waitingThreads.size(); i++)
-	{
-		VplWaitingThread *t = &vpl->waitingThreads[i];
-		if (t->threadID == threadID)
-		{
-			vpl->waitingThreads.erase(vpl->waitingThreads.begin() + i);
-			break;
-		}
-	}
-}
-
-bool __VplThreadSortPriority(VplWaitingThread thread1, VplWaitingThread thread2)
-{
-	return __KernelThreadSortPriority(thread1.threadID, thread2.threadID);
+	vpl->waitingThreads.remove(threadID);
 }
 
 bool __KernelClearVplThreads(VPL *vpl, int reason)
 {
 	u32 error;
 	bool wokeThreads = false;
-	for (auto iter = vpl->waitingThreads.begin(), end = vpl->waitingThreads.end(); iter != end; ++iter)
-		__KernelUnlockVplForThread(vpl, *iter, error, reason, wokeThreads);
+	for (int i = vpl->waitingThreads.begin(); i != vpl->waitingThreads.end(); i = vpl->waitingThreads.next(i))
+		__KernelUnlockVplForThread(vpl, vpl->waitingThreads[i], error, reason, wokeThreads);
 	vpl->waitingThreads.clear();
 
 	return wokeThreads;
@@ -1021,7 +1010,7 @@ int sceKernelAllocateVpl(SceUID uid, u32 size, u32 addrPtr, u32 timeoutPtr)
 				SceUID threadID = __KernelGetCurThread();
 				__KernelVplRemoveThread(vpl, threadID);
 				VplWaitingThread waiting = {threadID, addrPtr};
-				vpl->waitingThreads.push_back(waiting);
+				vpl->waitingThreads.push(waiting, (vpl->nv.attr & PSP_VPL_ATTR_PRIORITY) != 0);
 			}
 
 			__KernelSetVplTimeout(timeoutPtr);
@@ -1048,7 +1037,7 @@ int sceKernelAllocateVplCB(SceUID uid, u32 size, u32 addrPtr, u32 timeoutPtr)
 				SceUID threadID = __KernelGetCurThread();
 				__KernelVplRemoveThread(vpl, threadID);
 				VplWaitingThread waiting = {threadID, addrPtr};
-				vpl->waitingThreads.push_back(waiting);
+				vpl->waitingThreads.push(waiting, (vpl->nv.attr & PSP_VPL_ATTR_PRIORITY) != 0);
 			}
 
 			__KernelSetVplTimeout(timeoutPtr);
@@ -1081,18 +1070,13 @@ int sceKernelFreeVpl(SceUID uid, u32 addr)
 		if (vpl->alloc.FreeExact(addr))
 		{
 			// TODO: smallest priority
-			if ((vpl->nv.attr & PSP_VPL_ATTR_PRIORITY) != 0)
-				std::stable_sort(vpl->waitingThreads.begin(), vpl->waitingThreads.end(), __VplThreadSortPriority);
-
 			bool wokeThreads = false;
-retry:
-			for (auto iter = vpl->waitingThreads.begin(), end = vpl->waitingThreads.end(); iter != end; ++iter)
+			for (int i = vpl->waitingThreads.begin(); i != vpl->waitingThreads.end(); )
 			{
-				if (__KernelUnlockVplForThread(vpl, *iter, error, 0, wokeThreads))
-				{
-					vpl->waitingThreads.erase(iter);
-					goto retry;
-				}
+				if (__KernelUnlockVplForThread(vpl, vpl->waitingThreads[i], error, 0, wokeThreads))
+					i = vpl->waitingThreads.erase(i);
+				else
+					i = vpl->waitingThreads.next(i);
 			}
 
 			if (wokeThreads)
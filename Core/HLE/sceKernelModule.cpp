@@ -19,6 +19,7 @@
 #include <algorithm>
 
 #include "HLE.h"
+#include "ReplaceTables.h"
 #include "Common/FileUtil.h"
 #include "../Host.h"
 #include "../MIPS/MIPS.h"
@@ -29,6 +30,7 @@
 #include "../FileSystems/FileSystem.h"
 #include "../FileSystems/MetaFileSystem.h"
 #include "../Util/BlockAllocator.h"
+#include "../Config.h"
 #include "../PSPLoaders.h"
 #include "../System.h"
 #include "../MemMap.h"
@@ -156,6 +158,7 @@ public:
 			nm.entry_addr);
 	}
 	static u32 GetMissingErrorCode() { return SCE_KERNEL_ERROR_UNKNOWN_MODULE; }
+	static int GetStaticIDType() { return PPSSPP_KERNEL_TMID_Module; }
 	int GetIDType() const { return PPSSPP_KERNEL_TMID_Module; }
 
 	virtual void DoState(PointerWrap &p)
@@ -236,6 +239,26 @@ static SceUID mainModuleID;	// hack
 void __KernelModuleInit()
 {
 	actionAfterModule = __KernelRegisterActionType(AfterModuleEntryCall::Create);
+
+	// A new game (or a loadexec), the functions found so far are gone.
+	MIPSAnalyst::ResetFunctions();
+	Replacement_Init();
+}
+
+void __KernelLoadKnownFunctions(bool storeNamed)
+{
+	std::string hostPath;
+	if (pspFileSystem.GetHostPath("ms0:/PSP/SYSTEM/knownfuncs.dat", hostPath))
+	{
+		MIPSAnalyst::LoadHashMap(hostPath.c_str());
+		// Only for building the map, games shouldn't be writing to the memstick behind the user's back.
+		if (storeNamed && g_Config.bStoreKnownFunctions)
+		{
+			pspFileSystem.MkDir("ms0:/PSP/SYSTEM");
+			MIPSAnalyst::StoreHashMap(hostPath.c_str());
+		}
+	}
+	Replacement_MatchFunctions();
 }
 
 void __KernelModuleDoState(PointerWrap &p)
@@ -380,13 +403,18 @@ Module *__KernelLoadELFFromPtr(const u8 *ptr, u32 loadAddress, std::string *erro
 			if (!hasSymbols)
 			{
 				symbolMap.ResetSymbolMap();
-				MIPSAnalyst::ScanForFunctions(textStart, textStart+textSize);
 			}
 		}
 		else
 		{
 			dontadd = true;
 		}
+
+		// Even with symbols, so that the known functions get hashed and can be replaced.
+		MIPSAnalyst::ForgetFunctions(textStart, textStart+textSize);
+		Replacement_ForgetFunctions(textStart, textStart+textSize);
+		MIPSAnalyst::ScanForFunctions(textStart, textStart+textSize);
+		__KernelLoadKnownFunctions(hasSymbols);
 	}
 
 	INFO_LOG(LOADER,"Module %s: %08x %08x %08x", modinfo->name, modinfo->gp, modinfo->libent,modinfo->libstub);
@@ -560,6 +588,9 @@ Module *__KernelLoadELFFromPtr(const u8 *ptr, u32 loadAddress, std::string *erro
 
 	module->nm.entry_addr = reader.GetEntryPoint();
 
+	// Whatever was compiled from the memory this module now occupies is stale.
+	currentMIPS->InvalidateICache(module->memoryBlockAddr, userMemory.GetBlockSizeFromAddress(module->memoryBlockAddr));
+
 	if (newptr)
 	{
 		delete [] newptr;
@@ -878,6 +909,15 @@ u32 sceKernelUnloadModule(u32 moduleId)
 	if (!module)
 		return error;
 
+	if (module->memoryBlockAddr)
+	{
+		const u32 start = module->memoryBlockAddr;
+		const u32 size = userMemory.GetBlockSizeFromAddress(start);
+		currentMIPS->InvalidateICache(start, size);
+		// Whatever gets loaded here next shouldn't be named or replaced like this module's code.
+		MIPSAnalyst::ForgetFunctions(start, start + size);
+		Replacement_ForgetFunctions(start, start + size);
+	}
 	kernelObjects.Destroy<Module>(moduleId);
 	return 0;
 }
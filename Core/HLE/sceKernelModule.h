@@ -22,6 +22,9 @@
 
 KernelObject *__KernelModuleObject();
 void __KernelModuleDoState(PointerWrap &p);
+// Names functions from the hash map in ms0:/PSP/SYSTEM/knownfuncs.dat, and sets up replacements.
+// With storeNamed, the functions named by symbols are added to the map for later games.
+void __KernelLoadKnownFunctions(bool storeNamed = false);
 
 u32 __KernelGetModuleGP(SceUID module);
 bool __KernelLoadExec(const char *filename, SceKernelLoadExecParam *param, std::string *error_string);
@@ -20,6 +20,7 @@
 #include "sceKernelMsgPipe.h"
 #include "sceKernelThread.h"
 #include "ChunkFile.h"
+#include "KernelWaitQueue.h"
 
 #define SCE_KERNEL_MPA_THFIFO_S 0x0000
 #define SCE_KERNEL_MPA_THPRI_S  0x0100
@@ -50,11 +51,17 @@ struct MsgPipeWaitingThread
 	u32 transferredBytesAddr;
 };
 
+inline SceUID __KernelWaitInfoThreadID(const MsgPipeWaitingThread &th)
+{
+	return th.id;
+}
+
 struct MsgPipe : public KernelObject
 {
 	const char *GetName() {return nmp.name;}
 	const char *GetTypeName() {return "MsgPipe";}
 	static u32 GetMissingErrorCode() { return SCE_KERNEL_ERROR_UNKNOWN_MPPID; }
+	static int GetStaticIDType() { return SCE_KERNEL_TMID_Mpipe; }
 	int GetIDType() const { return SCE_KERNEL_TMID_Mpipe; }
 
 	MsgPipe() : buffer(NULL) {}
@@ -64,24 +71,10 @@ struct MsgPipe : public KernelObject
 			delete [] buffer;
 	}
 
-	void AddWaitingThread(std::vector<MsgPipeWaitingThread> &list, SceUID id, u32 addr, u32 size, int waitMode, u32 transferredBytesAddr, bool usePrio)
+	void AddWaitingThread(KernelWaitQueue<MsgPipeWaitingThread> &list, SceUID id, u32 addr, u32 size, int waitMode, u32 transferredBytesAddr, bool usePrio)
 	{
 		MsgPipeWaitingThread thread = { id, addr, size, size, waitMode, transferredBytesAddr };
-		if (usePrio)
-		{
-			for (std::vector<MsgPipeWaitingThread>::iterator it = list.begin(); it != list.end(); it++)
-			{
-				if (__KernelGetThreadPrio(id) >= __KernelGetThreadPrio((*it).id))
-				{
-					list.insert(it, thread);
-					break;
-				}
-			}
-		}
-		else
-		{
-			list.push_back(thread);
-		}
+		list.push(thread, usePrio);
 	}
 
 	void AddSendWaitingThread(SceUID id, u32 addr, u32 size, int waitMode, u32 transferredBytesAddr)
@@ -108,7 +101,7 @@ struct MsgPipe : public KernelObject
 			Memory::Write_U32(thread->bufSize, thread->transferredBytesAddr);
 			nmp.freeSize -= thread->bufSize;
 			__KernelResumeThreadFromWait(thread->id);
-			sendWaitingThreads.erase(sendWaitingThreads.begin());
+			sendWaitingThreads.pop_front();
 			CheckReceiveThreads();
 		}
 		else if (thread->waitMode == SCE_KERNEL_MPW_ASAP && nmp.freeSize != 0)
@@ -118,7 +111,7 @@ struct MsgPipe : public KernelObject
 			Memory::Write_U32(nmp.freeSize, thread->transferredBytesAddr);
 			nmp.freeSize = 0;
 			__KernelResumeThreadFromWait(thread->id);
-			receiveWaitingThreads.erase(receiveWaitingThreads.begin());
+			sendWaitingThreads.pop_front();
 			CheckReceiveThreads();
 		}
 	}
@@ -138,7 +131,7 @@ struct MsgPipe : public KernelObject
 			Memory::Write_U32(thread->bufSize, thread->transferredBytesAddr);
 			nmp.freeSize += thread->bufSize;
 			__KernelResumeThreadFromWait(thread->id);
-			receiveWaitingThreads.erase(receiveWaitingThreads.begin());
+			receiveWaitingThreads.pop_front();
 			CheckSendThreads();
 		}
 		else if (thread->waitMode == SCE_KERNEL_MPW_ASAP && nmp.freeSize != nmp.bufSize)
@@ -148,7 +141,7 @@ struct MsgPipe : public KernelObject
 			Memory::Write_U32(nmp.bufSize - nmp.freeSize, thread->transferredBytesAddr);
 			nmp.freeSize = nmp.bufSize;
 			__KernelResumeThreadFromWait(thread->id);
-			receiveWaitingThreads.erase(receiveWaitingThreads.begin());
+			receiveWaitingThreads.pop_front();
 			CheckSendThreads();
 		}
 	}
@@ -156,9 +149,8 @@ struct MsgPipe : public KernelObject
 	virtual void DoState(PointerWrap &p)
 	{
 		p.Do(nmp);
-		MsgPipeWaitingThread mpwt1 = {0}, mpwt2 = {0};
-		p.Do(sendWaitingThreads, mpwt1);
-		p.Do(receiveWaitingThreads, mpwt2);
+		p.Do(sendWaitingThreads);
+		p.Do(receiveWaitingThreads);
 		bool hasBuffer = buffer != NULL;
 		p.Do(hasBuffer);
 		if (hasBuffer)
@@ -172,8 +164,8 @@ struct MsgPipe : public KernelObject
 
 	NativeMsgPipe nmp;
 
-	std::vector<MsgPipeWaitingThread> sendWaitingThreads;
-	std::vector<MsgPipeWaitingThread> receiveWaitingThreads;
+	KernelWaitQueue<MsgPipeWaitingThread> sendWaitingThreads;
+	KernelWaitQueue<MsgPipeWaitingThread> receiveWaitingThreads;
 
 	u8 *buffer;
 };
@@ -224,11 +216,11 @@ void sceKernelDeleteMsgPipe()
 		RETURN(error);
 		return;
 	}
-	for (u32 i = 0; i < m->sendWaitingThreads.size(); i++)
+	for (int i = m->sendWaitingThreads.begin(); i != m->sendWaitingThreads.end(); i = m->sendWaitingThreads.next(i))
 	{
 		__KernelResumeThreadFromWait(m->sendWaitingThreads[i].id);
 	}
-	for (u32 i = 0; i < m->receiveWaitingThreads.size(); i++)
+	for (int i = m->receiveWaitingThreads.begin(); i != m->receiveWaitingThreads.end(); i = m->receiveWaitingThreads.next(i))
 	{
 		__KernelResumeThreadFromWait(m->receiveWaitingThreads[i].id);
 	}
@@ -254,7 +246,7 @@ void __KernelSendMsgPipe(MsgPipe *m, u32 sendBufAddr, u32 sendSize, int waitMode
 				{
 					Memory::Write_U32(thread->bufSize - thread->freeSize, thread->transferredBytesAddr);
 					__KernelResumeThreadFromWait(thread->id);
-					m->receiveWaitingThreads.erase(m->receiveWaitingThreads.begin());
+					m->receiveWaitingThreads.pop_front();
 				}
 				break;
 			}
@@ -263,7 +255,7 @@ void __KernelSendMsgPipe(MsgPipe *m, u32 sendBufAddr, u32 sendSize, int waitMode
 				Memory::Memcpy(thread->bufAddr + (thread->bufSize - thread->freeSize), Memory::GetPointer(curSendAddr), sendSize);
 				Memory::Write_U32(thread->bufSize, thread->transferredBytesAddr);
 				__KernelResumeThreadFromWait(thread->id);
-				m->receiveWaitingThreads.erase(m->receiveWaitingThreads.begin());
+				m->receiveWaitingThreads.pop_front();
 				curSendAddr += sendSize;
 				sendSize = 0;
 				break;
@@ -275,7 +267,7 @@ void __KernelSendMsgPipe(MsgPipe *m, u32 sendBufAddr, u32 sendSize, int waitMode
 				curSendAddr += thread->freeSize;
 				Memory::Write_U32(thread->bufSize, thread->transferredBytesAddr);
 				__KernelResumeThreadFromWait(thread->id);
-				m->receiveWaitingThreads.erase(m->receiveWaitingThreads.begin());
+				m->receiveWaitingThreads.pop_front();
 			}
 		}
 		// If there is still data to send and (we want to send all of it or we didn't send anything)
@@ -424,7 +416,7 @@ void __KernelReceiveMsgPipe(MsgPipe *m, u32 receiveBufAddr, u32 receiveSize, int
 				{
 					Memory::Write_U32(thread->bufSize - thread->freeSize, thread->transferredBytesAddr);
 					__KernelResumeThreadFromWait(thread->id);
-					m->sendWaitingThreads.erase(m->sendWaitingThreads.begin());
+					m->sendWaitingThreads.pop_front();
 				}
 				break;
 			}
@@ -434,7 +426,7 @@ void __KernelReceiveMsgPipe(MsgPipe *m, u32 receiveBufAddr, u32 receiveSize, int
 				Memory::Memcpy(curReceiveAddr, Memory::GetPointer(thread->bufAddr), receiveSize);
 				Memory::Write_U32(thread->bufSize, thread->transferredBytesAddr);
 				__KernelResumeThreadFromWait(thread->id);
-				m->sendWaitingThreads.erase(m->sendWaitingThreads.begin());
+				m->sendWaitingThreads.pop_front();
 				curReceiveAddr += receiveSize;
 				receiveSize = 0;
 				break;
@@ -447,7 +439,7 @@ void __KernelReceiveMsgPipe(MsgPipe *m, u32 receiveBufAddr, u32 receiveSize, int
 				curReceiveAddr += thread->bufSize - thread->freeSize;
 				Memory::Write_U32(thread->bufSize, thread->transferredBytesAddr);
 				__KernelResumeThreadFromWait(thread->id);
-				m->sendWaitingThreads.erase(m->sendWaitingThreads.begin());
+				m->sendWaitingThreads.pop_front();
 			}
 		}
 		// All data hasn't been received and (mode isn't ASAP or nothing was received)
@@ -593,17 +585,16 @@ void sceKernelCancelMsgPipe()
 	{
 		delete [] m->buffer;
 	}
-	u32 count;
-	for (count = 0; count < m->sendWaitingThreads.size(); count++)
+	for (int i = m->sendWaitingThreads.begin(); i != m->sendWaitingThreads.end(); i = m->sendWaitingThreads.next(i))
 	{
-		__KernelResumeThreadFromWait(m->sendWaitingThreads[count].id);
+		__KernelResumeThreadFromWait(m->sendWaitingThreads[i].id);
 	}
-	Memory::Write_U32(count, numSendThreadsAddr);
-	for (count = 0; count < m->receiveWaitingThreads.size(); count++)
+	Memory::Write_U32((u32) m->sendWaitingThreads.size(), numSendThreadsAddr);
+	for (int i = m->receiveWaitingThreads.begin(); i != m->receiveWaitingThreads.end(); i = m->receiveWaitingThreads.next(i))
 	{
-		__KernelResumeThreadFromWait(m->receiveWaitingThreads[count].id);
+		__KernelResumeThreadFromWait(m->receiveWaitingThreads[i].id);
 	}
-	Memory::Write_U32(count, numReceiveThreadsAddr);
+	Memory::Write_U32((u32) m->receiveWaitingThreads.size(), numReceiveThreadsAddr);
 	DEBUG_LOG(HLE, "sceKernelCancelMsgPipe(%i, %i, %i)", uid, numSendThreadsAddr, numReceiveThreadsAddr);
 	RETURN(0);
 }
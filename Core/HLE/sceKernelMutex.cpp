@@ -24,6 +24,7 @@
 #include "sceKernel.h"
 #include "sceKernelMutex.h"
 #include "sceKernelThread.h"
+#include "KernelWaitQueue.h"
 
 #define PSP_MUTEX_ATTR_FIFO 0
 #define PSP_MUTEX_ATTR_PRIORITY 0x100
@@ -63,18 +64,18 @@ struct Mutex : public KernelObject
 	const char *GetName() {return nm.name;}
 	const char *GetTypeName() {return "Mutex";}
 	static u32 GetMissingErrorCode() { return PSP_MUTEX_ERROR_NO_SUCH_MUTEX; }
+	static int GetStaticIDType() { return SCE_KERNEL_TMID_Mutex; }
 	int GetIDType() const { return SCE_KERNEL_TMID_Mutex; }
 
 	virtual void DoState(PointerWrap &p)
 	{
 		p.Do(nm);
-		SceUID dv = 0;
-		p.Do(waitingThreads, dv);
+		p.Do(waitingThreads);
 		p.DoMarker("Mutex");
 	}
 
 	NativeMutex nm;
-	std::vector<SceUID> waitingThreads;
+	KernelWaitQueue<SceUID> waitingThreads;
 };
 
 
@@ -121,18 +122,18 @@ struct LwMutex : public KernelObject
 	const char *GetName() {return nm.name;}
 	const char *GetTypeName() {return "LwMutex";}
 	static u32 GetMissingErrorCode() { return PSP_LWMUTEX_ERROR_NO_SUCH_LWMUTEX; }
+	static int GetStaticIDType() { return SCE_KERNEL_TMID_LwMutex; }
 	int GetIDType() const { return SCE_KERNEL_TMID_LwMutex; }
 
 	virtual void DoState(PointerWrap &p)
 	{
 		p.Do(nm);
-		SceUID dv = 0;
-		p.Do(waitingThreads, dv);
+		p.Do(waitingThreads);
 		p.DoMarker("LwMutex");
 	}
 
 	NativeLwMutex nm;
-	std::vector<SceUID> waitingThreads;
+	KernelWaitQueue<SceUID> waitingThreads;
 };
 
 static int mutexWaitTimer = -1;
@@ -211,26 +212,6 @@ void __KernelMutexEraseLock(Mutex *mutex)
 	mutex->nm.lockThread = -1;
 }
 
-std::vector<SceUID>::iterator __KernelMutexFindPriority(std::vector<SceUID> &waiting)
-{
-	_dbg_assert_msg_(HLE, !waiting.empty(), "__KernelMutexFindPriority: Trying to find best of no threads.");
-
-	std::vector<SceUID>::iterator iter, end, best = waiting.end();
-	u32 best_prio = 0xFFFFFFFF;
-	for (iter = waiting.begin(), end = waiting.end(); iter != end; ++iter)
-	{
-		u32 iter_prio = __KernelGetThreadPrio(*iter);
-		if (iter_prio < best_prio)
-		{
-			best = iter;
-			best_prio = iter_prio;
-		}
-	}
-
-	_dbg_assert_msg_(HLE, best != waiting.end(), "__KernelMutexFindPriority: Returning invalid best thread.");
-	return best;
-}
-
 int sceKernelCreateMutex(const char *name, u32 attr, int initialCount, u32 optionsPtr)
 {
 	if (!name)
@@ -291,13 +272,7 @@ bool __KernelUnlockMutexForThread(Mutex *mutex, SceUID threadID, u32 &error, int
 		__KernelMutexAcquireLock(mutex, wVal, threadID);
 	}
 
-	if (timeoutPtr != 0 && mutexWaitTimer != -1)
-	{
-		// Remove any event for this thread.
-		u64 cyclesLeft = CoreTiming::UnscheduleEvent(mutexWaitTimer, threadID);
-		Memory::Write_U32((u32) cyclesToUs(cyclesLeft), timeoutPtr);
-	}
-
+	__KernelCancelWaitTimeout(mutexWaitTimer, threadID, timeoutPtr);
 	__KernelResumeThreadFromWait(threadID, result);
 	return true;
 }
@@ -310,9 +285,8 @@ int sceKernelDeleteMutex(SceUID id)
 	if (mutex)
 	{
 		bool wokeThreads = false;
-		std::vector<SceUID>::iterator iter, end;
-		for (iter = mutex->waitingThreads.begin(), end = mutex->waitingThreads.end(); iter != end; ++iter)
-			wokeThreads |= __KernelUnlockMutexForThread(mutex, *iter, error, SCE_KERNEL_ERROR_WAIT_DELETE);
+		for (int i = mutex->waitingThreads.begin(); i != mutex->waitingThreads.end(); i = mutex->waitingThreads.next(i))
+			wokeThreads |= __KernelUnlockMutexForThread(mutex, mutex->waitingThreads[i], error, SCE_KERNEL_ERROR_WAIT_DELETE);
 
 		if (mutex->nm.lockThread != -1)
 			__KernelMutexEraseLock(mutex);
@@ -373,16 +347,10 @@ bool __KernelUnlockMutex(Mutex *mutex, u32 &error)
 	__KernelMutexEraseLock(mutex);
 
 	bool wokeThreads = false;
-	std::vector<SceUID>::iterator iter;
 	while (!wokeThreads && !mutex->waitingThreads.empty())
 	{
-		if ((mutex->nm.attr & PSP_MUTEX_ATTR_PRIORITY) != 0)
-			iter = __KernelMutexFindPriority(mutex->waitingThreads);
-		else
-			iter = mutex->waitingThreads.begin();
-
-		wokeThreads |= __KernelUnlockMutexForThread(mutex, *iter, error, 0);
-		mutex->waitingThreads.erase(iter);
+		wokeThreads |= __KernelUnlockMutexForThread(mutex, mutex->waitingThreads.front(), error, 0);
+		mutex->waitingThreads.pop_front();
 	}
 
 	if (!wokeThreads)
@@ -418,7 +386,7 @@ void __KernelMutexThreadEnd(SceUID threadID)
 	{
 		Mutex *mutex = kernelObjects.Get<Mutex>(waitingMutexID, error);
 		if (mutex)
-			mutex->waitingThreads.erase(std::remove(mutex->waitingThreads.begin(), mutex->waitingThreads.end(), threadID), mutex->waitingThreads.end());
+			mutex->waitingThreads.remove(threadID);
 	}
 
 	// Unlock all mutexes the thread had locked.
@@ -469,8 +437,8 @@ int sceKernelLockMutex(SceUID id, int count, u32 timeoutPtr)
 	{
 		SceUID threadID = __KernelGetCurThread();
 		// May be in a tight loop timing out (where we don't remove from waitingThreads yet), don't want to add duplicates.
-		if (std::find(mutex->waitingThreads.begin(), mutex->waitingThreads.end(), threadID) == mutex->waitingThreads.end())
-			mutex->waitingThreads.push_back(threadID);
+		if (!mutex->waitingThreads.contains(threadID))
+			mutex->waitingThreads.push(threadID, (mutex->nm.attr & PSP_MUTEX_ATTR_PRIORITY) != 0);
 		__KernelWaitMutex(mutex, timeoutPtr);
 		__KernelWaitCurThread(WAITTYPE_MUTEX, id, count, timeoutPtr, false, "mutex waited");
 
@@ -497,8 +465,8 @@ int sceKernelLockMutexCB(SceUID id, int count, u32 timeoutPtr)
 	{
 		SceUID threadID = __KernelGetCurThread();
 		// May be in a tight loop timing out (where we don't remove from waitingThreads yet), don't want to add duplicates.
-		if (std::find(mutex->waitingThreads.begin(), mutex->waitingThreads.end(), threadID) == mutex->waitingThreads.end())
-			mutex->waitingThreads.push_back(threadID);
+		if (!mutex->waitingThreads.contains(threadID))
+			mutex->waitingThreads.push(threadID, (mutex->nm.attr & PSP_MUTEX_ATTR_PRIORITY) != 0);
 		__KernelWaitMutex(mutex, timeoutPtr);
 		__KernelWaitCurThread(WAITTYPE_MUTEX, id, count, timeoutPtr, true, "mutex waited");
 
@@ -571,7 +539,7 @@ int sceKernelReferMutexStatus(SceUID id, u32 infoAddr)
 	if (Memory::Read_U32(infoAddr) != 0)
 	{
 		// Refresh and write
-		m->nm.numWaitThreads = m->waitingThreads.size();
+		m->nm.numWaitThreads = (int) m->waitingThreads.size();
 		Memory::WriteStruct(infoAddr, &m->nm);
 	}
 	return 0;
@@ -642,13 +610,7 @@ bool __KernelUnlockLwMutexForThread(LwMutex *mutex, NativeLwMutexWorkarea &worka
 		workarea.lockThread = threadID;
 	}
 
-	if (timeoutPtr != 0 && lwMutexWaitTimer != -1)
-	{
-		// Remove any event for this thread.
-		u64 cyclesLeft = CoreTiming::UnscheduleEvent(lwMutexWaitTimer, threadID);
-		Memory::Write_U32((u32) cyclesToUs(cyclesLeft), timeoutPtr);
-	}
-
+	__KernelCancelWaitTimeout(lwMutexWaitTimer, threadID, timeoutPtr);
 	__KernelResumeThreadFromWait(threadID, result);
 	return true;
 }
@@ -668,9 +630,8 @@ int sceKernelDeleteLwMutex(u32 workareaPtr)
 	if (mutex)
 	{
 		bool wokeThreads = false;
-		std::vector<SceUID>::iterator iter, end;
-		for (iter = mutex->waitingThreads.begin(), end = mutex->waitingThreads.end(); iter != end; ++iter)
-			wokeThreads |= __KernelUnlockLwMutexForThread(mutex, workarea, *iter, error, SCE_KERNEL_ERROR_WAIT_DELETE);
+		for (int i = mutex->waitingThreads.begin(); i != mutex->waitingThreads.end(); i = mutex->waitingThreads.next(i))
+			wokeThreads |= __KernelUnlockLwMutexForThread(mutex, workarea, mutex->waitingThreads[i], error, SCE_KERNEL_ERROR_WAIT_DELETE);
 		mutex->waitingThreads.clear();
 
 		workarea.clear();
@@ -746,16 +707,10 @@ bool __KernelUnlockLwMutex(NativeLwMutexWorkarea &workarea, u32 &error)
 	}
 
 	bool wokeThreads = false;
-	std::vector<SceUID>::iterator iter;
 	while (!wokeThreads && !mutex->waitingThreads.empty())
 	{
-		if ((mutex->nm.attr & PSP_MUTEX_ATTR_PRIORITY) != 0)
-			iter = __KernelMutexFindPriority(mutex->waitingThreads);
-		else
-			iter = mutex->waitingThreads.begin();
-
-		wokeThreads |= __KernelUnlockLwMutexForThread(mutex, workarea, *iter, error, 0);
-		mutex->waitingThreads.erase(iter);
+		wokeThreads |= __KernelUnlockLwMutexForThread(mutex, workarea, mutex->waitingThreads.front(), error, 0);
+		mutex->waitingThreads.pop_front();
 	}
 
 	if (!wokeThreads)
@@ -859,8 +814,8 @@ int sceKernelLockLwMutex(u32 workareaPtr, int count, u32 timeoutPtr)
 		{
 			SceUID threadID = __KernelGetCurThread();
 			// May be in a tight loop timing out (where we don't remove from waitingThreads yet), don't want to add duplicates.
-			if (std::find(mutex->waitingThreads.begin(), mutex->waitingThreads.end(), threadID) == mutex->waitingThreads.end())
-				mutex->waitingThreads.push_back(threadID);
+			if (!mutex->waitingThreads.contains(threadID))
+				mutex->waitingThreads.push(threadID, (mutex->nm.attr & PSP_MUTEX_ATTR_PRIORITY) != 0);
 			__KernelWaitLwMutex(mutex, timeoutPtr);
 			__KernelWaitCurThread(WAITTYPE_LWMUTEX, workarea.uid, count, timeoutPtr, false, "lwmutex waited");
 
@@ -895,8 +850,8 @@ int sceKernelLockLwMutexCB(u32 workareaPtr, int count, u32 timeoutPtr)
 		{
 			SceUID threadID = __KernelGetCurThread();
 			// May be in a tight loop timing out (where we don't remove from waitingThreads yet), don't want to add duplicates.
-			if (std::find(mutex->waitingThreads.begin(), mutex->waitingThreads.end(), threadID) == mutex->waitingThreads.end())
-				mutex->waitingThreads.push_back(threadID);
+			if (!mutex->waitingThreads.contains(threadID))
+				mutex->waitingThreads.push(threadID, (mutex->nm.attr & PSP_MUTEX_ATTR_PRIORITY) != 0);
 			__KernelWaitLwMutex(mutex, timeoutPtr);
 			__KernelWaitCurThread(WAITTYPE_LWMUTEX, workarea.uid, count, timeoutPtr, true, "lwmutex waited");
 
@@ -960,7 +915,7 @@ int __KernelReferLwMutexStatus(SceUID uid, u32 infoPtr)
 		// Refresh and write
 		m->nm.currentCount = workarea.lockLevel;
 		m->nm.lockThread = workarea.lockThread == 0 ? -1 : workarea.lockThread;
-		m->nm.numWaitThreads = m->waitingThreads.size();
+		m->nm.numWaitThreads = (int) m->waitingThreads.size();
 		Memory::WriteStruct(infoPtr, &m->nm);
 	}
 	return 0;
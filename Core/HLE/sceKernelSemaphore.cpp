@@ -15,7 +15,6 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
-#include <algorithm>
 #include "HLE.h"
 #include "../MIPS/MIPS.h"
 #include "Core/CoreTiming.h"
@@ -23,6 +22,7 @@
 #include "sceKernel.h"
 #include "sceKernelThread.h"
 #include "sceKernelSemaphore.h"
+#include "KernelWaitQueue.h"
 
 #define PSP_SEMA_ATTR_FIFO 0
 #define PSP_SEMA_ATTR_PRIORITY 0x100
@@ -56,18 +56,18 @@ struct Semaphore : public KernelObject
 	const char *GetTypeName() {return "Semaphore";}
 
 	static u32 GetMissingErrorCode() { return SCE_KERNEL_ERROR_UNKNOWN_SEMID; }
+	static int GetStaticIDType() { return SCE_KERNEL_TMID_Semaphore; }
 	int GetIDType() const { return SCE_KERNEL_TMID_Semaphore; }
 
 	virtual void DoState(PointerWrap &p)
 	{
 		p.Do(ns);
-		SceUID dv = 0;
-		p.Do(waitingThreads, dv);
+		p.Do(waitingThreads);
 		p.DoMarker("Semaphore");
 	}
 
 	NativeSemaphore ns;
-	std::vector<SceUID> waitingThreads;
+	KernelWaitQueue<SceUID> waitingThreads;
 };
 
 static int semaWaitTimer = -1;
@@ -110,13 +110,7 @@ bool __KernelUnlockSemaForThread(Semaphore *s, SceUID threadID, u32 &error, int
 		s->ns.numWaitThreads--;
 	}
 
-	if (timeoutPtr != 0 && semaWaitTimer != -1)
-	{
-		// Remove any event for this thread.
-		u64 cyclesLeft = CoreTiming::UnscheduleEvent(semaWaitTimer, threadID);
-		Memory::Write_U32((u32) cyclesToUs(cyclesLeft), timeoutPtr);
-	}
-
+	__KernelCancelWaitTimeout(semaWaitTimer, threadID, timeoutPtr);
 	__KernelResumeThreadFromWait(threadID, result);
 	wokeThreads = true;
 	return true;
@@ -128,9 +122,8 @@ bool __KernelClearSemaThreads(Semaphore *s, int reason)
 {
 	u32 error;
 	bool wokeThreads = false;
-	std::vector<SceUID>::iterator iter, end;
-	for (iter = s->waitingThreads.begin(), end = s->waitingThreads.end(); iter != end; ++iter)
-		__KernelUnlockSemaForThread(s, *iter, error, reason, wokeThreads);
+	for (int i = s->waitingThreads.begin(); i != s->waitingThreads.end(); i = s->waitingThreads.next(i))
+		__KernelUnlockSemaForThread(s, s->waitingThreads[i], error, reason, wokeThreads);
 	s->waitingThreads.clear();
 
 	return wokeThreads;
@@ -254,18 +247,13 @@ int sceKernelSignalSema(SceUID id, int signal)
 		s->ns.currentCount += signal;
 		DEBUG_LOG(HLE, "sceKernelSignalSema(%i, %i) (old: %i, new: %i)", id, signal, oldval, s->ns.currentCount);
 
-		if ((s->ns.attr & PSP_SEMA_ATTR_PRIORITY) != 0)
-			std::stable_sort(s->waitingThreads.begin(), s->waitingThreads.end(), __KernelThreadSortPriority);
-
 		bool wokeThreads = false;
-retry:
-		for (auto iter = s->waitingThreads.begin(), end = s->waitingThreads.end(); iter != end; ++iter)
+		for (int i = s->waitingThreads.begin(); i != s->waitingThreads.end(); )
 		{
-			if (__KernelUnlockSemaForThread(s, *iter, error, 0, wokeThreads))
-			{
-				s->waitingThreads.erase(iter);
-				goto retry;
-			}
+			if (__KernelUnlockSemaForThread(s, s->waitingThreads[i], error, 0, wokeThreads))
+				i = s->waitingThreads.erase(i);
+			else
+				i = s->waitingThreads.next(i);
 		}
 
 		if (wokeThreads)
@@ -341,8 +329,8 @@ int __KernelWaitSema(SceUID id, int wantedCount, u32 timeoutPtr, const char *bad
 
 			SceUID threadID = __KernelGetCurThread();
 			// May be in a tight loop timing out (where we don't remove from waitingThreads yet), don't want to add duplicates.
-			if (std::find(s->waitingThreads.begin(), s->waitingThreads.end(), threadID) == s->waitingThreads.end())
-				s->waitingThreads.push_back(threadID);
+			if (!s->waitingThreads.contains(threadID))
+				s->waitingThreads.push(threadID, (s->ns.attr & PSP_SEMA_ATTR_PRIORITY) != 0);
 			__KernelSetSemaTimeout(s, timeoutPtr);
 			__KernelWaitCurThread(WAITTYPE_SEMA, id, wantedCount, timeoutPtr, processCallbacks, "sema waited");
 		}
@@ -88,6 +88,7 @@ public:
 	}
 
 	static u32 GetMissingErrorCode() { return SCE_KERNEL_ERROR_UNKNOWN_CBID; }
+	static int GetStaticIDType() { return SCE_KERNEL_TMID_Callback; }
 	int GetIDType() const { return SCE_KERNEL_TMID_Callback; }
 
 	virtual void DoState(PointerWrap &p)
@@ -308,6 +309,7 @@ public:
 
 	static u32 GetMissingErrorCode() { return SCE_KERNEL_ERROR_UNKNOWN_THID; }
 
+	static int GetStaticIDType() { return SCE_KERNEL_TMID_Thread; }
 	int GetIDType() const { return SCE_KERNEL_TMID_Thread; }
 
 	bool AllocateStack(u32 &stackSize)
@@ -430,66 +432,163 @@ public:
 	u32 stackBlock;
 };
 
-// std::vector<SceUID> with push_front(), remove(), etc.
+// How the ready queue looks in save states (one of these per priority, in a std::map.)
 struct ThreadList
 {
 	std::vector<SceUID> list;
 
-	inline bool empty() const
+	void DoState(PointerWrap &p)
 	{
-		return list.empty();
+		p.Do(list);
 	}
+};
 
-	inline size_t size() const
+// One FIFO of ready threads per priority, and a bitmap of the non-empty ones, so finding
+// the next thread to run (or rotating a priority) doesn't walk anything.
+class ThreadQueueList
+{
+public:
+	enum { NUM_QUEUES = 128 };
+
+	ThreadQueueList()
 	{
-		return list.size();
+		clear();
 	}
 
-	inline SceUID &front()
+	inline bool empty(int priority) const
 	{
-		return list.front();
+		return queues[QueueIndex(priority)].count == 0;
 	}
 
-	inline void push_front(const SceUID threadID)
+	inline size_t size(int priority) const
 	{
-		if (empty())
-			push_back(threadID);
-		else
+		return queues[QueueIndex(priority)].count;
+	}
+
+	// The first thread of the best (lowest) priority, or -1 if no thread is ready.
+	SceUID first() const
+	{
+		for (int i = 0; i < NUM_QUEUES / 32; ++i)
 		{
-			size_t oldSize = list.size();
-			list.resize(oldSize + 1);
-			memmove(&list[1], &list[0], oldSize * sizeof(SceUID));
-			list[0] = threadID;
+			if (nonEmpty[i] != 0)
+			{
+				const Queue &q = queues[i * 32 + Common::LowestSetBit(nonEmpty[i])];
+				return q.data[q.head];
+			}
 		}
+		return -1;
+	}
+
+	void push_front(int priority, SceUID threadID)
+	{
+		const int index = QueueIndex(priority);
+		Queue &q = queues[index];
+		if (q.count == q.data.size())
+			Grow(q);
+		q.head = (q.head + q.data.size() - 1) % q.data.size();
+		q.data[q.head] = threadID;
+		q.count++;
+		nonEmpty[index / 32] |= 1U << (index & 31);
 	}
 
-	inline void push_back(const SceUID threadID)
+	void push_back(int priority, SceUID threadID)
 	{
-		list.push_back(threadID);
+		const int index = QueueIndex(priority);
+		Queue &q = queues[index];
+		if (q.count == q.data.size())
+			Grow(q);
+		q.data[(q.head + q.count) % q.data.size()] = threadID;
+		q.count++;
+		nonEmpty[index / 32] |= 1U << (index & 31);
 	}
 
-	inline void pop_front()
+	// Moves the first thread to the back.
+	void rotate(int priority)
 	{
-		size_t newSize = list.size() - 1;
-		list.resize(newSize);
-		if (newSize > 0)
-			memmove(&list[0], &list[1], newSize * sizeof(SceUID));
+		Queue &q = queues[QueueIndex(priority)];
+		if (q.count < 2)
+			return;
+		const SceUID first = q.data[q.head];
+		q.head = (q.head + 1) % q.data.size();
+		q.data[(q.head + q.count - 1) % q.data.size()] = first;
 	}
 
-	inline void pop_back()
+	void remove(int priority, SceUID threadID)
 	{
-		list.pop_back();
+		const int index = QueueIndex(priority);
+		Queue &q = queues[index];
+		size_t kept = 0;
+		for (size_t i = 0; i < q.count; ++i)
+		{
+			const SceUID id = q.data[(q.head + i) % q.data.size()];
+			if (id != threadID)
+				q.data[(q.head + kept++) % q.data.size()] = id;
+		}
+		q.count = kept;
+		if (q.count == 0)
+			nonEmpty[index / 32] &= ~(1U << (index & 31));
 	}
 
-	inline void remove(const SceUID threadID)
+	void clear()
 	{
-		list.erase(std::remove(list.begin(), list.end(), threadID), list.end());
+		for (int i = 0; i < NUM_QUEUES; ++i)
+		{
+			queues[i].data.clear();
+			queues[i].head = 0;
+			queues[i].count = 0;
+		}
+		memset(nonEmpty, 0, sizeof(nonEmpty));
 	}
 
 	void DoState(PointerWrap &p)
 	{
-		p.Do(list);
+		std::map<u32, ThreadList> saved;
+		for (int i = 0; i < NUM_QUEUES; ++i)
+		{
+			const Queue &q = queues[i];
+			for (size_t j = 0; j < q.count; ++j)
+				saved[i].list.push_back(q.data[(q.head + j) % q.data.size()]);
+		}
+
+		p.Do(saved);
+
+		if (p.mode == PointerWrap::MODE_READ)
+		{
+			clear();
+			for (std::map<u32, ThreadList>::iterator it = saved.begin(), end = saved.end(); it != end; ++it)
+			{
+				for (size_t j = 0; j < it->second.list.size(); ++j)
+					push_back(it->first, it->second.list[j]);
+			}
+		}
+	}
+
+private:
+	// A ring buffer, grown as needed.
+	struct Queue
+	{
+		std::vector<SceUID> data;
+		size_t head;
+		size_t count;
+	};
+
+	// Real priorities are 0x08-0x7F, games can still ask for bogus ones.
+	static inline int QueueIndex(int priority)
+	{
+		return priority < 0 ? 0 : (priority >= NUM_QUEUES ? NUM_QUEUES - 1 : priority);
+	}
+
+	static void Grow(Queue &q)
+	{
+		std::vector<SceUID> data(q.data.empty() ? 8 : q.data.size() * 2);
+		for (size_t i = 0; i < q.count; ++i)
+			data[i] = q.data[(q.head + i) % q.data.size()];
+		q.data.swap(data);
+		q.head = 0;
 	}
+
+	Queue queues[NUM_QUEUES];
+	u32 nonEmpty[NUM_QUEUES / 32];
 };
 
 void __KernelExecuteMipsCallOnCurrentThread(int callId, bool reschedAfter);
@@ -519,7 +618,7 @@ std::vector<ThreadCallback> threadEndListeners;
 std::vector<SceUID> threadqueue;
 
 // Lists only ready thread ids.
-std::map<u32, ThreadList> threadReadyQueue;
+ThreadQueueList threadReadyQueue;
 
 SceUID threadIdleID[2];
 
@@ -727,14 +826,14 @@ void __KernelChangeReadyState(Thread *thread, SceUID threadID, bool ready)
 	if (thread->isReady())
 	{
 		if (!ready)
-			threadReadyQueue[prio].remove(threadID);
+			threadReadyQueue.remove(prio, threadID);
 	}
 	else if (ready)
 	{
 		if (thread->isRunning())
-			threadReadyQueue[prio].push_front(threadID);
+			threadReadyQueue.push_front(prio, threadID);
 		else
-			threadReadyQueue[prio].push_back(threadID);
+			threadReadyQueue.push_back(prio, threadID);
 		thread->nt.status = THREADSTATUS_READY;
 	}
 }
@@ -987,8 +1086,20 @@ u32 sceKernelGetThreadmanIdList(u32 type, u32 readBufPtr, u32 readBufSize, u32 i
 	if (!Memory::IsValidAddress(readBufPtr))
 		return SCE_KERNEL_ERROR_ILLEGAL_ARGUMENT;
 
+	if (type > SCE_KERNEL_TMID_Thread && type <= SCE_KERNEL_TMID_LwMutex) {
+		u32 total = 0;
+		for (SceUID id = kernelObjects.GetFirstOfType(type); id != 0; id = kernelObjects.GetNextOfType(id))
+		{
+			if (total < readBufSize)
+				Memory::Write_U32(id, readBufPtr + total * 4);
+			++total;
+		}
+		Memory::Write_U32(total, idCountPtr);
+		return 0;
+	}
+
 	if (type != SCE_KERNEL_TMID_Thread) {
-		ERROR_LOG(HLE, "sceKernelGetThreadmanIdList only implemented for threads");
+		ERROR_LOG(HLE, "sceKernelGetThreadmanIdList only implemented for threads and sync objects");
 		return SCE_KERNEL_ERROR_ILLEGAL_ARGUMENT;
 	}
 
@@ -1191,7 +1302,7 @@ void __KernelRemoveFromThreadQueue(SceUID threadID)
 {
 	int prio = __KernelGetThreadPrio(threadID);
 	if (prio != 0)
-		threadReadyQueue[prio].remove(threadID);
+		threadReadyQueue.remove(prio, threadID);
 
 	threadqueue.erase(std::remove(threadqueue.begin(), threadqueue.end(), threadID), threadqueue.end());
 }
@@ -1228,16 +1339,7 @@ Thread *__KernelNextThread() {
 	if (cur && cur->isRunning())
 		__KernelChangeReadyState(cur, currentThread, true);
 
-	SceUID bestThread = -1;
-	// This goes in priority order.
-	for (auto it = threadReadyQueue.begin(), end = threadReadyQueue.end(); it != end; ++it)
-	{
-		if (!it->second.empty())
-		{
-			bestThread = it->second.front();
-			break;
-		}
-	}
+	SceUID bestThread = threadReadyQueue.first();
 
 	u32 error;
 	if (bestThread != -1)
@@ -1684,21 +1786,17 @@ int sceKernelRotateThreadReadyQueue(int priority)
 	if (priority <= 0x07 || priority > 0x77)
 		return SCE_KERNEL_ERROR_ILLEGAL_PRIORITY;
 
-	if (!threadReadyQueue[priority].empty())
+	if (!threadReadyQueue.empty(priority))
 	{
 		// In other words, yield to everyone else.
 		if (cur->nt.currentPriority == priority)
 		{
-			threadReadyQueue[priority].push_back(currentThread);
+			threadReadyQueue.push_back(priority, currentThread);
 			cur->nt.status = THREADSTATUS_READY;
 		}
 		// Yield the next thread of this priority to all other threads of same priority.
-		else if (threadReadyQueue[priority].size() > 1)
-		{
-			SceUID first = threadReadyQueue[priority].front();
-			threadReadyQueue[priority].pop_front();
-			threadReadyQueue[priority].push_back(first);
-		}
+		else
+			threadReadyQueue.rotate(priority);
 
 		hleReSchedule("rotatethreadreadyqueue");
 	}
@@ -1837,12 +1935,12 @@ void sceKernelChangeThreadPriority()
 		DEBUG_LOG(HLE,"sceKernelChangeThreadPriority(%i, %i)", id, PARAM(1));
 
 		int prio = thread->nt.currentPriority;
-		threadReadyQueue[prio].remove(id);
+		threadReadyQueue.remove(prio, id);
 
 		thread->nt.currentPriority = PARAM(1);
 
 		if (thread->isReady())
-			threadReadyQueue[thread->nt.currentPriority].push_back(id);
+			threadReadyQueue.push_back(thread->nt.currentPriority, id);
 
 		RETURN(0);
 	}
@@ -1926,11 +2024,6 @@ u32 __KernelGetThreadPrio(SceUID id)
 	return 0;
 }
 
-bool __KernelThreadSortPriority(SceUID thread1, SceUID thread2)
-{
-	return __KernelGetThreadPrio(thread1) < __KernelGetThreadPrio(thread2);
-}
-
 //////////////////////////////////////////////////////////////////////////
 // WAIT/SLEEP ETC
 //////////////////////////////////////////////////////////////////////////
@@ -162,7 +162,6 @@ void __KernelSetupRootThread(SceUID moduleId, int args, const char *argp, int pr
 void __KernelStartIdleThreads();
 void __KernelReturnFromThread();  // Called as HLE function
 u32 __KernelGetThreadPrio(SceUID id);
-bool __KernelThreadSortPriority(SceUID thread1, SceUID thread2);
 
 void __KernelIdle();
 
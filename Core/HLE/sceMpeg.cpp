@@ -797,7 +797,8 @@ u32 sceMpegUnRegistStream(u32 mpeg, int streamUid)
 
 int sceMpegAvcDecodeDetail(u32 mpeg, u32 detailAddr)
 {
-	if (!Memory::IsValidAddress(detailAddr))
+	PSPPointer<u32> detail = PSPPointer<u32>::Create(detailAddr);
+	if (!detail.IsValid(9))
 	{
 		WARN_LOG(HLE, "sceMpegAvcDecodeDetail(%08x, %08x): invalid detailAddr", mpeg, detailAddr);
 		return -1;
@@ -811,15 +812,15 @@ int sceMpegAvcDecodeDetail(u32 mpeg, u32 detailAddr)
 
 	DEBUG_LOG(HLE, "sceMpegAvcDecodeDetail(%08x, %08x)", mpeg, detailAddr);
 
-	Memory::Write_U32(ctx->avc.avcDecodeResult, detailAddr + 0);
-	Memory::Write_U32(ctx->videoFrameCount, detailAddr + 4);
-	Memory::Write_U32(ctx->avc.avcDetailFrameWidth, detailAddr + 8);
-	Memory::Write_U32(ctx->avc.avcDetailFrameHeight, detailAddr + 12);
-	Memory::Write_U32(0, detailAddr + 16);
-	Memory::Write_U32(0, detailAddr + 20);
-	Memory::Write_U32(0, detailAddr + 24);
-	Memory::Write_U32(0, detailAddr + 28);
-	Memory::Write_U32(ctx->avc.avcFrameStatus, detailAddr + 32);
+	detail[0] = ctx->avc.avcDecodeResult;
+	detail[1] = ctx->videoFrameCount;
+	detail[2] = ctx->avc.avcDetailFrameWidth;
+	detail[3] = ctx->avc.avcDetailFrameHeight;
+	detail[4] = 0;
+	detail[5] = 0;
+	detail[6] = 0;
+	detail[7] = 0;
+	detail[8] = ctx->avc.avcFrameStatus;
 	return 0;
 }
 
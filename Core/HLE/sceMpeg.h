@@ -60,16 +60,30 @@ struct SceMpegAu {
 	u32 esBuffer;
 	u32 esSize;
 
+	// The PSP stores the timestamps high word first.  Accessed as words, since guest AUs may
+	// only be 4-byte aligned.
 	void read(u32 addr) {
-		Memory::ReadStruct(addr, this);
-		pts = (pts & 0xFFFFFFFFULL) << 32 | (pts >> 32);
-		dts = (dts & 0xFFFFFFFFULL) << 32 | (dts >> 32);
+		PSPPointer<u32> au = PSPPointer<u32>::Create(addr);
+		if (!au.IsValid(6)) {
+			memset(this, 0, sizeof(*this));
+			return;
+		}
+		pts = (s64)(((u64)au[0] << 32) | au[1]);
+		dts = (s64)(((u64)au[2] << 32) | au[3]);
+		esBuffer = au[4];
+		esSize = au[5];
 	}
 
-	void write(u32 addr) {
-		pts = (pts & 0xFFFFFFFFULL) << 32 | (pts >> 32);
-		dts = (dts & 0xFFFFFFFFULL) << 32 | (dts >> 32);
-		Memory::WriteStruct(addr, this);
+	void write(u32 addr) const {
+		PSPPointer<u32> au = PSPPointer<u32>::Create(addr);
+		if (!au.IsValid(6))
+			return;
+		au[0] = (u32)((u64)pts >> 32);
+		au[1] = (u32)pts;
+		au[2] = (u32)((u64)dts >> 32);
+		au[3] = (u32)dts;
+		au[4] = esBuffer;
+		au[5] = esSize;
 	}
 };
 
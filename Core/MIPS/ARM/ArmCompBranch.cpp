@@ -15,6 +15,7 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 #include "../../HLE/HLE.h"
+#include "../../Config.h"
 
 #include "../MIPS.h"
 #include "../MIPSCodeUtils.h"
@@ -56,6 +57,7 @@ void Jit::BranchRSRTComp(u32 op, ArmGen::CCFlags cc, bool likely)
 	int rt = _RT;
 	int rs = _RS;
 	u32 targetAddr = js.compilerPC + offset + 4;
+	bool idleLoop = jo.skipIdleLoops && targetAddr <= js.compilerPC && IsIdleLoop(js.compilerPC);
 		
 	u32 delaySlotOp = Memory::ReadUnchecked_U32(js.compilerPC+4);
 	bool delaySlotIsNice = IsDelaySlotNiceReg(op, delaySlotOp, rt, rs);
@@ -98,7 +100,10 @@ void Jit::BranchRSRTComp(u32 op, ArmGen::CCFlags cc, bool likely)
   }
 
   // Take the branch
-  WriteExit(targetAddr, 0);
+	if (idleLoop)
+		WriteIdleLoopExit(targetAddr);
+	else
+		WriteExit(targetAddr, 0);
 
   SetJumpTarget(ptr);
   // Not taken
@@ -117,6 +122,7 @@ void Jit::BranchRSZeroComp(u32 op, ArmGen::CCFlags cc, bool andLink, bool likely
 	int offset = (signed short)(op&0xFFFF)<<2;
 	int rs = _RS;
 	u32 targetAddr = js.compilerPC + offset + 4;
+	bool idleLoop = jo.skipIdleLoops && !andLink && targetAddr <= js.compilerPC && IsIdleLoop(js.compilerPC);
 
 	u32 delaySlotOp = Memory::ReadUnchecked_U32(js.compilerPC + 4);
 	bool delaySlotIsNice = IsDelaySlotNiceReg(op, delaySlotOp, rs);
@@ -150,7 +156,10 @@ void Jit::BranchRSZeroComp(u32 op, ArmGen::CCFlags cc, bool andLink, bool likely
 		STR(CTXREG, R0, MIPS_REG_RA * 4);
 	}
 
-	WriteExit(targetAddr, 0);
+	if (idleLoop)
+		WriteIdleLoopExit(targetAddr);
+	else
+		WriteExit(targetAddr, 0);
 
 	SetJumpTarget(ptr);
 	// Not taken
@@ -409,8 +418,42 @@ void Jit::Comp_Syscall(u32 op)
 	WriteDownCount(offset);
 	js.downcountAmount = -offset;
 
-	MOVI2R(R0, op);
-	QuickCallFunction(R1, (void *)&CallSyscall);
+	const HLEFunction *info = GetSyscallInfo(op);
+	if (info != NULL && info->func != NULL)
+	{
+		// Stats and profiling need CallSyscall's timing, so only call the function directly when they're off.
+		MOVI2R(R0, (u32)&g_Config.bShowDebugStats);
+		LDRB(R0, R0);
+		CMP(R0, 0);
+		FixupBranch slowPath = B_CC(CC_NEQ);
+		MOVI2R(R0, (u32)&g_Config.bSyscallProfile);
+		LDRB(R0, R0);
+		CMP(R0, 0);
+		FixupBranch slowPathProfile = B_CC(CC_NEQ);
+
+		QuickCallFunction(R1, (void *)info->func);
+		MOVI2R(R0, (u32)&hleAfterSyscall);
+		LDR(R0, R0);
+		CMP(R0, 0);
+		FixupBranch noFinish = B_CC(CC_EQ);
+		u32 callno = (op >> 6) & 0xFFFFF;
+		MOVI2R(R0, (callno & 0xFF000) >> 12);
+		MOVI2R(R1, callno & 0xFFF);
+		QuickCallFunction(R2, (void *)&hleFinishSyscall);
+		FixupBranch done = B();
+
+		SetJumpTarget(slowPath);
+		SetJumpTarget(slowPathProfile);
+		MOVI2R(R0, op);
+		QuickCallFunction(R1, (void *)&CallSyscall);
+		SetJumpTarget(noFinish);
+		SetJumpTarget(done);
+	}
+	else
+	{
+		MOVI2R(R0, op);
+		QuickCallFunction(R1, (void *)&CallSyscall);
+	}
 
 	WriteSyscallExit();
 	js.compiling = false;
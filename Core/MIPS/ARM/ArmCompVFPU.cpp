@@ -567,4 +567,48 @@ namespace MIPSComp
 		DISABLE;
 	}
 
+	void Jit::Comp_Vmmul(u32 op) {
+		DISABLE;
+	}
+
+	void Jit::Comp_Vmscl(u32 op) {
+		DISABLE;
+	}
+
+	void Jit::Comp_Vtfm(u32 op) {
+		DISABLE;
+	}
+
+	void Jit::Comp_VCrossQuat(u32 op) {
+		DISABLE;
+	}
+
+	void Jit::Comp_Vcrs(u32 op) {
+		DISABLE;
+	}
+
+	void Jit::Comp_VScl(u32 op) {
+		DISABLE;
+	}
+
+	void Jit::Comp_VHdp(u32 op) {
+		DISABLE;
+	}
+
+	void Jit::Comp_Vi2f(u32 op) {
+		DISABLE;
+	}
+
+	void Jit::Comp_Vidt(u32 op) {
+		DISABLE;
+	}
+
+	void Jit::Comp_VMatrixInit(u32 op) {
+		DISABLE;
+	}
+
+	void Jit::Comp_Viim(u32 op) {
+		DISABLE;
+	}
+
 }
@@ -18,6 +18,7 @@
 #include "Common/ChunkFile.h"
 #include "../../Core.h"
 #include "../../CoreTiming.h"
+#include "../../HLE/ReplaceTables.h"
 #include "../MIPS.h"
 #include "../MIPSCodeUtils.h"
 #include "../MIPSInt.h"
@@ -192,6 +193,22 @@ const u8 *Jit::DoJit(u32 em_address, ArmJitBlock *b)
 	SetCC(CC_AL);
 
 	b->normalEntry = GetCodePtr();
+
+	if (jo.enableReplacements)
+	{
+		const int replacement = GetReplacementFuncIndex(em_address);
+		if (replacement >= 0)
+		{
+			WriteReplacementFunc(replacement);
+
+			b->codeSize = GetCodePtr() - b->normalEntry;
+			AlignCode16();
+			FlushIcache();
+			b->originalSize = 1;
+			return b->normalEntry;
+		}
+	}
+
 	// TODO: this needs work
 	MIPSAnalyst::AnalysisResults analysis; // = MIPSAnalyst::Analyze(em_address);
 
@@ -318,6 +335,39 @@ void Jit::WriteExit(u32 destination, int exit_num)
 	}
 }
 
+void Jit::WriteIdleLoopExit(u32 destination)
+{
+	WriteDownCount();
+
+	// Nothing can make the loop exit before the next event, so skip ahead to it.
+	MOVI2R(R0, 0);
+	QuickCallFunction(R1, (void *)&CoreTiming::Idle);
+	MOVI2R(R0, destination);
+	MovToPC(R0);
+	// Idle() clobbered the flags, but the dispatcher wants them from the downcount.
+	LDR(R1, R10, offsetof(MIPSState, downcount));
+	CMP(R1, 0);
+	B((const void *)dispatcherCheckCoreState);
+}
+
+void Jit::WriteReplacementFunc(int index)
+{
+	// Called at the start of a block, nothing is mapped yet.
+	MOVI2R(R2, (u32)GetReplacementHitCounter(index));
+	LDR(R1, R2, 0);
+	ADD(R1, R1, 1);
+	STR(R2, R1, 0);
+	QuickCallFunction(R1, (void *)GetReplacementFunc(index)->replaceFunc);
+	LDR(R1, R10, offsetof(MIPSState, downcount));
+	SUB(R1, R1, R0);
+	STR(R10, R1, offsetof(MIPSState, downcount));
+
+	// And straight back to the caller.
+	js.downcountAmount = 0;
+	LDR(R0, R10, offsetof(MIPSState, r) + MIPS_REG_RA * 4);
+	WriteExitDestInR(R0);
+}
+
 void Jit::WriteExitDestInR(ARMReg Reg) 
 {
 	MovToPC(Reg);
@@ -32,9 +32,15 @@ struct ArmJitOptions
 	ArmJitOptions()
 	{
 		enableBlocklink = true;
+		skipIdleLoops = true;
+		enableReplacements = true;
 	}
 
 	bool enableBlocklink;
+	// Loops that just poll memory (see MIPSAnalyst::IsIdleLoop) skip ahead to the next event.
+	bool skipIdleLoops;
+	// Call native versions of known library functions, see ReplaceTables.h.
+	bool enableReplacements;
 };
 
 struct ArmJitState
@@ -187,6 +193,17 @@ public:
 	void Comp_Mftv(u32 op);
 	void Comp_Vmtvc(u32 op);
 	void Comp_Vmmov(u32 op);
+	void Comp_Vmmul(u32 op);
+	void Comp_Vmscl(u32 op);
+	void Comp_Vtfm(u32 op);
+	void Comp_VCrossQuat(u32 op);
+	void Comp_Vcrs(u32 op);
+	void Comp_VScl(u32 op);
+	void Comp_VHdp(u32 op);
+	void Comp_Vi2f(u32 op);
+	void Comp_Vidt(u32 op);
+	void Comp_VMatrixInit(u32 op);
+	void Comp_Viim(u32 op);
 
 	ArmJitBlockCache *GetBlockCache() { return &blocks; }
 
@@ -206,6 +223,8 @@ private:
 	void MovToPC(ARMReg r);
 
 	void WriteExit(u32 destination, int exit_num);
+	void WriteIdleLoopExit(u32 destination);
+	void WriteReplacementFunc(int index);
 	void WriteExitDestInR(ARMReg Reg);
 	void WriteSyscallExit();
 
@@ -71,6 +71,7 @@ void ArmJitBlockCache::Init()
 #endif
 	blocks = new ArmJitBlock[MAX_NUM_BLOCKS];
 	blockCodePointers = new const u8*[MAX_NUM_BLOCKS];
+	blockIndex.Init(MAX_NUM_BLOCKS);
 	Clear();
 }
 
@@ -81,6 +82,7 @@ void ArmJitBlockCache::Shutdown()
 	blocks = 0;
 	blockCodePointers = 0;
 	num_blocks = 0;
+	blockIndex.Shutdown();
 #if defined USE_OPROFILE && USE_OPROFILE
 	op_close_agent(agent);
 #endif
@@ -99,12 +101,12 @@ ArmJitBlockCache::~ArmJitBlockCache()
 // is full and when saving and loading states.
 void ArmJitBlockCache::Clear()
 {
+	// Everything goes, so no need to unlink or unindex blocks one at a time.
+	blockIndex.Clear();
 	for (int i = 0; i < num_blocks; i++)
 	{
 		DestroyBlock(i, false);
 	}
-	links_to.clear();
-	block_map.clear();
 	num_blocks = 0;
 	memset(blockCodePointers, 0xCC, sizeof(u8*)*MAX_NUM_BLOCKS);
 }
@@ -173,13 +175,13 @@ void ArmJitBlockCache::FinalizeBlock(int block_num, bool block_link, const u8 *c
 	// Yeah, this'll work fine for PSP too I think.
 	u32 pAddr = b.originalAddress & 0x1FFFFFFF;
 
-	block_map[std::make_pair(pAddr + 4 * b.originalSize - 1, pAddr)] = block_num;
+	blockIndex.AddBlock(block_num, pAddr, pAddr + 4 * b.originalSize);
 	if (block_link)
 	{
 		for (int i = 0; i < 2; i++)
 		{
 			if (b.exitAddress[i] != INVALID_EXIT) 
-				links_to.insert(std::pair<u32, int>(b.exitAddress[i], block_num));
+				blockIndex.AddLink(b.exitAddress[i], block_num, i);
 		}
 			
 		LinkBlock(block_num);
@@ -293,38 +295,22 @@ void ArmJitBlockCache::LinkBlockExits(int i)
 	}
 }
 
-using namespace std;
-
 void ArmJitBlockCache::LinkBlock(int i)
 {
 	LinkBlockExits(i);
 	ArmJitBlock &b = blocks[i];
-	pair<multimap<u32, int>::iterator, multimap<u32, int>::iterator> ppp;
-	// equal_range(b) returns pair<iterator,iterator> representing the range
-	// of element with key b
-	ppp = links_to.equal_range(b.originalAddress);
-	if (ppp.first == ppp.second)
-		return;
-	for (multimap<u32, int>::iterator iter = ppp.first; iter != ppp.second; ++iter) {
-		// PanicAlert("Linking block %i to block %i", iter2->second, i);
-		LinkBlockExits(iter->second);
+	for (int link = blockIndex.FirstLinkTo(b.originalAddress); link != -1; link = blockIndex.NextLinkTo(link, b.originalAddress)) {
+		// PanicAlert("Linking block %i to block %i", JitBlockIndex::LinkBlock(link), i);
+		LinkBlockExits(JitBlockIndex::LinkBlock(link));
 	}
 }
 
 void ArmJitBlockCache::UnlinkBlock(int i)
 {
 	ArmJitBlock &b = blocks[i];
-	pair<multimap<u32, int>::iterator, multimap<u32, int>::iterator> ppp;
-	ppp = links_to.equal_range(b.originalAddress);
-	if (ppp.first == ppp.second)
-		return;
-	for (multimap<u32, int>::iterator iter = ppp.first; iter != ppp.second; ++iter) {
-		ArmJitBlock &sourceBlock = blocks[iter->second];
-		for (int e = 0; e < 2; e++)
-		{
-			if (sourceBlock.exitAddress[e] == b.originalAddress)
-				sourceBlock.linkStatus[e] = false;
-		}
+	for (int link = blockIndex.FirstLinkTo(b.originalAddress); link != -1; link = blockIndex.NextLinkTo(link, b.originalAddress)) {
+		ArmJitBlock &sourceBlock = blocks[JitBlockIndex::LinkBlock(link)];
+		sourceBlock.linkStatus[JitBlockIndex::LinkExit(link)] = false;
 	}
 }
 
@@ -343,6 +329,7 @@ void ArmJitBlockCache::DestroyBlock(int block_num, bool invalidate)
 		return;
 	}
 	b.invalid = true;
+	blockIndex.RemoveBlock(block_num);
 	if ((int)Memory::ReadUnchecked_U32(b.originalAddress) == (MIPS_EMUHACK_OPCODE | block_num))
 		Memory::WriteUnchecked_U32(b.originalFirstOpcode, b.originalAddress);
 
@@ -362,18 +349,12 @@ void ArmJitBlockCache::DestroyBlock(int block_num, bool invalidate)
 
 void ArmJitBlockCache::InvalidateICache(u32 address, const u32 length)
 {
-	u32 pAddr = address & 0x3FFFFFFF;
+	// Convert the logical address to a physical address for the block map
+	u32 pAddr = address & 0x1FFFFFFF;
 
 	// destroy JIT blocks
-	// !! this works correctly under assumption that any two overlapping blocks end at the same address
-	std::map<pair<u32,u32>, u32>::iterator it1 = block_map.lower_bound(std::make_pair(pAddr, 0)), it2 = it1;
-	while (it2 != block_map.end() && it2->first.second < pAddr + length)
-	{
-		DestroyBlock(it2->second, true);
-		it2++;
-	}
-	if (it1 != it2)
-	{
-		block_map.erase(it1, it2);
-	}
+	invalidated.clear();
+	blockIndex.GetBlocksInRange(pAddr, length, invalidated);
+	for (size_t i = 0; i < invalidated.size(); ++i)
+		DestroyBlock(invalidated[i], true);
 }
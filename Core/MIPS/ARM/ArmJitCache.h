@@ -17,12 +17,12 @@
 
 #pragma once
 
-#include <map>
 #include <vector>
 #include <string>
 
 #include "../MIPSAnalyst.h"
 #include "../MIPS.h"
+#include "../JitCommon/JitBlockIndex.h"
 // Define this in order to get VTune profile support for the Jit generated code.
 // Add the VTune include/lib directories to the project directories to get this to build.
 // #define USE_VTUNE
@@ -126,8 +126,8 @@ private:
 	const u8 **blockCodePointers;
 	ArmJitBlock *blocks;
 	int num_blocks;
-	std::multimap<u32, int> links_to;
-	std::map<std::pair<u32,u32>, u32> block_map; // (end_addr, start_addr) -> number
+	JitBlockIndex blockIndex;
+	std::vector<int> invalidated;
 
 	int MAX_NUM_BLOCKS;
 
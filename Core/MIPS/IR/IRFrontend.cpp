@@ -0,0 +1,335 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include "Common/Common.h"
+#include "Core/MemMap.h"
+#include "Core/MIPS/MIPSTables.h"
+#include "IRFrontend.h"
+
+#define _RS ((op>>21) & 0x1F)
+#define _RT ((op>>16) & 0x1F)
+#define _RD ((op>>11) & 0x1F)
+#define _SA ((op>>6 ) & 0x1F)
+#define _SIMM16 ((u32)(s32)(s16)(op & 0xFFFF))
+#define _UIMM16 ((u32)(op & 0xFFFF))
+
+namespace MIPSComp
+{
+
+void IRFrontend::Emit(IROp op, u8 dest, u8 src1, u8 src2, u32 constant)
+{
+	IRInst inst;
+	inst.op = (u8)op;
+	inst.dest = dest;
+	inst.src1 = src1;
+	inst.src2 = src2;
+	inst.constant = constant;
+	block_->insts.push_back(inst);
+}
+
+u8 IRFrontend::CopyToTemp(u8 reg)
+{
+	if (reg == IRREG_ZERO)
+		return reg;
+	_dbg_assert_msg_(JIT, nextTemp_ < IRREG_COUNT, "Out of IR temps");
+	u8 temp = nextTemp_++;
+	Emit(IROP_MOV, temp, reg);
+	return temp;
+}
+
+void IRFrontend::Translate(u32 em_address, IRBlock *block)
+{
+	block_ = block;
+	nextTemp_ = IRREG_TEMP0;
+
+	block->emAddress = em_address;
+	block->firstOp = Memory::Read_Instruction(em_address);
+	block->numInstructions = 0;
+	block->cycles = 0;
+	block->insts.clear();
+
+	u32 addr = em_address;
+	bool compiling = true;
+	while (compiling)
+	{
+		u32 op = Memory::Read_Instruction(addr);
+		block->cycles += MIPSGetInstructionCycleEstimate(op);
+		block->numInstructions++;
+
+		compiling = TranslateOp(op, addr);
+		if (MIPSGetInfo(op) & DELAYSLOT)
+			addr += 8;
+		else
+			addr += 4;
+
+		if (compiling && (int)block->numInstructions >= maxInstructions)
+		{
+			Emit(IROP_EXITTOCONST, 0, 0, 0, addr);
+			compiling = false;
+		}
+	}
+
+	block_ = 0;
+}
+
+bool IRFrontend::CanTranslateInDelaySlot(u32 op) const
+{
+	if (MIPSGetInfo(op) & (IS_CONDBRANCH | IS_JUMP | DELAYSLOT))
+		return false;
+	// syscall and break.
+	if ((op & 0xFC00003E) == 0x0000000C)
+		return false;
+	return true;
+}
+
+void IRFrontend::TranslateDelaySlot(u32 addr)
+{
+	// The branch's cycle estimate already includes the delay slot.
+	block_->numInstructions++;
+	TranslateOp(Memory::Read_Instruction(addr), addr);
+}
+
+// Anything we don't model goes through MIPSInterpret, exactly like the interpreter would.
+void IRFrontend::TranslateInterpretedBranch(u32 op, u32 addr)
+{
+	Emit(IROP_SETPCCONST, 0, 0, 0, addr);
+	Emit(IROP_INTERPRETBRANCH, 0, 0, 0, op);
+	block_->numInstructions++;
+}
+
+void IRFrontend::TranslateBranch(u32 op, u32 addr)
+{
+	const u32 delayOp = Memory::Read_Instruction(addr + 4);
+	if (!CanTranslateInDelaySlot(delayOp))
+	{
+		TranslateInterpretedBranch(op, addr);
+		return;
+	}
+
+	const u32 relTarget = addr + 4 + (_SIMM16 << 2);
+	IROp cond = IROP_EXITTOCONST;
+	IROp notCond = IROP_EXITTOCONST;
+	bool likely = false;
+	bool link = false;
+	int rs = _RS;
+	int rt = 0;
+
+	switch (op >> 26)
+	{
+	case 0:
+		{
+			// jr / jalr.  The target is read before the delay slot runs.
+			u8 target = CopyToTemp(rs);
+			if ((op & 0x3F) == 9)
+				Emit(IROP_SETCONST, IRREG_RA, 0, 0, addr + 8);
+			TranslateDelaySlot(addr + 4);
+			Emit(IROP_EXITTOREG, 0, target);
+		}
+		return;
+
+	case 1:
+		switch (_RT)
+		{
+		case 0: cond = IROP_EXITTOCONSTIFLTZ; notCond = IROP_EXITTOCONSTIFGEZ; break; //bltz
+		case 1: cond = IROP_EXITTOCONSTIFGEZ; notCond = IROP_EXITTOCONSTIFLTZ; break; //bgez
+		case 2: cond = IROP_EXITTOCONSTIFLTZ; notCond = IROP_EXITTOCONSTIFGEZ; likely = true; break; //bltzl
+		case 3: cond = IROP_EXITTOCONSTIFGEZ; notCond = IROP_EXITTOCONSTIFLTZ; likely = true; break; //bgezl
+		case 16: cond = IROP_EXITTOCONSTIFLTZ; notCond = IROP_EXITTOCONSTIFGEZ; link = true; break; //bltzal
+		case 17: cond = IROP_EXITTOCONSTIFGEZ; notCond = IROP_EXITTOCONSTIFLTZ; link = true; break; //bgezal
+		case 18: cond = IROP_EXITTOCONSTIFLTZ; notCond = IROP_EXITTOCONSTIFGEZ; link = true; likely = true; break; //bltzall
+		case 19: cond = IROP_EXITTOCONSTIFGEZ; notCond = IROP_EXITTOCONSTIFLTZ; link = true; likely = true; break; //bgezall
+		default:
+			TranslateInterpretedBranch(op, addr);
+			return;
+		}
+		break;
+
+	case 2: //j
+	case 3: //jal
+		if ((op >> 26) == 3)
+			Emit(IROP_SETCONST, IRREG_RA, 0, 0, addr + 8);
+		TranslateDelaySlot(addr + 4);
+		Emit(IROP_EXITTOCONST, 0, 0, 0, (addr & 0xF0000000) | ((op & 0x03FFFFFF) << 2));
+		return;
+
+	case 4: case 20: cond = IROP_EXITTOCONSTIFEQ; notCond = IROP_EXITTOCONSTIFNEQ; rt = _RT; break; //beq
+	case 5: case 21: cond = IROP_EXITTOCONSTIFNEQ; notCond = IROP_EXITTOCONSTIFEQ; rt = _RT; break; //bne
+	case 6: case 22: cond = IROP_EXITTOCONSTIFLEZ; notCond = IROP_EXITTOCONSTIFGTZ; break; //blez
+	case 7: case 23: cond = IROP_EXITTOCONSTIFGTZ; notCond = IROP_EXITTOCONSTIFLEZ; break; //bgtz
+
+	default:
+		// FPU and VFPU branches.
+		TranslateInterpretedBranch(op, addr);
+		return;
+	}
+
+	if ((op >> 26) >= 20)
+		likely = true;
+
+	// The delay slot may overwrite the operands, the passes remove the copies when it doesn't.
+	u8 a = CopyToTemp(rs);
+	u8 b = CopyToTemp(rt);
+	if (link)
+		Emit(IROP_SETCONST, IRREG_RA, 0, 0, addr + 8);
+
+	if (likely)
+	{
+		// The delay slot only runs if the branch is taken.
+		Emit(notCond, 0, a, b, addr + 8);
+		TranslateDelaySlot(addr + 4);
+		Emit(IROP_EXITTOCONST, 0, 0, 0, relTarget);
+	}
+	else
+	{
+		TranslateDelaySlot(addr + 4);
+		Emit(cond, 0, a, b, relTarget);
+		Emit(IROP_EXITTOCONST, 0, 0, 0, addr + 8);
+	}
+}
+
+bool IRFrontend::TranslateOp(u32 op, u32 addr)
+{
+	const u32 info = MIPSGetInfo(op);
+	if (info & (IS_CONDBRANCH | IS_JUMP))
+	{
+		TranslateBranch(op, addr);
+		return false;
+	}
+
+	const u8 rs = _RS;
+	const u8 rt = _RT;
+	const u8 rd = _RD;
+
+	switch (op >> 26)
+	{
+	case 0:
+		switch (op & 0x3F)
+		{
+		case 0: if (rd) Emit(IROP_SHLIMM, rd, rt, 0, _SA); return true; //sll
+		case 2:
+			if (rs == 0) //srl
+			{
+				if (rd) Emit(IROP_SHRIMM, rd, rt, 0, _SA);
+				return true;
+			}
+			if (rs == 1) //rotr
+			{
+				if (rd) Emit(IROP_RORIMM, rd, rt, 0, _SA);
+				return true;
+			}
+			break;
+		case 3: if (rd) Emit(IROP_SARIMM, rd, rt, 0, _SA); return true; //sra
+		case 4: if (rd) Emit(IROP_SHL, rd, rt, rs); return true; //sllv
+		case 6:
+			if (_SA == 0) //srlv
+			{
+				if (rd) Emit(IROP_SHR, rd, rt, rs);
+				return true;
+			}
+			if (_SA == 1) //rotrv
+			{
+				if (rd) Emit(IROP_ROR, rd, rt, rs);
+				return true;
+			}
+			break;
+		case 7: if (rd) Emit(IROP_SAR, rd, rt, rs); return true; //srav
+
+		case 10: if (rd) Emit(IROP_MOVZ, rd, rs, rt); return true; //movz
+		case 11: if (rd) Emit(IROP_MOVN, rd, rs, rt); return true; //movn
+
+		case 12: //syscall
+			Emit(IROP_SETPCCONST, 0, 0, 0, addr + 4);
+			Emit(IROP_SYSCALL, 0, 0, 0, op);
+			Emit(IROP_EXITTOPC);
+			return false;
+
+		case 16: if (rd) Emit(IROP_MOV, rd, IRREG_HI); return true; //mfhi
+		case 17: Emit(IROP_MOV, IRREG_HI, rs); return true; //mthi
+		case 18: if (rd) Emit(IROP_MOV, rd, IRREG_LO); return true; //mflo
+		case 19: Emit(IROP_MOV, IRREG_LO, rs); return true; //mtlo
+
+		case 22: if (rd) Emit(IROP_CLZ, rd, rs); return true; //clz
+		case 23: if (rd) Emit(IROP_CLO, rd, rs); return true; //clo
+
+		case 24: Emit(IROP_MULT, 0, rs, rt); return true; //mult
+		case 25: Emit(IROP_MULTU, 0, rs, rt); return true; //multu
+		case 26: Emit(IROP_DIV, 0, rs, rt); return true; //div
+		case 27: Emit(IROP_DIVU, 0, rs, rt); return true; //divu
+		case 28: Emit(IROP_MADD, 0, rs, rt); return true; //madd
+		case 29: Emit(IROP_MADDU, 0, rs, rt); return true; //maddu
+		case 46: Emit(IROP_MSUB, 0, rs, rt); return true; //msub
+		case 47: Emit(IROP_MSUBU, 0, rs, rt); return true; //msubu
+
+		case 32: //add
+		case 33: if (rd) Emit(IROP_ADD, rd, rs, rt); return true; //addu
+		case 34: //sub
+		case 35: if (rd) Emit(IROP_SUB, rd, rs, rt); return true; //subu
+		case 36: if (rd) Emit(IROP_AND, rd, rs, rt); return true; //and
+		case 37: if (rd) Emit(IROP_OR, rd, rs, rt); return true; //or
+		case 38: if (rd) Emit(IROP_XOR, rd, rs, rt); return true; //xor
+		case 39: if (rd) Emit(IROP_NOR, rd, rs, rt); return true; //nor
+		case 42: if (rd) Emit(IROP_SLT, rd, rs, rt); return true; //slt
+		case 43: if (rd) Emit(IROP_SLTU, rd, rs, rt); return true; //sltu
+		case 44: if (rd) Emit(IROP_MAX, rd, rs, rt); return true; //max
+		case 45: if (rd) Emit(IROP_MIN, rd, rs, rt); return true; //min
+		}
+		break;
+
+	case 8: //addi
+	case 9: if (rt) Emit(IROP_ADDCONST, rt, rs, 0, _SIMM16); return true; //addiu
+	case 10: if (rt) Emit(IROP_SLTCONST, rt, rs, 0, _SIMM16); return true; //slti
+	case 11: if (rt) Emit(IROP_SLTUCONST, rt, rs, 0, _SIMM16); return true; //sltiu
+	case 12: if (rt) Emit(IROP_ANDCONST, rt, rs, 0, _UIMM16); return true; //andi
+	case 13: if (rt) Emit(IROP_ORCONST, rt, rs, 0, _UIMM16); return true; //ori
+	case 14: if (rt) Emit(IROP_XORCONST, rt, rs, 0, _UIMM16); return true; //xori
+	case 15: if (rt) Emit(IROP_SETCONST, rt, 0, 0, _UIMM16 << 16); return true; //lui
+
+	case 31:
+		if ((op & 0x3F) == 32)
+		{
+			switch (_SA)
+			{
+			case 16: if (rd) Emit(IROP_SEB, rd, rt); return true; //seb
+			case 24: if (rd) Emit(IROP_SEH, rd, rt); return true; //seh
+			}
+		}
+		break;
+
+	case 32: if (rt) Emit(IROP_LOAD8EXT, rt, rs, 0, _SIMM16); return true; //lb
+	case 33: if (rt) Emit(IROP_LOAD16EXT, rt, rs, 0, _SIMM16); return true; //lh
+	case 35: if (rt) Emit(IROP_LOAD32, rt, rs, 0, _SIMM16); return true; //lw
+	case 36: if (rt) Emit(IROP_LOAD8, rt, rs, 0, _SIMM16); return true; //lbu
+	case 37: if (rt) Emit(IROP_LOAD16, rt, rs, 0, _SIMM16); return true; //lhu
+	case 40: Emit(IROP_STORE8, 0, rs, rt, _SIMM16); return true; //sb
+	case 41: Emit(IROP_STORE16, 0, rs, rt, _SIMM16); return true; //sh
+	case 43: Emit(IROP_STORE32, 0, rs, rt, _SIMM16); return true; //sw
+	}
+
+	// Everything else (FPU, VFPU, lwl/lwr, ext/ins, ...) runs through the interpreter.
+	Emit(IROP_SETPCCONST, 0, 0, 0, addr);
+	Emit(IROP_INTERPRET, 0, 0, 0, op);
+
+	// break stops the core, so make sure we notice.
+	if ((op & 0xFC00003F) == 0x0000000D)
+	{
+		Emit(IROP_EXITTOPC);
+		return false;
+	}
+	return true;
+}
+
+}  // namespace MIPSComp
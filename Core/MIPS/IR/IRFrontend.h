@@ -0,0 +1,54 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include "IRInst.h"
+
+namespace MIPSComp
+{
+
+// Decodes MIPS code into IR, one block at a time.
+//
+// A block ends after a branch and its delay slot, a syscall or break, or when
+// it reaches maxInstructions.  The output is deliberately naive, run the
+// passes from IRPasses.h over it before use.
+class IRFrontend
+{
+public:
+	IRFrontend() : maxInstructions(128), block_(0), nextTemp_(IRREG_TEMP0) {}
+
+	void Translate(u32 em_address, IRBlock *block);
+
+	int maxInstructions;
+
+private:
+	// Returns false if the block ends after this instruction.
+	bool TranslateOp(u32 op, u32 addr);
+	void TranslateBranch(u32 op, u32 addr);
+	void TranslateInterpretedBranch(u32 op, u32 addr);
+	void TranslateDelaySlot(u32 addr);
+	bool CanTranslateInDelaySlot(u32 op) const;
+
+	void Emit(IROp op, u8 dest = 0, u8 src1 = 0, u8 src2 = 0, u32 constant = 0);
+	u8 CopyToTemp(u8 reg);
+
+	IRBlock *block_;
+	u8 nextTemp_;
+};
+
+}  // namespace MIPSComp
@@ -0,0 +1,227 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include "Common/Common.h"
+#include "Common/StringUtil.h"
+#include "IRInst.h"
+
+namespace MIPSComp
+{
+
+#define D IRFLAG_DEST
+#define S1 IRFLAG_SRC1
+#define S2 IRFLAG_SRC2
+#define F IRFLAG_FOLDABLE
+
+// Must be in the same order as the IROp enum.
+static const IRMeta irMeta[] = {
+	{IROP_NOP, "nop", 0},
+
+	{IROP_SETCONST, "setc", D | F},
+	{IROP_MOV, "mov", D | S1 | F},
+
+	{IROP_ADD, "add", D | S1 | S2 | F},
+	{IROP_SUB, "sub", D | S1 | S2 | F},
+	{IROP_AND, "and", D | S1 | S2 | F},
+	{IROP_OR, "or", D | S1 | S2 | F},
+	{IROP_XOR, "xor", D | S1 | S2 | F},
+	{IROP_NOR, "nor", D | S1 | S2 | F},
+	{IROP_SLT, "slt", D | S1 | S2 | F},
+	{IROP_SLTU, "sltu", D | S1 | S2 | F},
+	{IROP_MAX, "max", D | S1 | S2 | F},
+	{IROP_MIN, "min", D | S1 | S2 | F},
+
+	{IROP_ADDCONST, "addc", D | S1 | F},
+	{IROP_ANDCONST, "andc", D | S1 | F},
+	{IROP_ORCONST, "orc", D | S1 | F},
+	{IROP_XORCONST, "xorc", D | S1 | F},
+	{IROP_SLTCONST, "sltc", D | S1 | F},
+	{IROP_SLTUCONST, "sltuc", D | S1 | F},
+
+	{IROP_SHL, "shl", D | S1 | S2 | F},
+	{IROP_SHR, "shr", D | S1 | S2 | F},
+	{IROP_SAR, "sar", D | S1 | S2 | F},
+	{IROP_ROR, "ror", D | S1 | S2 | F},
+	{IROP_SHLIMM, "shli", D | S1 | F},
+	{IROP_SHRIMM, "shri", D | S1 | F},
+	{IROP_SARIMM, "sari", D | S1 | F},
+	{IROP_RORIMM, "rori", D | S1 | F},
+
+	{IROP_MOVZ, "movz", D | S1 | S2 | IRFLAG_SRCDEST},
+	{IROP_MOVN, "movn", D | S1 | S2 | IRFLAG_SRCDEST},
+
+	{IROP_SEB, "seb", D | S1 | F},
+	{IROP_SEH, "seh", D | S1 | F},
+	{IROP_CLZ, "clz", D | S1 | F},
+	{IROP_CLO, "clo", D | S1 | F},
+
+	{IROP_MULT, "mult", S1 | S2 | IRFLAG_HILO_OUT},
+	{IROP_MULTU, "multu", S1 | S2 | IRFLAG_HILO_OUT},
+	{IROP_MADD, "madd", S1 | S2 | IRFLAG_HILO_IN | IRFLAG_HILO_OUT},
+	{IROP_MADDU, "maddu", S1 | S2 | IRFLAG_HILO_IN | IRFLAG_HILO_OUT},
+	{IROP_MSUB, "msub", S1 | S2 | IRFLAG_HILO_IN | IRFLAG_HILO_OUT},
+	{IROP_MSUBU, "msubu", S1 | S2 | IRFLAG_HILO_IN | IRFLAG_HILO_OUT},
+	{IROP_DIV, "div", S1 | S2 | IRFLAG_HILO_IN | IRFLAG_HILO_OUT},
+	{IROP_DIVU, "divu", S1 | S2 | IRFLAG_HILO_IN | IRFLAG_HILO_OUT},
+
+	{IROP_LOAD8, "load8", D | S1 | IRFLAG_LOAD},
+	{IROP_LOAD8EXT, "load8ext", D | S1 | IRFLAG_LOAD},
+	{IROP_LOAD16, "load16", D | S1 | IRFLAG_LOAD},
+	{IROP_LOAD16EXT, "load16ext", D | S1 | IRFLAG_LOAD},
+	{IROP_LOAD32, "load32", D | S1 | IRFLAG_LOAD},
+	{IROP_STORE8, "store8", S1 | S2 | IRFLAG_STORE},
+	{IROP_STORE16, "store16", S1 | S2 | IRFLAG_STORE},
+	{IROP_STORE32, "store32", S1 | S2 | IRFLAG_STORE},
+
+	{IROP_SETPCCONST, "setpc", 0},
+	{IROP_INTERPRET, "interpret", IRFLAG_BARRIER},
+	{IROP_SYSCALL, "syscall", IRFLAG_BARRIER},
+
+	{IROP_EXITTOCONST, "exit", IRFLAG_EXIT},
+	{IROP_EXITTOCONSTIFEQ, "exitifeq", S1 | S2 | IRFLAG_EXIT},
+	{IROP_EXITTOCONSTIFNEQ, "exitifneq", S1 | S2 | IRFLAG_EXIT},
+	{IROP_EXITTOCONSTIFGTZ, "exitifgtz", S1 | IRFLAG_EXIT},
+	{IROP_EXITTOCONSTIFGEZ, "exitifgez", S1 | IRFLAG_EXIT},
+	{IROP_EXITTOCONSTIFLTZ, "exitifltz", S1 | IRFLAG_EXIT},
+	{IROP_EXITTOCONSTIFLEZ, "exitiflez", S1 | IRFLAG_EXIT},
+	{IROP_EXITTOREG, "exitreg", S1 | IRFLAG_EXIT},
+	{IROP_EXITTOPC, "exitpc", IRFLAG_EXIT},
+	{IROP_INTERPRETBRANCH, "interpretbranch", IRFLAG_BARRIER | IRFLAG_EXIT},
+};
+
+#undef D
+#undef S1
+#undef S2
+#undef F
+
+const IRMeta &GetIRMeta(u8 op)
+{
+	_dbg_assert_msg_(JIT, op < IROP_COUNT && irMeta[op].op == op, "Bad IR op");
+	return irMeta[op];
+}
+
+static u32 CountLeadingZeros(u32 x)
+{
+	u32 count = 0;
+	while (count < 32 && !(x & (0x80000000 >> count)))
+		++count;
+	return count;
+}
+
+u32 EvalIRFoldable(u8 op, u32 a, u32 b, u32 c)
+{
+	switch (op)
+	{
+	case IROP_SETCONST: return c;
+	case IROP_MOV: return a;
+
+	case IROP_ADD: return a + b;
+	case IROP_SUB: return a - b;
+	case IROP_AND: return a & b;
+	case IROP_OR: return a | b;
+	case IROP_XOR: return a ^ b;
+	case IROP_NOR: return ~(a | b);
+	case IROP_SLT: return (s32)a < (s32)b;
+	case IROP_SLTU: return a < b;
+	case IROP_MAX: return (s32)a > (s32)b ? a : b;
+	case IROP_MIN: return (s32)a < (s32)b ? a : b;
+
+	case IROP_ADDCONST: return a + c;
+	case IROP_ANDCONST: return a & c;
+	case IROP_ORCONST: return a | c;
+	case IROP_XORCONST: return a ^ c;
+	case IROP_SLTCONST: return (s32)a < (s32)c;
+	case IROP_SLTUCONST: return a < c;
+
+	case IROP_SHL: return a << (b & 31);
+	case IROP_SHR: return a >> (b & 31);
+	case IROP_SAR: return (u32)((s32)a >> (b & 31));
+	case IROP_ROR: return _rotr(a, b);
+	case IROP_SHLIMM: return a << c;
+	case IROP_SHRIMM: return a >> c;
+	case IROP_SARIMM: return (u32)((s32)a >> c);
+	case IROP_RORIMM: return _rotr(a, c);
+
+	case IROP_SEB: return (u32)(s32)(s8)(u8)a;
+	case IROP_SEH: return (u32)(s32)(s16)(u16)a;
+	case IROP_CLZ: return CountLeadingZeros(a);
+	case IROP_CLO: return CountLeadingZeros(~a);
+
+	default:
+		_dbg_assert_msg_(JIT, 0, "Trying to fold an IR op that can't be folded");
+		return 0;
+	}
+}
+
+bool EvalIRExitCondition(u8 op, u32 a, u32 b)
+{
+	switch (op)
+	{
+	case IROP_EXITTOCONSTIFEQ: return a == b;
+	case IROP_EXITTOCONSTIFNEQ: return a != b;
+	case IROP_EXITTOCONSTIFGTZ: return (s32)a > 0;
+	case IROP_EXITTOCONSTIFGEZ: return (s32)a >= 0;
+	case IROP_EXITTOCONSTIFLTZ: return (s32)a < 0;
+	case IROP_EXITTOCONSTIFLEZ: return (s32)a <= 0;
+	default:
+		return true;
+	}
+}
+
+void IRBlock::Compact()
+{
+	size_t out = 0;
+	for (size_t i = 0; i < insts.size(); ++i)
+	{
+		if (insts[i].op != IROP_NOP)
+			insts[out++] = insts[i];
+	}
+	insts.resize(out);
+}
+
+static std::string IRRegName(u8 reg)
+{
+	if (reg == IRREG_HI)
+		return "hi";
+	if (reg == IRREG_LO)
+		return "lo";
+	if (reg >= IRREG_TEMP0)
+		return StringFromFormat("t%d", reg - IRREG_TEMP0);
+	return StringFromFormat("r%d", reg);
+}
+
+std::string IRBlock::Disassemble() const
+{
+	std::string result;
+	for (size_t i = 0; i < insts.size(); ++i)
+	{
+		const IRInst &inst = insts[i];
+		const IRMeta &meta = GetIRMeta(inst.op);
+		std::string line = meta.name;
+		if (meta.flags & IRFLAG_DEST)
+			line += " " + IRRegName(inst.dest) + ",";
+		if (meta.flags & IRFLAG_SRC1)
+			line += " " + IRRegName(inst.src1) + ",";
+		if (meta.flags & IRFLAG_SRC2)
+			line += " " + IRRegName(inst.src2) + ",";
+		line += StringFromFormat(" %08x\n", inst.constant);
+		result += line;
+	}
+	return result;
+}
+
+}  // namespace MIPSComp
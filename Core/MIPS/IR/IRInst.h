@@ -0,0 +1,182 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+// A small register-based IR for MIPS basic blocks.
+//
+// Registers 0-31 are the MIPS GPRs, followed by HI and LO, followed by a
+// handful of block-local temporaries.  The frontend emits naive code (every
+// branch operand is copied to a temp, etc.) and relies on the passes in
+// IRPasses.h to clean it up.  Anything the IR doesn't model is kept as an
+// IROP_INTERPRET of the original opcode, which acts as a barrier for the passes.
+
+namespace MIPSComp
+{
+
+enum
+{
+	IRREG_ZERO = 0,
+	IRREG_RA = 31,
+	IRREG_HI = 32,
+	IRREG_LO = 33,
+	IRREG_TEMP0 = 34,
+	IRREG_NUM_TEMPS = 30,
+	IRREG_COUNT = IRREG_TEMP0 + IRREG_NUM_TEMPS,
+};
+
+// d = dest, s1/s2 = source registers, c = constant.
+enum IROp
+{
+	IROP_NOP,
+
+	IROP_SETCONST,      // d = c
+	IROP_MOV,           // d = s1
+
+	IROP_ADD,           // d = s1 op s2
+	IROP_SUB,
+	IROP_AND,
+	IROP_OR,
+	IROP_XOR,
+	IROP_NOR,
+	IROP_SLT,
+	IROP_SLTU,
+	IROP_MAX,
+	IROP_MIN,
+
+	IROP_ADDCONST,      // d = s1 op c
+	IROP_ANDCONST,
+	IROP_ORCONST,
+	IROP_XORCONST,
+	IROP_SLTCONST,
+	IROP_SLTUCONST,
+
+	IROP_SHL,           // d = s1 op (s2 & 31)
+	IROP_SHR,
+	IROP_SAR,
+	IROP_ROR,
+	IROP_SHLIMM,        // d = s1 op c
+	IROP_SHRIMM,
+	IROP_SARIMM,
+	IROP_RORIMM,
+
+	IROP_MOVZ,          // if (s2 == 0) d = s1
+	IROP_MOVN,          // if (s2 != 0) d = s1
+
+	IROP_SEB,           // d = op(s1)
+	IROP_SEH,
+	IROP_CLZ,
+	IROP_CLO,
+
+	IROP_MULT,          // HI:LO = s1 op s2
+	IROP_MULTU,
+	IROP_MADD,          // HI:LO = HI:LO op s1 * s2
+	IROP_MADDU,
+	IROP_MSUB,
+	IROP_MSUBU,
+	IROP_DIV,
+	IROP_DIVU,
+
+	IROP_LOAD8,         // d = mem[s1 + c]
+	IROP_LOAD8EXT,
+	IROP_LOAD16,
+	IROP_LOAD16EXT,
+	IROP_LOAD32,
+	IROP_STORE8,        // mem[s1 + c] = s2
+	IROP_STORE16,
+	IROP_STORE32,
+
+	IROP_SETPCCONST,    // pc = c
+	IROP_INTERPRET,     // runs opcode c through the interpreter, pc must be set.
+	IROP_SYSCALL,       // calls syscall c, pc must already point past it.
+
+	IROP_EXITTOCONST,   // pc = c, leave the block
+	IROP_EXITTOCONSTIFEQ, // if (s1 == s2) pc = c, leave the block
+	IROP_EXITTOCONSTIFNEQ,
+	IROP_EXITTOCONSTIFGTZ, // if ((s32)s1 > 0) pc = c, leave the block
+	IROP_EXITTOCONSTIFGEZ,
+	IROP_EXITTOCONSTIFLTZ,
+	IROP_EXITTOCONSTIFLEZ,
+	IROP_EXITTOREG,     // pc = s1, leave the block
+	IROP_EXITTOPC,      // leave the block, pc was set by the previous op
+	IROP_INTERPRETBRANCH, // interprets branch c at pc and its delay slot, then leaves
+
+	IROP_COUNT,
+};
+
+enum
+{
+	IRFLAG_DEST = 0x01,       // writes d
+	IRFLAG_SRC1 = 0x02,       // reads s1
+	IRFLAG_SRC2 = 0x04,       // reads s2
+	IRFLAG_SRCDEST = 0x08,    // reads d (conditional moves)
+	IRFLAG_HILO_OUT = 0x10,   // writes HI and LO
+	IRFLAG_HILO_IN = 0x20,    // reads HI and LO
+	IRFLAG_LOAD = 0x40,
+	IRFLAG_STORE = 0x80,
+	IRFLAG_EXIT = 0x100,      // may leave the block, so all MIPS state must be up to date
+	IRFLAG_BARRIER = 0x200,   // may read or write any MIPS state or memory
+	IRFLAG_FOLDABLE = 0x400,  // pure function of its register inputs and c
+};
+
+struct IRInst
+{
+	u8 op;
+	u8 dest;
+	u8 src1;
+	u8 src2;
+	u32 constant;
+};
+
+struct IRMeta
+{
+	IROp op;
+	const char *name;
+	u32 flags;
+};
+
+const IRMeta &GetIRMeta(u8 op);
+
+// Evaluates an IRFLAG_FOLDABLE op, shared by constant folding and the interpreter.
+u32 EvalIRFoldable(u8 op, u32 a, u32 b, u32 c);
+
+// True if the conditional exit op is taken for these register values.
+bool EvalIRExitCondition(u8 op, u32 a, u32 b);
+
+struct IRBlock
+{
+	IRBlock() : emAddress(0), numInstructions(0), cycles(0), firstOp(0) {}
+
+	u32 emAddress;
+	u32 numInstructions;
+	int cycles;
+	// Used to detect code that's been overwritten since compiling.
+	u32 firstOp;
+	std::vector<IRInst> insts;
+
+	// Removes the NOPs left behind by the passes.
+	void Compact();
+	// Human readable dump, one instruction per line.
+	std::string Disassemble() const;
+};
+
+}  // namespace MIPSComp
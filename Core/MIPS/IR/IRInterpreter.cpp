@@ -0,0 +1,381 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstring>
+
+#include "Common/ChunkFile.h"
+#include "Core/Core.h"
+#include "Core/CoreTiming.h"
+#include "Core/MemMap.h"
+#include "Core/HLE/HLE.h"
+#include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/MIPSInt.h"
+#include "Core/MIPS/MIPSTables.h"
+#include "IRInterpreter.h"
+#include "IRPasses.h"
+
+namespace MIPSComp
+{
+
+IRInterpreter *irInterpreter;
+
+IRInterpreter::IRInterpreter(MIPSState *mips) : mips_(mips)
+{
+	for (int i = 0; i < 32; ++i)
+		regs_[i] = &mips->r[i];
+	regs_[IRREG_HI] = &mips->hi;
+	regs_[IRREG_LO] = &mips->lo;
+	for (int i = 0; i < IRREG_NUM_TEMPS; ++i)
+		regs_[IRREG_TEMP0 + i] = &temps_[i];
+	memset(temps_, 0, sizeof(temps_));
+
+	blockIndex_.Init(MAX_NUM_BLOCKS);
+	ClearCache();
+}
+
+IRInterpreter::~IRInterpreter()
+{
+	ClearCache();
+	blockIndex_.Shutdown();
+}
+
+void IRInterpreter::DoState(PointerWrap &p)
+{
+	// Nothing to save, blocks are recompiled on demand after loading.
+	p.DoMarker("IRInterpreter");
+}
+
+void IRInterpreter::ClearCache()
+{
+	for (size_t i = 0; i < blocks_.size(); ++i)
+		delete blocks_[i];
+	blocks_.clear();
+	blockMap_.clear();
+	blockIndex_.Clear();
+	memset(lookupAddr_, 0xFF, sizeof(lookupAddr_));
+	memset(lookupBlock_, 0xFF, sizeof(lookupBlock_));
+}
+
+void IRInterpreter::ClearCacheAt(u32 em_address)
+{
+	InvalidateICache(em_address, 4);
+}
+
+void IRInterpreter::InvalidateICache(u32 address, u32 length)
+{
+	invalidated_.clear();
+	blockIndex_.GetBlocksInRange(address & 0x1FFFFFFF, length, invalidated_);
+	for (size_t i = 0; i < invalidated_.size(); ++i)
+		DestroyBlock(invalidated_[i]);
+}
+
+const IRBlock *IRInterpreter::GetBlockAt(u32 em_address) const
+{
+	std::map<u32, int>::const_iterator it = blockMap_.find(em_address);
+	if (it == blockMap_.end())
+		return NULL;
+	return blocks_[it->second];
+}
+
+void IRInterpreter::DestroyBlock(int block_num)
+{
+	IRBlock *block = blocks_[block_num];
+	if (block == NULL)
+		return;
+
+	const u32 slot = (block->emAddress >> 2) & (LOOKUP_SIZE - 1);
+	if (lookupAddr_[slot] == block->emAddress)
+		lookupAddr_[slot] = 0xFFFFFFFF;
+	blockMap_.erase(block->emAddress);
+	blockIndex_.RemoveBlock(block_num);
+
+	delete block;
+	blocks_[block_num] = NULL;
+}
+
+IRBlock *IRInterpreter::Compile(u32 em_address)
+{
+	if ((int)blocks_.size() >= MAX_NUM_BLOCKS)
+	{
+		INFO_LOG(JIT, "IR block cache full, clearing.");
+		ClearCache();
+	}
+
+	IRBlock *block = new IRBlock();
+	frontend_.Translate(em_address, block);
+	OptimizeIRBlock(block);
+
+	const int block_num = (int)blocks_.size();
+	blocks_.push_back(block);
+	blockMap_[em_address] = block_num;
+
+	const u32 pAddr = em_address & 0x1FFFFFFF;
+	blockIndex_.AddBlock(block_num, pAddr, pAddr + 4 * block->numInstructions);
+	return block;
+}
+
+IRBlock *IRInterpreter::GetOrCompileBlock(u32 em_address)
+{
+	const u32 slot = (em_address >> 2) & (LOOKUP_SIZE - 1);
+	int block_num = -1;
+	if (lookupAddr_[slot] == em_address)
+		block_num = lookupBlock_[slot];
+	else
+	{
+		std::map<u32, int>::const_iterator it = blockMap_.find(em_address);
+		if (it != blockMap_.end())
+			block_num = it->second;
+	}
+
+	if (block_num != -1)
+	{
+		IRBlock *block = blocks_[block_num];
+		if (Memory::Read_U32(em_address) == block->firstOp)
+		{
+			lookupAddr_[slot] = em_address;
+			lookupBlock_[slot] = block_num;
+			return block;
+		}
+		// The code was overwritten without an icache invalidate.
+		DestroyBlock(block_num);
+	}
+
+	IRBlock *block = Compile(em_address);
+	lookupAddr_[slot] = em_address;
+	lookupBlock_[slot] = (int)blocks_.size() - 1;
+	return block;
+}
+
+void IRInterpreter::RunLoopUntil(u64 globalticks)
+{
+	// Keep going until CoreTiming or a syscall changes the core state, or we pass globalticks.
+	while (coreState == CORE_RUNNING)
+	{
+		CoreTiming::Advance();
+
+		while (mips_->downcount >= 0 && coreState == CORE_RUNNING)
+		{
+			// Can happen after stepping or loading a state, just finish the delay slot.
+			if (mips_->inDelaySlot)
+			{
+				mips_->downcount -= MIPS_SingleStep();
+				continue;
+			}
+
+			IRBlock *block = GetOrCompileBlock(mips_->pc);
+			mips_->downcount -= block->cycles;
+			RunBlock(block);
+			// Blocks are short, so checking after each one is close enough.
+			if (CoreTiming::GetTicks() > globalticks)
+				return;
+		}
+	}
+}
+
+#define R(i) (*regs_[i])
+
+void IRInterpreter::RunBlock(const IRBlock *block)
+{
+	MIPSState *mips = mips_;
+	const IRInst *inst = &block->insts[0];
+
+	while (true)
+	{
+		switch (inst->op)
+		{
+		case IROP_NOP:
+			break;
+
+		case IROP_SETCONST:
+			R(inst->dest) = inst->constant;
+			break;
+		case IROP_MOV:
+			R(inst->dest) = R(inst->src1);
+			break;
+
+		case IROP_ADD: R(inst->dest) = R(inst->src1) + R(inst->src2); break;
+		case IROP_SUB: R(inst->dest) = R(inst->src1) - R(inst->src2); break;
+		case IROP_AND: R(inst->dest) = R(inst->src1) & R(inst->src2); break;
+		case IROP_OR: R(inst->dest) = R(inst->src1) | R(inst->src2); break;
+		case IROP_XOR: R(inst->dest) = R(inst->src1) ^ R(inst->src2); break;
+		case IROP_NOR: R(inst->dest) = ~(R(inst->src1) | R(inst->src2)); break;
+		case IROP_SLT: R(inst->dest) = (s32)R(inst->src1) < (s32)R(inst->src2); break;
+		case IROP_SLTU: R(inst->dest) = R(inst->src1) < R(inst->src2); break;
+
+		case IROP_ADDCONST: R(inst->dest) = R(inst->src1) + inst->constant; break;
+		case IROP_ANDCONST: R(inst->dest) = R(inst->src1) & inst->constant; break;
+		case IROP_ORCONST: R(inst->dest) = R(inst->src1) | inst->constant; break;
+		case IROP_XORCONST: R(inst->dest) = R(inst->src1) ^ inst->constant; break;
+		case IROP_SLTCONST: R(inst->dest) = (s32)R(inst->src1) < (s32)inst->constant; break;
+		case IROP_SLTUCONST: R(inst->dest) = R(inst->src1) < inst->constant; break;
+
+		case IROP_SHLIMM: R(inst->dest) = R(inst->src1) << inst->constant; break;
+		case IROP_SHRIMM: R(inst->dest) = R(inst->src1) >> inst->constant; break;
+		case IROP_SARIMM: R(inst->dest) = (u32)((s32)R(inst->src1) >> inst->constant); break;
+
+		case IROP_MAX:
+		case IROP_MIN:
+		case IROP_SHL:
+		case IROP_SHR:
+		case IROP_SAR:
+		case IROP_ROR:
+		case IROP_RORIMM:
+		case IROP_SEB:
+		case IROP_SEH:
+		case IROP_CLZ:
+		case IROP_CLO:
+			R(inst->dest) = EvalIRFoldable(inst->op, R(inst->src1), R(inst->src2), inst->constant);
+			break;
+
+		case IROP_MOVZ:
+			if (R(inst->src2) == 0)
+				R(inst->dest) = R(inst->src1);
+			break;
+		case IROP_MOVN:
+			if (R(inst->src2) != 0)
+				R(inst->dest) = R(inst->src1);
+			break;
+
+		case IROP_MULT:
+			{
+				u64 result = (u64)((s64)(s32)R(inst->src1) * (s64)(s32)R(inst->src2));
+				mips->lo = (u32)result;
+				mips->hi = (u32)(result >> 32);
+			}
+			break;
+		case IROP_MULTU:
+			{
+				u64 result = (u64)R(inst->src1) * (u64)R(inst->src2);
+				mips->lo = (u32)result;
+				mips->hi = (u32)(result >> 32);
+			}
+			break;
+		case IROP_MADD:
+		case IROP_MSUB:
+			{
+				s64 hilo = (s64)(((u64)mips->hi << 32) | mips->lo);
+				s64 product = (s64)(s32)R(inst->src1) * (s64)(s32)R(inst->src2);
+				u64 result = (u64)(inst->op == IROP_MADD ? hilo + product : hilo - product);
+				mips->lo = (u32)result;
+				mips->hi = (u32)(result >> 32);
+			}
+			break;
+		case IROP_MADDU:
+		case IROP_MSUBU:
+			{
+				u64 hilo = ((u64)mips->hi << 32) | mips->lo;
+				u64 product = (u64)R(inst->src1) * (u64)R(inst->src2);
+				u64 result = inst->op == IROP_MADDU ? hilo + product : hilo - product;
+				mips->lo = (u32)result;
+				mips->hi = (u32)(result >> 32);
+			}
+			break;
+		case IROP_DIV:
+			{
+				s32 a = (s32)R(inst->src1);
+				s32 b = (s32)R(inst->src2);
+				if (a == (s32)0x80000000 && b == -1)
+					mips->lo = 0x80000000;
+				else if (b != 0)
+				{
+					mips->lo = (u32)(a / b);
+					mips->hi = (u32)(a % b);
+				}
+				else
+					mips->lo = mips->hi = 0;
+			}
+			break;
+		case IROP_DIVU:
+			{
+				u32 a = R(inst->src1);
+				u32 b = R(inst->src2);
+				if (b != 0)
+				{
+					mips->lo = a / b;
+					mips->hi = a % b;
+				}
+				else
+					mips->lo = mips->hi = 0;
+			}
+			break;
+
+		case IROP_LOAD8: R(inst->dest) = Memory::Read_U8(R(inst->src1) + inst->constant); break;
+		case IROP_LOAD8EXT: R(inst->dest) = (u32)(s32)(s8)Memory::Read_U8(R(inst->src1) + inst->constant); break;
+		case IROP_LOAD16: R(inst->dest) = Memory::Read_U16(R(inst->src1) + inst->constant); break;
+		case IROP_LOAD16EXT: R(inst->dest) = (u32)(s32)(s16)Memory::Read_U16(R(inst->src1) + inst->constant); break;
+		case IROP_LOAD32: R(inst->dest) = Memory::Read_U32(R(inst->src1) + inst->constant); break;
+		case IROP_STORE8: Memory::Write_U8((u8)R(inst->src2), R(inst->src1) + inst->constant); break;
+		case IROP_STORE16: Memory::Write_U16((u16)R(inst->src2), R(inst->src1) + inst->constant); break;
+		case IROP_STORE32: Memory::Write_U32(R(inst->src2), R(inst->src1) + inst->constant); break;
+
+		case IROP_SETPCCONST:
+			mips->pc = inst->constant;
+			break;
+		case IROP_INTERPRET:
+			MIPSInterpret(inst->constant);
+			break;
+		case IROP_SYSCALL:
+			// This may reschedule or even invalidate this block, so always leave right after.
+			CallSyscall(inst->constant);
+			return;
+
+		case IROP_EXITTOCONST:
+			mips->pc = inst->constant;
+			return;
+		case IROP_EXITTOCONSTIFEQ:
+		case IROP_EXITTOCONSTIFNEQ:
+		case IROP_EXITTOCONSTIFGTZ:
+		case IROP_EXITTOCONSTIFGEZ:
+		case IROP_EXITTOCONSTIFLTZ:
+		case IROP_EXITTOCONSTIFLEZ:
+			if (EvalIRExitCondition(inst->op, R(inst->src1), R(inst->src2)))
+			{
+				mips->pc = inst->constant;
+				return;
+			}
+			break;
+		case IROP_EXITTOREG:
+			mips->pc = R(inst->src1);
+			return;
+		case IROP_EXITTOPC:
+			return;
+
+		case IROP_INTERPRETBRANCH:
+			// Same as MIPSInterpret_RunUntil: the branch, then its delay slot if it has one.
+			MIPSInterpret(inst->constant);
+			if (mips->inDelaySlot)
+			{
+				MIPSInterpret(Memory::Read_Instruction(mips->pc));
+				if (mips->inDelaySlot)
+				{
+					mips->pc = mips->nextPC;
+					mips->inDelaySlot = false;
+				}
+			}
+			return;
+
+		default:
+			_dbg_assert_msg_(JIT, 0, "Bad IR op");
+			return;
+		}
+		++inst;
+	}
+}
+
+#undef R
+
+}  // namespace MIPSComp
@@ -0,0 +1,88 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Core/MIPS/JitCommon/JitBlockIndex.h"
+#include "IRFrontend.h"
+
+class MIPSState;
+class PointerWrap;
+
+namespace MIPSComp
+{
+
+// Runs MIPS code by translating it into optimized IR blocks and interpreting
+// those.  Doesn't need a code emitter, so it works on any host, and is a good
+// deal faster than MIPSInterpret_RunUntil on straight-line code.
+//
+// Unlike the JIT, no emuhacks are written to RAM: blocks are looked up by
+// address, and the first op is compared on entry to catch overwritten code.
+class IRInterpreter
+{
+public:
+	IRInterpreter(MIPSState *mips);
+	~IRInterpreter();
+
+	void DoState(PointerWrap &p);
+	void RunLoopUntil(u64 globalticks);
+
+	void ClearCache();
+	void ClearCacheAt(u32 em_address);
+	void InvalidateICache(u32 address, u32 length);
+
+	int GetNumBlocks() const { return (int)blocks_.size(); }
+	// Returns NULL if there's no block at this address.
+	const IRBlock *GetBlockAt(u32 em_address) const;
+
+private:
+	IRBlock *GetOrCompileBlock(u32 em_address);
+	IRBlock *Compile(u32 em_address);
+	void DestroyBlock(int block_num);
+	void RunBlock(const IRBlock *block);
+
+	enum
+	{
+		MAX_NUM_BLOCKS = 65536,
+		// Must be a power of two.
+		LOOKUP_SIZE = 0x1000,
+	};
+
+	MIPSState *mips_;
+	IRFrontend frontend_;
+
+	std::vector<IRBlock *> blocks_;
+	std::map<u32, int> blockMap_;
+	JitBlockIndex blockIndex_;
+	std::vector<int> invalidated_;
+
+	// Direct mapped cache in front of blockMap_, most lookups hit here.
+	u32 lookupAddr_[LOOKUP_SIZE];
+	int lookupBlock_[LOOKUP_SIZE];
+
+	// IR register number to storage: the GPRs and HI/LO in MIPSState, then temps.
+	u32 *regs_[IRREG_COUNT];
+	u32 temps_[IRREG_NUM_TEMPS];
+};
+
+extern IRInterpreter *irInterpreter;
+
+}  // namespace MIPSComp
@@ -0,0 +1,510 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstring>
+
+#include "IRPasses.h"
+
+namespace MIPSComp
+{
+
+static const u8 NO_COPY = 0xFF;
+
+static inline void MakeNop(IRInst &inst)
+{
+	inst.op = IROP_NOP;
+	inst.dest = 0;
+	inst.src1 = 0;
+	inst.src2 = 0;
+	inst.constant = 0;
+}
+
+// Everything after an unconditional exit is unreachable.
+static void KillAfter(IRBlock *block, size_t i)
+{
+	for (size_t j = i + 1; j < block->insts.size(); ++j)
+		MakeNop(block->insts[j]);
+}
+
+struct ConstState
+{
+	bool known[IRREG_COUNT];
+	u32 value[IRREG_COUNT];
+	// For temps, the register they're currently a copy of.
+	u8 copyOf[IRREG_COUNT];
+
+	void Reset()
+	{
+		memset(known, 0, sizeof(known));
+		memset(copyOf, NO_COPY, sizeof(copyOf));
+		known[IRREG_ZERO] = true;
+		value[IRREG_ZERO] = 0;
+	}
+
+	void Written(u8 reg)
+	{
+		if (reg == IRREG_ZERO)
+			return;
+		known[reg] = false;
+		copyOf[reg] = NO_COPY;
+		for (int t = IRREG_TEMP0; t < IRREG_COUNT; ++t)
+		{
+			if (copyOf[t] == reg)
+				copyOf[t] = NO_COPY;
+		}
+	}
+
+	void SetKnown(u8 reg, u32 val)
+	{
+		Written(reg);
+		known[reg] = true;
+		value[reg] = val;
+	}
+};
+
+// Turns "op d, s1, s2" into "opconst d, s1, c" when s2 (or s1, if the op is commutative) is known.
+static bool SimplifyWithConstant(IRInst &inst, const ConstState &state)
+{
+	IROp constOp = IROP_NOP;
+	bool commutative = false;
+	switch (inst.op)
+	{
+	case IROP_ADD: constOp = IROP_ADDCONST; commutative = true; break;
+	case IROP_AND: constOp = IROP_ANDCONST; commutative = true; break;
+	case IROP_OR: constOp = IROP_ORCONST; commutative = true; break;
+	case IROP_XOR: constOp = IROP_XORCONST; commutative = true; break;
+	case IROP_SUB: constOp = IROP_ADDCONST; break;
+	case IROP_SLT: constOp = IROP_SLTCONST; break;
+	case IROP_SLTU: constOp = IROP_SLTUCONST; break;
+	case IROP_SHL: constOp = IROP_SHLIMM; break;
+	case IROP_SHR: constOp = IROP_SHRIMM; break;
+	case IROP_SAR: constOp = IROP_SARIMM; break;
+	case IROP_ROR: constOp = IROP_RORIMM; break;
+	default:
+		return false;
+	}
+
+	if (state.known[inst.src2])
+	{
+		u32 c = state.value[inst.src2];
+		if (inst.op == IROP_SUB)
+			c = (u32)-(s32)c;
+		else if (constOp >= IROP_SHLIMM && constOp <= IROP_RORIMM)
+			c &= 31;
+		inst.op = constOp;
+		inst.constant = c;
+		inst.src2 = 0;
+		return true;
+	}
+	if (commutative && state.known[inst.src1])
+	{
+		inst.op = constOp;
+		inst.constant = state.value[inst.src1];
+		inst.src1 = inst.src2;
+		inst.src2 = 0;
+		return true;
+	}
+	return false;
+}
+
+static bool IsIdentity(const IRInst &inst)
+{
+	switch (inst.op)
+	{
+	case IROP_ADDCONST:
+	case IROP_ORCONST:
+	case IROP_XORCONST:
+	case IROP_SHLIMM:
+	case IROP_SHRIMM:
+	case IROP_SARIMM:
+	case IROP_RORIMM:
+		return inst.constant == 0;
+	case IROP_ANDCONST:
+		return inst.constant == 0xFFFFFFFF;
+	default:
+		return false;
+	}
+}
+
+bool PropagateConstants(IRBlock *block)
+{
+	bool changed = false;
+	ConstState state;
+	state.Reset();
+
+	for (size_t i = 0; i < block->insts.size(); ++i)
+	{
+		IRInst &inst = block->insts[i];
+		const u32 flags = GetIRMeta(inst.op).flags;
+
+		if (flags & IRFLAG_BARRIER)
+		{
+			state.Reset();
+			continue;
+		}
+
+		// Read the original register rather than a temp copy of it.
+		if ((flags & IRFLAG_SRC1) && state.copyOf[inst.src1] != NO_COPY)
+		{
+			inst.src1 = state.copyOf[inst.src1];
+			changed = true;
+		}
+		if ((flags & IRFLAG_SRC2) && state.copyOf[inst.src2] != NO_COPY)
+		{
+			inst.src2 = state.copyOf[inst.src2];
+			changed = true;
+		}
+
+		if (flags & IRFLAG_FOLDABLE)
+		{
+			const bool known1 = !(flags & IRFLAG_SRC1) || state.known[inst.src1];
+			const bool known2 = !(flags & IRFLAG_SRC2) || state.known[inst.src2];
+			if (known1 && known2)
+			{
+				u32 result = EvalIRFoldable(inst.op, state.value[inst.src1], state.value[inst.src2], inst.constant);
+				if (inst.op != IROP_SETCONST)
+				{
+					inst.op = IROP_SETCONST;
+					inst.src1 = 0;
+					inst.src2 = 0;
+					inst.constant = result;
+					changed = true;
+				}
+				state.SetKnown(inst.dest, result);
+				continue;
+			}
+
+			if (SimplifyWithConstant(inst, state))
+				changed = true;
+			if (IsIdentity(inst))
+			{
+				inst.op = IROP_MOV;
+				inst.constant = 0;
+				changed = true;
+			}
+
+			if (inst.op == IROP_MOV && inst.dest == inst.src1)
+			{
+				MakeNop(inst);
+				changed = true;
+				continue;
+			}
+
+			state.Written(inst.dest);
+			if (inst.op == IROP_MOV && inst.dest >= IRREG_TEMP0)
+				state.copyOf[inst.dest] = inst.src1;
+			continue;
+		}
+
+		switch (inst.op)
+		{
+		case IROP_MOVZ:
+		case IROP_MOVN:
+			if (state.known[inst.src2])
+			{
+				const bool move = (state.value[inst.src2] == 0) == (inst.op == IROP_MOVZ);
+				changed = true;
+				if (!move)
+				{
+					MakeNop(inst);
+					continue;
+				}
+				inst.op = IROP_MOV;
+				inst.src2 = 0;
+				if (state.known[inst.src1])
+				{
+					inst.op = IROP_SETCONST;
+					inst.constant = state.value[inst.src1];
+					inst.src1 = 0;
+					state.SetKnown(inst.dest, inst.constant);
+					continue;
+				}
+			}
+			state.Written(inst.dest);
+			break;
+
+		case IROP_LOAD8:
+		case IROP_LOAD8EXT:
+		case IROP_LOAD16:
+		case IROP_LOAD16EXT:
+		case IROP_LOAD32:
+		case IROP_STORE8:
+		case IROP_STORE16:
+		case IROP_STORE32:
+			// Fold a known base into the offset.
+			if (inst.src1 != IRREG_ZERO && state.known[inst.src1])
+			{
+				inst.constant += state.value[inst.src1];
+				inst.src1 = IRREG_ZERO;
+				changed = true;
+			}
+			if (flags & IRFLAG_DEST)
+				state.Written(inst.dest);
+			break;
+
+		case IROP_EXITTOCONSTIFEQ:
+		case IROP_EXITTOCONSTIFNEQ:
+		case IROP_EXITTOCONSTIFGTZ:
+		case IROP_EXITTOCONSTIFGEZ:
+		case IROP_EXITTOCONSTIFLTZ:
+		case IROP_EXITTOCONSTIFLEZ:
+			if (state.known[inst.src1] && (!(flags & IRFLAG_SRC2) || state.known[inst.src2]))
+			{
+				changed = true;
+				if (EvalIRExitCondition(inst.op, state.value[inst.src1], state.value[inst.src2]))
+				{
+					inst.op = IROP_EXITTOCONST;
+					inst.src1 = 0;
+					inst.src2 = 0;
+					KillAfter(block, i);
+				}
+				else
+					MakeNop(inst);
+			}
+			break;
+
+		case IROP_EXITTOREG:
+			if (state.known[inst.src1])
+			{
+				inst.op = IROP_EXITTOCONST;
+				inst.constant = state.value[inst.src1];
+				inst.src1 = 0;
+				changed = true;
+				KillAfter(block, i);
+			}
+			break;
+
+		case IROP_EXITTOCONST:
+		case IROP_EXITTOPC:
+			KillAfter(block, i);
+			break;
+
+		default:
+			if (flags & IRFLAG_HILO_OUT)
+			{
+				state.Written(IRREG_HI);
+				state.Written(IRREG_LO);
+			}
+			else if (flags & IRFLAG_DEST)
+				state.Written(inst.dest);
+			break;
+		}
+	}
+
+	return changed;
+}
+
+struct MemEntry
+{
+	u8 base;
+	u8 value;
+	// The load op this entry can satisfy.  32-bit stores are recorded as IROP_LOAD32.
+	u8 loadOp;
+	u32 offset;
+	u32 size;
+	// Index of a store nothing has read yet, or -1.
+	int pendingStore;
+};
+
+static u32 MemOpSize(u8 op)
+{
+	switch (op)
+	{
+	case IROP_LOAD8:
+	case IROP_LOAD8EXT:
+	case IROP_STORE8:
+		return 1;
+	case IROP_LOAD16:
+	case IROP_LOAD16EXT:
+	case IROP_STORE16:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+static void ForgetRegister(std::vector<MemEntry> &entries, u8 reg)
+{
+	for (size_t i = 0; i < entries.size(); )
+	{
+		if (entries[i].base == reg || entries[i].value == reg)
+		{
+			entries[i] = entries.back();
+			entries.pop_back();
+		}
+		else
+			++i;
+	}
+}
+
+bool ForwardLoadsAndStores(IRBlock *block)
+{
+	// Blocks are short, a linear list is plenty.
+	std::vector<MemEntry> entries;
+	bool changed = false;
+
+	for (size_t i = 0; i < block->insts.size(); ++i)
+	{
+		IRInst &inst = block->insts[i];
+		const u32 flags = GetIRMeta(inst.op).flags;
+
+		if (flags & IRFLAG_BARRIER)
+		{
+			entries.clear();
+			continue;
+		}
+		if (flags & IRFLAG_EXIT)
+		{
+			// Memory has to be complete if we leave here.
+			for (size_t j = 0; j < entries.size(); ++j)
+				entries[j].pendingStore = -1;
+			continue;
+		}
+
+		if (flags & IRFLAG_LOAD)
+		{
+			// We can't tell what the load might alias, so no store before it is dead.
+			for (size_t j = 0; j < entries.size(); ++j)
+				entries[j].pendingStore = -1;
+
+			int found = -1;
+			for (size_t j = 0; j < entries.size(); ++j)
+			{
+				if (entries[j].base == inst.src1 && entries[j].offset == inst.constant && entries[j].loadOp == inst.op)
+					found = (int)j;
+			}
+
+			if (found != -1)
+			{
+				const u8 value = entries[found].value;
+				changed = true;
+				if (value == inst.dest)
+				{
+					MakeNop(inst);
+					continue;
+				}
+				inst.op = IROP_MOV;
+				inst.src1 = value;
+				inst.constant = 0;
+				ForgetRegister(entries, inst.dest);
+				continue;
+			}
+
+			ForgetRegister(entries, inst.dest);
+			if (inst.dest != inst.src1)
+			{
+				MemEntry entry = {inst.src1, inst.dest, inst.op, inst.constant, MemOpSize(inst.op), -1};
+				entries.push_back(entry);
+			}
+			continue;
+		}
+
+		if (flags & IRFLAG_STORE)
+		{
+			const u32 size = MemOpSize(inst.op);
+			for (size_t j = 0; j < entries.size(); )
+			{
+				MemEntry &e = entries[j];
+				if (inst.op == IROP_STORE32 && e.pendingStore != -1 && e.base == inst.src1 && e.offset == inst.constant)
+				{
+					// Overwritten before anyone looked at it.
+					MakeNop(block->insts[e.pendingStore]);
+					changed = true;
+				}
+
+				// Only accesses relative to the same base are known not to overlap.
+				const bool disjoint = e.base == inst.src1 && (e.offset + e.size <= inst.constant || inst.constant + size <= e.offset);
+				if (!disjoint)
+				{
+					e = entries.back();
+					entries.pop_back();
+				}
+				else
+					++j;
+			}
+
+			if (inst.op == IROP_STORE32)
+			{
+				MemEntry entry = {inst.src1, inst.src2, IROP_LOAD32, inst.constant, 4, (int)i};
+				entries.push_back(entry);
+			}
+			continue;
+		}
+
+		if (flags & IRFLAG_DEST)
+			ForgetRegister(entries, inst.dest);
+	}
+
+	return changed;
+}
+
+bool EliminateDeadCode(IRBlock *block)
+{
+	const u64 archRegs = (1ULL << IRREG_TEMP0) - 1;
+	u64 live = archRegs;
+	bool changed = false;
+
+	for (size_t n = block->insts.size(); n > 0; --n)
+	{
+		IRInst &inst = block->insts[n - 1];
+		const u32 flags = GetIRMeta(inst.op).flags;
+
+		if (flags & (IRFLAG_EXIT | IRFLAG_BARRIER))
+			live |= archRegs;
+
+		u64 writes = 0;
+		if (flags & IRFLAG_DEST)
+			writes |= 1ULL << inst.dest;
+		if (flags & IRFLAG_HILO_OUT)
+			writes |= (1ULL << IRREG_HI) | (1ULL << IRREG_LO);
+
+		if (writes != 0 && (writes & live) == 0 && !(flags & (IRFLAG_STORE | IRFLAG_BARRIER | IRFLAG_EXIT)))
+		{
+			MakeNop(inst);
+			changed = true;
+			continue;
+		}
+
+		live &= ~writes;
+		if (flags & IRFLAG_SRCDEST)
+			live |= 1ULL << inst.dest;
+		if (flags & IRFLAG_SRC1)
+			live |= 1ULL << inst.src1;
+		if (flags & IRFLAG_SRC2)
+			live |= 1ULL << inst.src2;
+		if (flags & IRFLAG_HILO_IN)
+			live |= (1ULL << IRREG_HI) | (1ULL << IRREG_LO);
+	}
+
+	return changed;
+}
+
+void OptimizeIRBlock(IRBlock *block)
+{
+	// Each pass can expose work for the others, but it settles quickly.
+	for (int i = 0; i < 4; ++i)
+	{
+		bool changed = ForwardLoadsAndStores(block);
+		changed = PropagateConstants(block) || changed;
+		changed = EliminateDeadCode(block) || changed;
+		block->Compact();
+		if (!changed)
+			break;
+	}
+}
+
+}  // namespace MIPSComp
@@ -0,0 +1,44 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include "IRInst.h"
+
+namespace MIPSComp
+{
+
+// Each pass returns true if it changed anything.  Removed instructions are
+// turned into NOPs, IRBlock::Compact() gets rid of them.
+
+// Constant folding and propagation, plus copy propagation out of temps.
+// Also resolves branches whose condition is known.
+bool PropagateConstants(IRBlock *block);
+
+// Replaces loads from an address that was just loaded or stored (same base
+// register and offset) with a move, and drops 32-bit stores that are
+// overwritten before anything could read them.
+bool ForwardLoadsAndStores(IRBlock *block);
+
+// Removes writes to registers (including HI/LO) that are overwritten before
+// they're read or the block can exit.
+bool EliminateDeadCode(IRBlock *block);
+
+// Runs all of the above until nothing changes.
+void OptimizeIRBlock(IRBlock *block);
+
+}  // namespace MIPSComp
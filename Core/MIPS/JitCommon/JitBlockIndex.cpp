@@ -0,0 +1,181 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstring>
+
+#include "JitBlockIndex.h"
+
+JitBlockIndex::JitBlockIndex()
+	: maxBlocks_(0), blockStart_(0), blockEnd_(0), linkNext_(0), linkTarget_(0)
+{
+	memset(linkHeads_, 0xFF, sizeof(linkHeads_));
+}
+
+JitBlockIndex::~JitBlockIndex()
+{
+	Shutdown();
+}
+
+void JitBlockIndex::Init(int maxBlocks)
+{
+	Shutdown();
+	maxBlocks_ = maxBlocks;
+	blockStart_ = new u32[maxBlocks];
+	blockEnd_ = new u32[maxBlocks];
+	linkNext_ = new int[maxBlocks * 2];
+	linkTarget_ = new u32[maxBlocks * 2];
+	Clear();
+}
+
+void JitBlockIndex::Shutdown()
+{
+	delete [] blockStart_;
+	delete [] blockEnd_;
+	delete [] linkNext_;
+	delete [] linkTarget_;
+	blockStart_ = 0;
+	blockEnd_ = 0;
+	linkNext_ = 0;
+	linkTarget_ = 0;
+	maxBlocks_ = 0;
+}
+
+void JitBlockIndex::Clear()
+{
+	// clear() keeps the capacity, so after warmup we don't allocate here anymore.
+	for (int i = 0; i < NUM_PAGES; ++i)
+		pages_[i].clear();
+	outside_.clear();
+
+	memset(linkHeads_, 0xFF, sizeof(linkHeads_));
+	if (maxBlocks_ != 0)
+	{
+		memset(blockStart_, 0, sizeof(u32) * maxBlocks_);
+		memset(blockEnd_, 0, sizeof(u32) * maxBlocks_);
+		memset(linkNext_, 0xFF, sizeof(int) * maxBlocks_ * 2);
+	}
+}
+
+void JitBlockIndex::AddBlock(int block_num, u32 start, u32 end)
+{
+	blockStart_[block_num] = start;
+	blockEnd_[block_num] = end;
+
+	if (InRAM(start, end))
+	{
+		const u32 firstPage = (start - RAM_START) >> PAGE_SHIFT;
+		const u32 lastPage = (end - 1 - RAM_START) >> PAGE_SHIFT;
+		for (u32 page = firstPage; page <= lastPage; ++page)
+			pages_[page].push_back(block_num);
+	}
+	else
+		outside_.push_back(block_num);
+}
+
+static inline void EraseBlockNum(std::vector<int> &list, int block_num)
+{
+	// Order doesn't matter, so just swap the last one in.
+	std::vector<int>::iterator it = std::find(list.begin(), list.end(), block_num);
+	if (it != list.end())
+	{
+		*it = list.back();
+		list.pop_back();
+	}
+}
+
+void JitBlockIndex::RemoveBlock(int block_num)
+{
+	const u32 start = blockStart_[block_num];
+	const u32 end = blockEnd_[block_num];
+	if (start == end)
+		return;
+
+	if (InRAM(start, end))
+	{
+		const u32 firstPage = (start - RAM_START) >> PAGE_SHIFT;
+		const u32 lastPage = (end - 1 - RAM_START) >> PAGE_SHIFT;
+		for (u32 page = firstPage; page <= lastPage; ++page)
+			EraseBlockNum(pages_[page], block_num);
+	}
+	else
+		EraseBlockNum(outside_, block_num);
+
+	blockStart_[block_num] = 0;
+	blockEnd_[block_num] = 0;
+}
+
+void JitBlockIndex::GetBlocksInRange(u32 start, u32 length, std::vector<int> &out) const
+{
+	if (length == 0)
+		return;
+	// Clamp instead of wrapping past the top of the address space.
+	const u32 end = length > 0xFFFFFFFF - start ? 0xFFFFFFFF : start + length;
+
+	for (size_t i = 0; i < outside_.size(); ++i)
+	{
+		int b = outside_[i];
+		if (blockStart_[b] < end && blockEnd_[b] > start)
+			out.push_back(b);
+	}
+
+	if (end <= RAM_START || start >= RAM_END)
+		return;
+
+	const u32 firstPage = (std::max(start, (u32)RAM_START) - RAM_START) >> PAGE_SHIFT;
+	const u32 lastPage = (std::min(end, (u32)RAM_END) - 1 - RAM_START) >> PAGE_SHIFT;
+	for (u32 page = firstPage; page <= lastPage; ++page)
+	{
+		const std::vector<int> &list = pages_[page];
+		for (size_t i = 0; i < list.size(); ++i)
+		{
+			int b = list[i];
+			if (blockStart_[b] >= end || blockEnd_[b] <= start)
+				continue;
+			// A block spanning several pages is on each list, only report it on the first we scan.
+			const u32 blockFirstPage = (blockStart_[b] - RAM_START) >> PAGE_SHIFT;
+			if (page == std::max(firstPage, blockFirstPage))
+				out.push_back(b);
+		}
+	}
+}
+
+void JitBlockIndex::AddLink(u32 target, int block_num, int exit_num)
+{
+	const int link = block_num * 2 + exit_num;
+	const u32 bucket = LinkHash(target);
+	linkTarget_[link] = target;
+	linkNext_[link] = linkHeads_[bucket];
+	linkHeads_[bucket] = link;
+}
+
+int JitBlockIndex::FindLinkFrom(int link, u32 target) const
+{
+	while (link != -1 && linkTarget_[link] != target)
+		link = linkNext_[link];
+	return link;
+}
+
+int JitBlockIndex::FirstLinkTo(u32 target) const
+{
+	return FindLinkFrom(linkHeads_[LinkHash(target)], target);
+}
+
+int JitBlockIndex::NextLinkTo(int link, u32 target) const
+{
+	return FindLinkFrom(linkNext_[link], target);
+}
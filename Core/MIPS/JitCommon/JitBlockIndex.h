@@ -0,0 +1,92 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+// Address bookkeeping shared by the x86 and ARM JitBlockCaches.
+//
+// Blocks are tracked in per-4KB-page lists over main RAM, so invalidating a
+// range only looks at the blocks on the pages it touches.  Exit links are kept
+// in a fixed-size hash table whose nodes live in a flat array indexed by
+// (block_num * 2 + exit_num), so adding a link never allocates.
+//
+// All addresses passed in should already be physical (mirror bits stripped.)
+
+class JitBlockIndex
+{
+public:
+	JitBlockIndex();
+	~JitBlockIndex();
+
+	void Init(int maxBlocks);
+	void Shutdown();
+	void Clear();
+
+	// Ranges are [start, end), in bytes.
+	void AddBlock(int block_num, u32 start, u32 end);
+	void RemoveBlock(int block_num);
+
+	// Appends the (live) blocks overlapping [start, start + length) to out.
+	void GetBlocksInRange(u32 start, u32 length, std::vector<int> &out) const;
+
+	void AddLink(u32 target, int block_num, int exit_num);
+
+	// Iterates the exits that jump to target.  Use LinkBlock()/LinkExit() on the result.
+	//   for (int l = FirstLinkTo(addr); l != -1; l = NextLinkTo(l, addr)) ...
+	int FirstLinkTo(u32 target) const;
+	int NextLinkTo(int link, u32 target) const;
+	static int LinkBlock(int link) { return link >> 1; }
+	static int LinkExit(int link) { return link & 1; }
+
+private:
+	enum
+	{
+		PAGE_SHIFT = 12,
+		RAM_START = 0x08000000,
+		RAM_END = 0x0A000000,
+		NUM_PAGES = (RAM_END - RAM_START) >> PAGE_SHIFT,
+
+		// Must be a power of two.
+		LINK_BUCKETS = 0x4000,
+	};
+
+	static u32 LinkHash(u32 target) {
+		return (target >> 2) & (LINK_BUCKETS - 1);
+	}
+	bool InRAM(u32 start, u32 end) const {
+		return start >= RAM_START && end <= RAM_END && start < end;
+	}
+	int FindLinkFrom(int link, u32 target) const;
+
+	int maxBlocks_;
+
+	// Per block: its range, or start == end if not in the index.
+	u32 *blockStart_;
+	u32 *blockEnd_;
+
+	std::vector<int> pages_[NUM_PAGES];
+	// Blocks outside main RAM (scratchpad, etc.) are rare, they're just kept in a list.
+	std::vector<int> outside_;
+
+	int linkHeads_[LINK_BUCKETS];
+	int *linkNext_;
+	u32 *linkTarget_;
+};
@@ -0,0 +1,113 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include "Common/Hash.h"
+#include "Core/MemMap.h"
+#include "JitDiskCache.h"
+
+// Blocks longer than this are suspicious, and not worth persisting.
+static const u32 MAX_CACHED_BLOCK_INSTRUCTIONS = 4096;
+
+u32 JitDiskCache::HashWords(const u32 *words, u32 count)
+{
+	return HashAdler32((const u8 *)words, count * sizeof(u32));
+}
+
+u32 JitDiskCache::Open(const std::string &filename, u32 jitVersion, u32 optionsHash)
+{
+	Close();
+	jitVersion_ = jitVersion;
+	optionsHash_ = optionsHash;
+	u32 count = file_.OpenAndRead(filename.c_str(), *this);
+	open_ = true;
+	int current = 0;
+	for (auto it = entries_.begin(), end = entries_.end(); it != end; ++it)
+	{
+		if (it->first.optionsHash == optionsHash_)
+			++current;
+	}
+	INFO_LOG(JIT, "JIT disk cache: %s, %d blocks (%d for current options)", filename.c_str(), count, current);
+	return count;
+}
+
+void JitDiskCache::Close()
+{
+	if (open_)
+	{
+		file_.Sync();
+		file_.Close();
+	}
+	entries_.clear();
+	open_ = false;
+}
+
+void JitDiskCache::Read(const JitDiskCacheKey &key, const u32 *value, u32 value_size)
+{
+	// Blocks compiled with other options are kept too, the options may be switched to later.
+	if (key.jitVersion != jitVersion_ || key.numInstructions != value_size)
+		return;
+	if (HashWords(value, value_size) != key.wordsHash)
+		return;
+	entries_[key].assign(value, value + value_size);
+}
+
+void JitDiskCache::RecordBlock(u32 emAddress, u32 numInstructions)
+{
+	if (!open_ || numInstructions == 0 || numInstructions > MAX_CACHED_BLOCK_INSTRUCTIONS)
+		return;
+	if (!Memory::IsValidAddress(emAddress) || !Memory::IsValidAddress(emAddress + numInstructions * 4 - 4))
+		return;
+
+	std::vector<u32> words(numInstructions);
+	for (u32 i = 0; i < numInstructions; ++i)
+		words[i] = Memory::Read_Instruction(emAddress + i * 4);
+
+	JitDiskCacheKey key;
+	key.emAddress = emAddress;
+	key.numInstructions = numInstructions;
+	key.jitVersion = jitVersion_;
+	key.optionsHash = optionsHash_;
+	key.wordsHash = HashWords(&words[0], numInstructions);
+
+	// Already known, e.g. loaded from the file or recompiled after a clear.
+	if (entries_.find(key) != entries_.end())
+		return;
+
+	file_.Append(key, &words[0], numInstructions);
+	entries_[key].swap(words);
+}
+
+void JitDiskCache::GetValidBlocks(std::vector<u32> &addresses) const
+{
+	for (auto it = entries_.begin(), end = entries_.end(); it != end; ++it)
+	{
+		const JitDiskCacheKey &key = it->first;
+		const std::vector<u32> &words = it->second;
+		if (key.optionsHash != optionsHash_)
+			continue;
+		if (!Memory::IsValidAddress(key.emAddress) || !Memory::IsValidAddress(key.emAddress + key.numInstructions * 4 - 4))
+			continue;
+
+		bool matches = true;
+		for (u32 i = 0; i < key.numInstructions && matches; ++i)
+			matches = Memory::Read_Instruction(key.emAddress + i * 4) == words[i];
+
+		// Several versions of the same address may be cached (overlays), only one can match.
+		if (matches && (addresses.empty() || addresses.back() != key.emAddress))
+			addresses.push_back(key.emAddress);
+	}
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/LinearDiskCache.h"
+
+// Persistent record of the blocks the JIT has compiled for a game.
+//
+// Emitted host code is full of absolute pointers (MIPSState, Memory::base,
+// thunks, the dispatcher) so it can't just be dumped and reloaded.  Instead we
+// store the MIPS words of every block, keyed by their hash and the JIT options
+// in effect, and recompile the blocks that still match RAM right after boot.
+// That moves translation out of the first minutes of gameplay and into loading.
+
+struct JitDiskCacheKey
+{
+	u32 emAddress;
+	u32 numInstructions;
+	// Bumped by the JIT when block boundaries or compile assumptions change, older entries are ignored.
+	u32 jitVersion;
+	u32 optionsHash;
+	u32 wordsHash;
+
+	bool operator < (const JitDiskCacheKey &other) const {
+		if (emAddress != other.emAddress)
+			return emAddress < other.emAddress;
+		if (jitVersion != other.jitVersion)
+			return jitVersion < other.jitVersion;
+		if (wordsHash != other.wordsHash)
+			return wordsHash < other.wordsHash;
+		if (numInstructions != other.numInstructions)
+			return numInstructions < other.numInstructions;
+		return optionsHash < other.optionsHash;
+	}
+};
+
+class JitDiskCache : public LinearDiskCacheReader<JitDiskCacheKey, u32>
+{
+public:
+	JitDiskCache() : jitVersion_(0), optionsHash_(0), open_(false) {}
+	~JitDiskCache() { Close(); }
+
+	// Returns the number of entries read from an existing file.
+	u32 Open(const std::string &filename, u32 jitVersion, u32 optionsHash);
+	void Close();
+	bool IsOpen() const { return open_; }
+	// Later records and GetValidBlocks() use the new options, entries for the old ones are kept.
+	void SetOptionsHash(u32 optionsHash) { optionsHash_ = optionsHash; }
+
+	// Call after a block has been compiled (and before its first op is replaced.)
+	void RecordBlock(u32 emAddress, u32 numInstructions);
+
+	// Returns the start addresses of cached blocks for the current options whose code still matches RAM.
+	void GetValidBlocks(std::vector<u32> &addresses) const;
+
+	static u32 HashWords(const u32 *words, u32 count);
+
+	// LinearDiskCacheReader
+	virtual void Read(const JitDiskCacheKey &key, const u32 *value, u32 value_size);
+
+private:
+	LinearDiskCache<JitDiskCacheKey, u32> file_;
+	std::map<JitDiskCacheKey, std::vector<u32> > entries_;
+	u32 jitVersion_;
+	u32 optionsHash_;
+	bool open_;
+};
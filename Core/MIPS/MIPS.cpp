@@ -31,6 +31,8 @@
 #include "x86/Jit.h"
 #endif
 #include "JitCommon/JitCommon.h"
+#include "IR/IRInterpreter.h"
+#include "MIPSCachedInterpreter.h"
 #include "../../Core/CoreTiming.h"
 
 MIPSState mipsr4k;
@@ -41,6 +43,8 @@ MIPSDebugInterface *currentDebugMIPS = &debugr4k;
 MIPSState::MIPSState()
 {
 	MIPSComp::jit = 0;
+	MIPSComp::irInterpreter = 0;
+	MIPSComp::cachedInterpreter = 0;
 }
 
 MIPSState::~MIPSState()
@@ -50,6 +54,16 @@ MIPSState::~MIPSState()
 		delete MIPSComp::jit;
 		MIPSComp::jit = 0;
 	}
+	if (MIPSComp::irInterpreter)
+	{
+		delete MIPSComp::irInterpreter;
+		MIPSComp::irInterpreter = 0;
+	}
+	if (MIPSComp::cachedInterpreter)
+	{
+		delete MIPSComp::cachedInterpreter;
+		MIPSComp::cachedInterpreter = 0;
+	}
 }
 
 void MIPSState::Reset()
@@ -59,9 +73,23 @@ void MIPSState::Reset()
 		delete MIPSComp::jit;
 		MIPSComp::jit = 0;
 	}
+	if (MIPSComp::irInterpreter)
+	{
+		delete MIPSComp::irInterpreter;
+		MIPSComp::irInterpreter = 0;
+	}
+	if (MIPSComp::cachedInterpreter)
+	{
+		delete MIPSComp::cachedInterpreter;
+		MIPSComp::cachedInterpreter = 0;
+	}
 		
 	if (PSP_CoreParameter().cpuCore == CPU_JIT)
 		MIPSComp::jit = new MIPSComp::Jit(this);
+	else if (PSP_CoreParameter().cpuCore == CPU_IRINTERPRETER)
+		MIPSComp::irInterpreter = new MIPSComp::IRInterpreter(this);
+	else if (PSP_CoreParameter().cpuCore == CPU_CACHEDINTERPRETER)
+		MIPSComp::cachedInterpreter = new MIPSComp::CachedInterpreter(this);
 
 	memset(r, 0, sizeof(r));
 	memset(f, 0, sizeof(f));
@@ -112,6 +140,10 @@ void MIPSState::DoState(PointerWrap &p)
 		Reset();
 	if (MIPSComp::jit)
 		MIPSComp::jit->DoState(p);
+	else if (MIPSComp::irInterpreter)
+		MIPSComp::irInterpreter->DoState(p);
+	else if (MIPSComp::cachedInterpreter)
+		MIPSComp::cachedInterpreter->DoState(p);
 
 	p.DoArray(r, sizeof(r) / sizeof(r[0]));
 	p.DoArray(f, sizeof(f) / sizeof(f[0]));
@@ -150,10 +182,29 @@ int MIPSState::RunLoopUntil(u64 globalTicks)
 
 	case CPU_INTERPRETER:
 		return MIPSInterpret_RunUntil(globalTicks);
+
+	case CPU_IRINTERPRETER:
+		MIPSComp::irInterpreter->RunLoopUntil(globalTicks);
+		break;
+
+	case CPU_CACHEDINTERPRETER:
+		MIPSComp::cachedInterpreter->RunLoopUntil(globalTicks);
+		break;
 	}
 	return 1;
 }
 
+void MIPSState::InvalidateICache(u32 address, u32 length)
+{
+	// Only the active core has anything compiled.
+	if (MIPSComp::jit)
+		MIPSComp::jit->GetBlockCache()->InvalidateICache(address, length);
+	if (MIPSComp::irInterpreter)
+		MIPSComp::irInterpreter->InvalidateICache(address, length);
+	if (MIPSComp::cachedInterpreter)
+		MIPSComp::cachedInterpreter->InvalidateICache(address, length);
+}
+
 void MIPSState::WriteFCR(int reg, int value)
 {
 	if (reg == 31)
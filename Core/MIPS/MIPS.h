@@ -157,6 +157,8 @@ public:
 
 	void SingleStep();
 	int RunLoopUntil(u64 globalTicks);
+	// Drops compiled code for this range, for code that was loaded or modified.
+	void InvalidateICache(u32 address, u32 length = 4);
 };
 
 
@@ -16,10 +16,13 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <map>
+#include <set>
+#include <algorithm>
 #include "../../Globals.h"
 
 #include "MIPS.h"
 #include "MIPSTables.h"
+#include "../MemMap.h"
 #include "MIPSAnalyst.h"
 #include "MIPSCodeUtils.h"
 #include "../Debugger/SymbolMap.h"
@@ -163,6 +166,279 @@ namespace MIPSAnalyst
 		return (op >> 26) == 0 && (op & 0x3f) == 12;
 	}
 
+	// Registers read and written by the ops allowed in an idle loop: loads, integer ALU ops
+	// and conditional branches.  Returns false for anything else (stores, calls, FPU...)
+	static bool GetIdleLoopOpRegs(u32 op, u32 &readMask, u32 &writeMask)
+	{
+		const u32 rs = 1 << MIPS_GET_RS(op);
+		const u32 rt = 1 << MIPS_GET_RT(op);
+		const u32 rd = 1 << MIPS_GET_RD(op);
+
+		switch (op >> 26)
+		{
+		case 0:
+			switch (op & 0x3F)
+			{
+			case 0: case 2: case 3: // sll, srl/rotr, sra (and nop)
+				readMask = rt;
+				writeMask = rd;
+				return true;
+			case 4: case 6: case 7: // sllv, srlv/rotrv, srav
+			case 32: case 33: case 34: case 35: // add, addu, sub, subu
+			case 36: case 37: case 38: case 39: // and, or, xor, nor
+			case 42: case 43: // slt, sltu
+				readMask = rs | rt;
+				writeMask = rd;
+				return true;
+			default:
+				return false;
+			}
+
+		case 1:
+			// bltz, bgez, bltzl, bgezl, not the linking ones.
+			if (MIPS_GET_RT(op) > 3)
+				return false;
+			readMask = rs;
+			writeMask = 0;
+			return true;
+
+		case 4: case 5: case 20: case 21: // beq, bne, beql, bnel
+			readMask = rs | rt;
+			writeMask = 0;
+			return true;
+
+		case 6: case 7: case 22: case 23: // blez, bgtz, blezl, bgtzl
+			readMask = rs;
+			writeMask = 0;
+			return true;
+
+		case 8: case 9: case 10: case 11: // addi, addiu, slti, sltiu
+		case 12: case 13: case 14: // andi, ori, xori
+		case 32: case 33: case 35: case 36: case 37: // lb, lh, lw, lbu, lhu
+			readMask = rs;
+			writeMask = rt;
+			return true;
+
+		case 15: // lui
+			readMask = 0;
+			writeMask = rt;
+			return true;
+
+		default:
+			return false;
+		}
+	}
+
+	// lui, or addiu/ori/xori from $zero: sets rt to a value that doesn't depend on any register.
+	static bool GetConstantWrite(u32 op, int &reg, u32 &value)
+	{
+		const u32 imm = op & 0xFFFF;
+		switch (op >> 26)
+		{
+		case 15: // lui
+			value = imm << 16;
+			break;
+		case 9: // addiu
+			if (MIPS_GET_RS(op) != 0)
+				return false;
+			value = (u32)(s32)(s16)imm;
+			break;
+		case 13: case 14: // ori, xori
+			if (MIPS_GET_RS(op) != 0)
+				return false;
+			value = imm;
+			break;
+		default:
+			return false;
+		}
+		reg = MIPS_GET_RT(op);
+		return true;
+	}
+
+	// True if the straight-line code falling into loopStart leaves value in reg.
+	static bool HasConstantOnEntry(u32 loopStart, int reg, u32 value)
+	{
+		const int MAX_LOOKBACK_OPS = 8;
+		for (int i = 1; i <= MAX_LOOKBACK_OPS; ++i)
+		{
+			const u32 addr = loopStart - 4 * i;
+			if (!Memory::IsValidAddress(addr - 4))
+				return false;
+			// Stop at any branch, or a delay slot, the path before it isn't known.
+			const u32 op = Memory::Read_Instruction(addr);
+			if ((MIPSGetInfo(op) & DELAYSLOT) != 0 || (MIPSGetInfo(Memory::Read_Instruction(addr - 4)) & DELAYSLOT) != 0)
+				return false;
+
+			int constReg;
+			u32 constValue;
+			if (GetConstantWrite(op, constReg, constValue) && constReg == reg)
+				return constValue == value;
+			u32 readMask, writeMask;
+			if (!GetIdleLoopOpRegs(op, readMask, writeMask) || (writeMask & (1 << reg)) != 0)
+				return false;
+		}
+		return false;
+	}
+
+	bool IsIdleLoop(u32 branchAddr)
+	{
+		// Polling loops are tiny, this is plenty.
+		const u32 MAX_IDLE_LOOP_OPS = 8;
+
+		const u32 op = Memory::Read_Instruction(branchAddr);
+		if ((MIPSGetInfo(op) & IS_CONDBRANCH) == 0)
+			return false;
+		const u32 target = branchAddr + 4 + ((signed short)(op & 0xFFFF) << 2);
+		if (target > branchAddr || branchAddr - target > 4 * MAX_IDLE_LOOP_OPS)
+			return false;
+
+		u32 loopOps[MAX_IDLE_LOOP_OPS + 2];
+		u32 written = 0;
+		u32 readBeforeWrite = 0;
+		// One iteration in execution order: the body, the branch, then its delay slot.
+		int numOps = 0;
+		for (u32 addr = target; addr <= branchAddr + 4; addr += 4, ++numOps)
+		{
+			const u32 loopOp = addr == branchAddr ? op : Memory::Read_Instruction(addr);
+			u32 readMask, writeMask;
+			if (!GetIdleLoopOpRegs(loopOp, readMask, writeMask))
+				return false;
+			// Only the loop branch itself, no other ways out.
+			if (addr != branchAddr && (MIPSGetInfo(loopOp) & DELAYSLOT) != 0)
+				return false;
+
+			loopOps[numOps] = loopOp;
+			readBeforeWrite |= readMask & ~written;
+			written |= writeMask;
+		}
+		// $zero never changes, writes to it don't count.
+		written &= ~1;
+
+		// A register carried into the next iteration makes the next one behave differently,
+		// so the loop may exit by itself.  The exception is a register that's always set to
+		// the same constant it already had on entry, like a lui of the base in the delay slot.
+		const u32 carried = readBeforeWrite & written;
+		for (int reg = 1; reg < 32; ++reg)
+		{
+			if ((carried & (1 << reg)) == 0)
+				continue;
+
+			bool haveValue = false;
+			u32 value = 0;
+			for (int i = 0; i < numOps; ++i)
+			{
+				int constReg;
+				u32 constValue;
+				if (GetConstantWrite(loopOps[i], constReg, constValue) && constReg == reg)
+				{
+					if (haveValue && constValue != value)
+						return false;
+					haveValue = true;
+					value = constValue;
+				}
+				else
+				{
+					u32 readMask, writeMask;
+					GetIdleLoopOpRegs(loopOps[i], readMask, writeMask);
+					if ((writeMask & (1 << reg)) != 0)
+						return false;
+				}
+			}
+			if (!HasConstantOnEntry(target, reg, value))
+				return false;
+		}
+		return true;
+	}
+
+	static bool IsLoopBackEdge(u32 op, u32 addr, u32 loopStart)
+	{
+		u32 target;
+		switch (op >> 26)
+		{
+		case 1:
+			// Only bltz and bgez, not the likely or linking ones.
+			if (MIPS_GET_RT(op) > 1)
+				return false;
+			target = addr + 4 + ((signed short)(op & 0xFFFF) << 2);
+			break;
+
+		case 4: case 5: case 6: case 7: // beq, bne, blez, bgtz
+			target = addr + 4 + ((signed short)(op & 0xFFFF) << 2);
+			break;
+
+		case 2: // j
+			target = (addr & 0xF0000000) | ((op & 0x03FFFFFF) << 2);
+			break;
+
+		default:
+			return false;
+		}
+		return target == loopStart;
+	}
+
+	static bool IsLoopBodyOp(u32 op)
+	{
+		if ((MIPSGetInfo(op) & (DELAYSLOT | IS_CONDBRANCH | IS_JUMP)) != 0)
+			return false;
+		// syscall and break leave the block.
+		if ((op >> 26) == 0 && ((op & 0x3F) == 12 || (op & 0x3F) == 13))
+			return false;
+		// COP0 (eret and friends.)
+		return (op >> 26) != 16;
+	}
+
+	static void CountLoopRegs(u32 op, int counts[32])
+	{
+		const u32 info = MIPSGetInfo(op);
+		if (info & (IN_RS | IN_RS_ADDR | IN_RS_SHIFT))
+			counts[MIPS_GET_RS(op)]++;
+		if (info & (IN_RT | OUT_RT))
+			counts[MIPS_GET_RT(op)]++;
+		if (info & OUT_RD)
+			counts[MIPS_GET_RD(op)]++;
+	}
+
+	bool AnalyzeLoop(u32 addr, int maxOps, LoopInfo &info)
+	{
+		int counts[32] = {0};
+		for (int i = 0; i < maxOps; ++i)
+		{
+			const u32 opAddr = addr + i * 4;
+			if (!Memory::IsValidAddress(opAddr + 4))
+				return false;
+			const u32 op = Memory::Read_Instruction(opAddr);
+			CountLoopRegs(op, counts);
+			if (IsLoopBodyOp(op))
+				continue;
+			if (!IsLoopBackEdge(op, opAddr, addr))
+				return false;
+
+			const u32 delaySlotOp = Memory::Read_Instruction(opAddr + 4);
+			if (!IsLoopBodyOp(delaySlotOp))
+				return false;
+			CountLoopRegs(delaySlotOp, counts);
+
+			info.backEdgeAddr = opAddr;
+			info.numRegs = 0;
+			for (int reg = 1; reg < 32; ++reg)
+			{
+				if (counts[reg] != 0)
+					info.regs[info.numRegs++] = reg;
+			}
+			// Insertion sort, there are only a few.
+			for (int j = 1; j < info.numRegs; ++j)
+			{
+				const int reg = info.regs[j];
+				int k = j;
+				for (; k > 0 && counts[info.regs[k - 1]] < counts[reg]; --k)
+					info.regs[k] = info.regs[k - 1];
+				info.regs[k] = reg;
+			}
+			return true;
+		}
+		return false;
+	}
+
 	void Analyze(u32 address)
 	{
 		//set everything to -1 (FF)
@@ -262,9 +538,9 @@ namespace MIPSAnalyst
 
 	vector<Function> functions;
 
-	map<u32, Function*> hashToFunction;
+	// Several functions may well share a hash (small wrappers, duplicated library code.)
+	multimap<u32, Function*> hashToFunction;
 
-	// hm pointless :P
 	void UpdateHashToFunctionMap()
 	{
 		hashToFunction.clear();
@@ -273,11 +549,52 @@ namespace MIPSAnalyst
 			Function &f = *iter;
 			if (f.hasHash)
 			{
-				hashToFunction[f.hash] = &f;
+				hashToFunction.insert(multimap<u32, Function*>::value_type(f.hash, &f));
 			}
 		}
 	}
 
+	void ResetFunctions()
+	{
+		hashToFunction.clear();
+		functions.clear();
+	}
+
+	void ForgetFunctions(u32 startAddr, u32 endAddr)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < functions.size(); i++)
+		{
+			if (functions[i].start >= startAddr && functions[i].start < endAddr)
+				continue;
+			functions[kept++] = functions[i];
+		}
+		if (kept == functions.size())
+			return;
+		functions.resize(kept);
+		// It points into functions.
+		UpdateHashToFunctionMap();
+	}
+
+	int GetNumFunctions()
+	{
+		return (int)functions.size();
+	}
+
+	u32 GetFunctionStart(int i)
+	{
+		return functions[i].start;
+	}
+
+	u32 GetFunctionSize(int i)
+	{
+		return functions[i].size;
+	}
+
+	const char *GetFunctionName(int i)
+	{
+		return functions[i].name;
+	}
 
 	bool IsRegisterUsed(u32 reg, u32 addr)
 	{
@@ -311,31 +628,37 @@ namespace MIPSAnalyst
 		return true;
 	}
 
+	u32 HashFunction(u32 start, u32 size)
+	{
+		u32 hash = 0x1337babe;
+		for (u32 addr = start; addr < start + size; addr += 4)
+		{
+			u32 validbits = 0xFFFFFFFF;
+			u32 instr = Memory::Read_Instruction(addr);
+			u32 flags = MIPSGetInfo(instr);
+			if (flags & IN_IMM16)
+				validbits&=~0xFFFF;
+			if (flags & IN_IMM26)
+				validbits&=~0x3FFFFFF;
+			hash = _rotl(hash,13);
+			hash ^= (instr&validbits);
+		}
+		return hash;
+	}
+
 	void HashFunctions()
 	{
 		for (vector<Function>::iterator iter = functions.begin(); iter!=functions.end(); iter++)
 		{
 			Function &f=*iter;
-			u32 hash = 0x1337babe;
-			for (u32 addr = f.start; addr <= f.end; addr++)
-			{
-				u32 validbits = 0xFFFFFFFF;
-				u32 instr = Memory::Read_Instruction(addr);
-				u32 flags = MIPSGetInfo(instr);
-				if (flags & IN_IMM16)
-					validbits&=~0xFFFF;
-				if (flags & IN_IMM26)
-					validbits&=~0x3FFFFFF;
-				hash = _rotl(hash,13);
-				hash ^= (instr&validbits);
-			}
-			f.hash=hash;
+			f.hash=HashFunction(f.start, f.end - f.start + 4);
 			f.hasHash=true;
 		}
 	}
 
 	void ScanForFunctions(u32 startAddr, u32 endAddr /*, std::vector<u32> knownEntries*/)
 	{
+		const size_t firstNew = functions.size();
 		Function currentFunction = {startAddr};
 
 		u32 furthestBranch = 0;
@@ -348,7 +671,19 @@ namespace MIPSAnalyst
 			int n = symbolMap.GetSymbolNum(addr,ST_FUNCTION);
 			if (n != -1)
 			{
-				addr = symbolMap.GetSymbolAddr(n) + symbolMap.GetSymbolSize(n);
+				// Already known from the ELF or a symbol map, take it as is so it gets hashed too.
+				Function known = {symbolMap.GetSymbolAddr(n)};
+				known.end = known.start + std::max(symbolMap.GetSymbolSize(n), (u32)4) - 4;
+				strncpy(known.name, symbolMap.GetSymbolName(n), sizeof(known.name) - 1);
+				if (known.start == addr)
+					functions.push_back(known);
+
+				addr = known.end;
+				furthestBranch = 0;
+				looking = false;
+				end = false;
+				isStraightLeaf = true;
+				currentFunction.start = addr + 4;
 				continue;
 			}
 
@@ -405,15 +740,21 @@ namespace MIPSAnalyst
 				currentFunction.start = addr+4;
 			}
 		}
-		currentFunction.end = addr + 4;
-		functions.push_back(currentFunction);
+		if (currentFunction.start <= endAddr)
+		{
+			currentFunction.end = addr + 4;
+			functions.push_back(currentFunction);
+		}
 
-		for (vector<Function>::iterator iter = functions.begin(); iter!=functions.end(); iter++)
+		for (vector<Function>::iterator iter = functions.begin() + firstNew; iter!=functions.end(); iter++)
 		{
-			(*iter).size = ((*iter).end-(*iter).start+4);
-			char temp[256];
-			sprintf(temp,"z_un_%08x",(*iter).start);
-			symbolMap.AddSymbol(std::string(temp).c_str(), (*iter).start,(*iter).end-(*iter).start+4,ST_FUNCTION);
+			Function &f = *iter;
+			f.size = f.end - f.start + 4;
+			if (f.name[0] == 0)
+			{
+				sprintf(f.name, "z_un_%08x", f.start);
+				symbolMap.AddSymbol(f.name, f.start, f.size, ST_FUNCTION);
+			}
 		}
 		HashFunctions();
 	}
@@ -425,34 +766,76 @@ namespace MIPSAnalyst
 		u32 size; //number of bytes
 	};
 
+	// Hash map files start with these, then the number of entries.  Maps from an older
+	// HashFunction() would only misname things, so the version has to match exactly.
+	static const u32 HASHMAP_MAGIC = 0x50414D48;  // "HMAP"
+	static const u32 HASHMAP_VERSION = 1;  // Bump whenever HashFunction() changes.
+
+	// False if the file is missing or from another version.
+	static bool ReadHashMap(const char *filename, vector<HashMapFunc> &entries)
+	{
+		FILE *file = fopen(filename, "rb");
+		if (!file)
+			return false;
+
+		u32 header[3];
+		if (fread(header, sizeof(header), 1, file) != 1 || header[0] != HASHMAP_MAGIC || header[1] != HASHMAP_VERSION)
+		{
+			INFO_LOG(CPU, "Hash map %s is from another version, ignoring it", filename);
+			fclose(file);
+			return false;
+		}
+
+		for (u32 i = 0; i < header[2]; i++)
+		{
+			HashMapFunc temp;
+			if (fread(&temp, sizeof(temp), 1, file) != 1)
+				break;
+			temp.name[sizeof(temp.name) - 1] = 0;
+			entries.push_back(temp);
+		}
+		fclose(file);
+		return true;
+	}
+
 	void StoreHashMap(const char *filename)
 	{
-		FILE *file = fopen(filename,"wb");
-		u32 num = 0;
-		if(fwrite(&num,4,1,file) != 1) //fill in later
-			WARN_LOG(CPU, "Could not store hash map %s", filename);
+		// Add to what's there already, so the map grows with each module that has symbols.
+		vector<HashMapFunc> entries;
+		set<pair<u32, u32> > known;
+		ReadHashMap(filename, entries);
+		for (size_t i = 0; i < entries.size(); i++)
+			known.insert(make_pair(entries[i].hash, entries[i].size));
+		const size_t numOld = entries.size();
 
 		for (vector<Function>::iterator iter = functions.begin(); iter!=functions.end(); iter++)
 		{
 			Function &f=*iter;
-			if (f.hasHash && f.size>=12)
+			// Unnamed functions would just name others after themselves.
+			if (f.hasHash && f.size>=12 && strncmp(f.name, "z_un_", 5) != 0 && known.insert(make_pair(f.hash, f.size)).second)
 			{
 				HashMapFunc temp;
 				memset(&temp,0,sizeof(temp));
 				strcpy(temp.name, f.name);
 				temp.hash=f.hash;
 				temp.size=f.size;
-				if(fwrite((char*)&temp,sizeof(temp),1,file) != 1) {
-					WARN_LOG(CPU, "Could not store hash map %s", filename);
-					break;
-				}
-				num++;
+				entries.push_back(temp);
 			}
 		}
-		fseek(file,0,SEEK_SET);
-		if(fwrite(&num,4,1,file) != 1) //fill in later
+		if (entries.size() == numOld)
+			return;
+
+		FILE *file = fopen(filename,"wb");
+		if (!file)
+		{
+			WARN_LOG(CPU, "Could not store hash map %s", filename);
+			return;
+		}
+		u32 header[3] = {HASHMAP_MAGIC, HASHMAP_VERSION, (u32)entries.size()};
+		if (fwrite(header, sizeof(header), 1, file) != 1 || fwrite(&entries[0], sizeof(HashMapFunc), entries.size(), file) != entries.size())
 			WARN_LOG(CPU, "Could not store hash map %s", filename);
 		fclose(file);
+		INFO_LOG(CPU, "Hash map %s: added %i functions", filename, (int)(entries.size() - numOld));
 	}
 
 
@@ -461,30 +844,33 @@ namespace MIPSAnalyst
 		HashFunctions();
 		UpdateHashToFunctionMap();
 
-		FILE *file = fopen(filename, "rb");
-		int num;
-		if(fread(&num,4,1,file) == 1) {
-			for (int i=0; i<num; i++)
+		vector<HashMapFunc> entries;
+		if (!ReadHashMap(filename, entries))
+			return;
+
+		int found = 0;
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			const HashMapFunc &temp = entries[i];
+			typedef multimap<u32,Function*>::iterator HashIter;
+			pair<HashIter, HashIter> range = hashToFunction.equal_range(temp.hash);
+			for (HashIter iter = range.first; iter != range.second; ++iter)
 			{
-				HashMapFunc temp;
-				if(fread(&temp,sizeof(temp),1,file) == 1) {
-					map<u32,Function*>::iterator iter = hashToFunction.find(temp.hash);
-					if (iter != hashToFunction.end())
-					{
-						//yay, found a function!
-						Function &f = *(iter->second);
-						if (f.size==temp.size)
-						{
-							strcpy(f.name, temp.name);
-							f.hash=temp.hash;
-							f.size=temp.size;
-						}
-					}
+				//yay, found a function!
+				Function &f = *(iter->second);
+				if (f.size==temp.size && strcmp(f.name, temp.name) != 0)
+				{
+					strcpy(f.name, temp.name);
+					int n = symbolMap.GetSymbolNum(f.start, ST_FUNCTION);
+					if (n != -1 && symbolMap.GetSymbolAddr(n) == f.start)
+						symbolMap.SetSymbolName(n, f.name);
+					found++;
 				}
 			}
 		}
-		fclose(file);
+		INFO_LOG(CPU, "Hash map %s: named %i functions", filename, found);
 	}
+
 	void CompileLeafs()
 	{
 		/*
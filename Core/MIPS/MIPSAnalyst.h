@@ -48,8 +48,25 @@ namespace MIPSAnalyst
 	};
 
 	bool IsRegisterUsed(u32 reg, u32 addr);
+	// Splits the code into functions, taking known symbols as they are, and hashes them
+	// with immediates masked out (so relocation doesn't matter.)  Unnamed ones are called z_un_*.
 	void ScanForFunctions(u32 startAddr, u32 endAddr);
 	void CompileLeafs();
+	void ResetFunctions();
+	// Drops the functions starting in [startAddr, endAddr), for unloaded code.
+	void ForgetFunctions(u32 startAddr, u32 endAddr);
+	// The hash ScanForFunctions gives a function of size bytes at start.
+	u32 HashFunction(u32 start, u32 size);
+
+	// Hash maps: name, hash and size of known functions.  Loading names the matching ones,
+	// storing adds the named functions to the file.
+	void LoadHashMap(const char *filename);
+	void StoreHashMap(const char *filename);
+
+	int GetNumFunctions();
+	u32 GetFunctionStart(int i);
+	u32 GetFunctionSize(int i);
+	const char *GetFunctionName(int i);
 
 	std::vector<int> GetInputRegs(u32 op);
 	std::vector<int> GetOutputRegs(u32 op);
@@ -62,5 +79,24 @@ namespace MIPSAnalyst
 	bool IsDelaySlotNiceFPU(u32 branchOp, u32 op);
 	bool IsSyscall(u32 op);
 
+	// True if the conditional branch at branchAddr closes a short loop that only loads
+	// and computes, carrying no register from one iteration to the next (except one reset
+	// to the constant it had on entry.)  Such a loop just polls memory, so it can't exit
+	// before something else (an event) changes it.
+	bool IsIdleLoop(u32 branchAddr);
+
+	struct LoopInfo
+	{
+		// The branch (or j) at the end that goes back to the start.
+		u32 backEdgeAddr;
+		// GPRs the loop uses, the most used first.  Never $zero.
+		int regs[32];
+		int numRegs;
+	};
+
+	// Looks for a loop starting at addr: a non-likely, non-linking branch or j back to addr
+	// within maxOps, with no other branches, jumps, syscalls or COP0 ops before it.
+	bool AnalyzeLoop(u32 addr, int maxOps, LoopInfo &info);
+
 
 }	// namespace MIPSAnalyst
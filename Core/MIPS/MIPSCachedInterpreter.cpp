@@ -0,0 +1,237 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstring>
+
+#include "Common/ChunkFile.h"
+#include "Core/Core.h"
+#include "Core/CoreTiming.h"
+#include "Core/MemMap.h"
+#include "Core/Debugger/Breakpoints.h"
+#include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/MIPSInt.h"
+#include "Core/MIPS/MIPSCachedInterpreter.h"
+
+namespace MIPSComp
+{
+
+CachedInterpreter *cachedInterpreter;
+
+CachedInterpreter::CachedInterpreter(MIPSState *mips) : mips_(mips)
+{
+	blockIndex_.Init(MAX_NUM_BLOCKS);
+	ClearCache();
+}
+
+CachedInterpreter::~CachedInterpreter()
+{
+	ClearCache();
+	blockIndex_.Shutdown();
+}
+
+void CachedInterpreter::DoState(PointerWrap &p)
+{
+	// Nothing to save, blocks are decoded again on demand after loading.
+	p.DoMarker("CachedInterpreter");
+}
+
+void CachedInterpreter::ClearCache()
+{
+	blocks_.clear();
+	ops_.clear();
+	blockMap_.clear();
+	blockIndex_.Clear();
+	memset(lookupAddr_, 0xFF, sizeof(lookupAddr_));
+	memset(lookupBlock_, 0xFF, sizeof(lookupBlock_));
+}
+
+void CachedInterpreter::ClearCacheAt(u32 em_address)
+{
+	InvalidateICache(em_address, 4);
+}
+
+void CachedInterpreter::InvalidateICache(u32 address, u32 length)
+{
+	invalidated_.clear();
+	blockIndex_.GetBlocksInRange(address & 0x1FFFFFFF, length, invalidated_);
+	for (size_t i = 0; i < invalidated_.size(); ++i)
+		DestroyBlock(invalidated_[i]);
+}
+
+void CachedInterpreter::DestroyBlock(int block_num)
+{
+	CachedBlock &block = blocks_[block_num];
+	if (block.numOps == 0)
+		return;
+
+	const u32 slot = (block.emAddress >> 2) & (LOOKUP_SIZE - 1);
+	if (lookupAddr_[slot] == block.emAddress)
+		lookupAddr_[slot] = 0xFFFFFFFF;
+	blockMap_.erase(block.emAddress);
+	blockIndex_.RemoveBlock(block_num);
+
+	// The ops stay in ops_ until the next ClearCache().
+	block.numOps = 0;
+}
+
+int CachedInterpreter::Compile(u32 em_address)
+{
+	if ((int)blocks_.size() >= MAX_NUM_BLOCKS || (int)ops_.size() + MAX_BLOCK_OPS > MAX_NUM_OPS)
+	{
+		INFO_LOG(CPU, "Cached interpreter block cache full, clearing.");
+		ClearCache();
+	}
+
+	CachedBlock block;
+	block.emAddress = em_address;
+	block.firstOp = (int)ops_.size();
+	block.numOps = 0;
+
+	u32 addr = em_address;
+	bool delaySlotNext = false;
+	while (block.numOps < MAX_BLOCK_OPS)
+	{
+		CachedOp cop;
+		cop.op = Memory::Read_Instruction(addr);
+		cop.func = MIPSGetInterpretFunc(cop.op);
+		// Let MIPSInterpret complain about it when it's actually run.
+		if (cop.func == NULL)
+			cop.func = &MIPSInterpret;
+		ops_.push_back(cop);
+		block.numOps++;
+		addr += 4;
+
+		if (delaySlotNext)
+			break;
+		if (MIPSGetInfo(cop.op) & DELAYSLOT)
+			delaySlotNext = true;
+		// These may reschedule or stop the core, so nothing after them is worth decoding.
+		else if (cop.func == &MIPSInt::Int_Syscall || cop.func == &MIPSInt::Int_Break)
+			break;
+	}
+
+	const int block_num = (int)blocks_.size();
+	blocks_.push_back(block);
+	blockMap_[em_address] = block_num;
+
+	const u32 pAddr = em_address & 0x1FFFFFFF;
+	blockIndex_.AddBlock(block_num, pAddr, pAddr + 4 * block.numOps);
+	return block_num;
+}
+
+int CachedInterpreter::GetOrCompileBlock(u32 em_address)
+{
+	const u32 slot = (em_address >> 2) & (LOOKUP_SIZE - 1);
+	int block_num = -1;
+	if (lookupAddr_[slot] == em_address)
+		block_num = lookupBlock_[slot];
+	else
+	{
+		std::map<u32, int>::const_iterator it = blockMap_.find(em_address);
+		if (it != blockMap_.end())
+			block_num = it->second;
+	}
+
+	if (block_num != -1)
+	{
+		if (Memory::Read_Instruction(em_address) == ops_[blocks_[block_num].firstOp].op)
+		{
+			lookupAddr_[slot] = em_address;
+			lookupBlock_[slot] = block_num;
+			return block_num;
+		}
+		// The code was overwritten without an icache invalidate.
+		DestroyBlock(block_num);
+	}
+
+	block_num = Compile(em_address);
+	lookupAddr_[slot] = em_address;
+	lookupBlock_[slot] = block_num;
+	return block_num;
+}
+
+void CachedInterpreter::RunLoopUntil(u64 globalticks)
+{
+	MIPSState *mips = mips_;
+	while (coreState == CORE_RUNNING)
+	{
+		CoreTiming::Advance();
+
+		// NEVER stop in a delay slot!
+		while (mips->downcount >= 0 && coreState == CORE_RUNNING)
+		{
+			// Like the "goto again" in MIPSInterpret_RunUntil: after a delay slot,
+			// the next op runs before anything is checked.
+			bool runNext;
+			do
+			{
+				runNext = false;
+
+				const CachedBlock &block = blocks_[GetOrCompileBlock(mips->pc)];
+				const CachedOp *cop = &ops_[block.firstOp];
+				const CachedOp *end = cop + block.numOps;
+				u32 nextAddress = block.emAddress;
+				while (cop != end)
+				{
+#if defined(_DEBUG)
+					if (CBreakPoints::IsAddressBreakPoint(mips->pc))
+					{
+						Core_EnableStepping(true);
+						if (CBreakPoints::IsTempBreakPoint(mips->pc))
+							CBreakPoints::RemoveBreakPoint(mips->pc);
+						return;
+					}
+#endif
+
+					bool wasInDelaySlot = mips->inDelaySlot;
+
+					cop->func(cop->op);
+					++cop;
+					nextAddress += 4;
+
+					if (mips->inDelaySlot)
+					{
+						// The reason we have to check this is the delay slot hack in Int_Syscall.
+						if (wasInDelaySlot)
+						{
+							mips->pc = mips->nextPC;
+							mips->inDelaySlot = false;
+						}
+						mips->downcount -= 1;
+
+						if (mips->pc != nextAddress || cop == end)
+						{
+							runNext = true;
+							break;
+						}
+						continue;
+					}
+
+					mips->downcount -= 1;
+					if (CoreTiming::GetTicks() > globalticks)
+						return;
+					// Leave the block on a taken branch, or anything else that moved pc.
+					if (mips->pc != nextAddress || mips->downcount < 0 || coreState != CORE_RUNNING)
+						break;
+				}
+			}
+			while (runNext);
+		}
+	}
+}
+
+}  // namespace MIPSComp
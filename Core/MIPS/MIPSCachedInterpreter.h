@@ -0,0 +1,100 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Core/MIPS/MIPSTables.h"
+#include "Core/MIPS/JitCommon/JitBlockIndex.h"
+
+class MIPSState;
+class PointerWrap;
+
+namespace MIPSComp
+{
+
+// Same semantics as MIPSInterpret_RunUntil, but each basic block is fetched
+// and decoded through the opcode tables only once.  After that, running it
+// is a straight walk over an array of (interpret func, opcode) pairs.
+//
+// Like the IR interpreter, no emuhacks are written to RAM: blocks are looked
+// up by address, and the first op is compared on entry to catch overwritten
+// code.  Anything else has to go through InvalidateICache().
+class CachedInterpreter
+{
+public:
+	CachedInterpreter(MIPSState *mips);
+	~CachedInterpreter();
+
+	void DoState(PointerWrap &p);
+	void RunLoopUntil(u64 globalticks);
+
+	void ClearCache();
+	void ClearCacheAt(u32 em_address);
+	void InvalidateICache(u32 address, u32 length);
+
+	int GetNumBlocks() const { return (int)blocks_.size(); }
+
+private:
+	struct CachedOp
+	{
+		MIPSInterpretFunc func;
+		u32 op;
+	};
+
+	struct CachedBlock
+	{
+		u32 emAddress;
+		// Index of the first op in ops_.  numOps is 0 once destroyed.
+		int firstOp;
+		int numOps;
+	};
+
+	int GetOrCompileBlock(u32 em_address);
+	int Compile(u32 em_address);
+	void DestroyBlock(int block_num);
+
+	enum
+	{
+		MAX_NUM_BLOCKS = 65536,
+		MAX_NUM_OPS = 0x100000,
+		// A block ends earlier at a branch (plus delay slot), syscall or break.
+		MAX_BLOCK_OPS = 128,
+		// Must be a power of two.
+		LOOKUP_SIZE = 0x1000,
+	};
+
+	MIPSState *mips_;
+
+	std::vector<CachedBlock> blocks_;
+	// Ops of all blocks, back to back.  Only freed by ClearCache().
+	std::vector<CachedOp> ops_;
+	std::map<u32, int> blockMap_;
+	JitBlockIndex blockIndex_;
+	std::vector<int> invalidated_;
+
+	// Direct mapped cache in front of blockMap_, most lookups hit here.
+	u32 lookupAddr_[LOOKUP_SIZE];
+	int lookupBlock_[LOOKUP_SIZE];
+};
+
+extern CachedInterpreter *cachedInterpreter;
+
+}  // namespace MIPSComp
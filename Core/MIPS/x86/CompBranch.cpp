@@ -16,6 +16,7 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include "../../HLE/HLE.h"
+#include "../../Config.h"
 #include "../../Host.h"
 
 #include "../MIPS.h"
@@ -136,11 +137,24 @@ void Jit::BranchRSRTComp(u32 op, Gen::CCFlags cc, bool likely)
 	int rs = _RS;
 	u32 targetAddr = js.compilerPC + offset + 4;
 
+	// beq with the same register twice (b) is always taken, so it's really a jump.
+	if (jo.continueJumps && !likely && cc == CC_NZ && rs == rt && CanContinueBranch(targetAddr))
+	{
+		CONDITIONAL_LOG_EXIT(targetAddr);
+		CompileDelaySlot(DELAYSLOT_NICE);
+		ContinueJump(targetAddr);
+		return;
+	}
+	bool continueBranch = jo.continueBranches && !likely && CanContinueBranch(targetAddr);
+	bool idleLoop = jo.skipIdleLoops && targetAddr <= js.compilerPC && IsIdleLoop(js.compilerPC);
+
 	u32 delaySlotOp = Memory::Read_Instruction(js.compilerPC+4);
 	bool delaySlotIsNice = IsDelaySlotNiceReg(op, delaySlotOp, rt, rs);
 	CONDITIONAL_NICE_DELAYSLOT;
 	if (!likely && delaySlotIsNice)
 		CompileDelaySlot(DELAYSLOT_NICE);
+	// The delay slot has to run before the compare, so the registers can stay put for the jump back.
+	bool loopBranch = !likely && !idleLoop && delaySlotIsNice && IsLoopBranch(targetAddr);
 
 	if (rt == 0)
 	{
@@ -158,6 +172,8 @@ void Jit::BranchRSRTComp(u32 op, Gen::CCFlags cc, bool likely)
 	{
 		if (!delaySlotIsNice)
 			CompileDelaySlot(DELAYSLOT_SAFE_FLUSH);
+		else if (loopBranch)
+			FlushLoopRegs();
 		else
 			FlushAll();
 		ptr = J_CC(cc, true);
@@ -168,9 +184,33 @@ void Jit::BranchRSRTComp(u32 op, Gen::CCFlags cc, bool likely)
 		ptr = J_CC(cc, true);
 		CompileDelaySlot(DELAYSLOT_FLUSH);
 	}
+	if (continueBranch)
+	{
+		// Take the branch, but stay inside this block.
+		CONDITIONAL_LOG_EXIT(targetAddr);
+		ContinueBranch(targetAddr, ptr);
+		return;
+	}
+	if (loopBranch)
+	{
+		CONDITIONAL_LOG_EXIT(targetAddr);
+		WriteLoopBackEdge();
+
+		SetJumpTarget(ptr);
+		// Not taken, the loop is done.
+		FlushAll();
+		CONDITIONAL_LOG_EXIT(js.compilerPC + 8);
+		WriteExit(js.compilerPC + 8, 1);
+		js.compiling = false;
+		return;
+	}
+
 	// Take the branch
 	CONDITIONAL_LOG_EXIT(targetAddr);
-	WriteExit(targetAddr, 0);
+	if (idleLoop)
+		WriteIdleLoopExit(targetAddr);
+	else
+		WriteExit(targetAddr, 0);
 
 	SetJumpTarget(ptr);
 	// Not taken
@@ -190,12 +230,15 @@ void Jit::BranchRSZeroComp(u32 op, Gen::CCFlags cc, bool andLink, bool likely)
 	int offset = (signed short)(op&0xFFFF)<<2;
 	int rs = _RS;
 	u32 targetAddr = js.compilerPC + offset + 4;
+	bool continueBranch = jo.continueBranches && !likely && !andLink && CanContinueBranch(targetAddr);
+	bool idleLoop = jo.skipIdleLoops && !andLink && targetAddr <= js.compilerPC && IsIdleLoop(js.compilerPC);
 
 	u32 delaySlotOp = Memory::Read_Instruction(js.compilerPC + 4);
 	bool delaySlotIsNice = IsDelaySlotNiceReg(op, delaySlotOp, rs);
 	CONDITIONAL_NICE_DELAYSLOT;
 	if (!likely && delaySlotIsNice)
 		CompileDelaySlot(DELAYSLOT_NICE);
+	bool loopBranch = !likely && !andLink && !idleLoop && delaySlotIsNice && IsLoopBranch(targetAddr);
 
 	gpr.BindToRegister(rs, true, false);
 	CMP(32, gpr.R(rs), Imm32(0));
@@ -205,6 +248,8 @@ void Jit::BranchRSZeroComp(u32 op, Gen::CCFlags cc, bool andLink, bool likely)
 	{
 		if (!delaySlotIsNice)
 			CompileDelaySlot(DELAYSLOT_SAFE_FLUSH);
+		else if (loopBranch)
+			FlushLoopRegs();
 		else
 			FlushAll();
 		ptr = J_CC(cc, true);
@@ -216,11 +261,35 @@ void Jit::BranchRSZeroComp(u32 op, Gen::CCFlags cc, bool andLink, bool likely)
 		CompileDelaySlot(DELAYSLOT_FLUSH);
 	}
 
+	if (continueBranch)
+	{
+		// Take the branch, but stay inside this block.
+		CONDITIONAL_LOG_EXIT(targetAddr);
+		ContinueBranch(targetAddr, ptr);
+		return;
+	}
+	if (loopBranch)
+	{
+		CONDITIONAL_LOG_EXIT(targetAddr);
+		WriteLoopBackEdge();
+
+		SetJumpTarget(ptr);
+		// Not taken, the loop is done.
+		FlushAll();
+		CONDITIONAL_LOG_EXIT(js.compilerPC + 8);
+		WriteExit(js.compilerPC + 8, 1);
+		js.compiling = false;
+		return;
+	}
+
 	// Take the branch
 	if (andLink)
 		MOV(32, M(&mips_->r[MIPS_REG_RA]), Imm32(js.compilerPC + 8));
 	CONDITIONAL_LOG_EXIT(targetAddr);
-	WriteExit(targetAddr, 0);
+	if (idleLoop)
+		WriteIdleLoopExit(targetAddr);
+	else
+		WriteExit(targetAddr, 0);
 
 	SetJumpTarget(ptr);
 	// Not taken
@@ -251,7 +320,6 @@ void Jit::Comp_RelBranch(u32 op)
 		_dbg_assert_msg_(CPU,0,"Trying to compile instruction that can't be compiled");
 		break;
 	}
-	js.compiling = false;
 }
 
 void Jit::Comp_RelBranchRI(u32 op)
@@ -270,7 +338,6 @@ void Jit::Comp_RelBranchRI(u32 op)
 		_dbg_assert_msg_(CPU,0,"Trying to compile instruction that can't be compiled");
 		break;
 	}
-	js.compiling = false;
 }
 
 
@@ -284,6 +351,7 @@ void Jit::BranchFPFlag(u32 op, Gen::CCFlags cc, bool likely)
 	}
 	int offset = (signed short)(op & 0xFFFF) << 2;
 	u32 targetAddr = js.compilerPC + offset + 4;
+	bool continueBranch = jo.continueBranches && !likely && CanContinueBranch(targetAddr);
 
 	u32 delaySlotOp = Memory::Read_Instruction(js.compilerPC + 4);
 	bool delaySlotIsNice = IsDelaySlotNiceFPU(op, delaySlotOp);
@@ -307,6 +375,14 @@ void Jit::BranchFPFlag(u32 op, Gen::CCFlags cc, bool likely)
 		CompileDelaySlot(DELAYSLOT_FLUSH);
 	}
 
+	if (continueBranch)
+	{
+		// Take the branch, but stay inside this block.
+		CONDITIONAL_LOG_EXIT(targetAddr);
+		ContinueBranch(targetAddr, ptr);
+		return;
+	}
+
 	// Take the branch
 	CONDITIONAL_LOG_EXIT(targetAddr);
 	WriteExit(targetAddr, 0);
@@ -332,7 +408,6 @@ void Jit::Comp_FPUBranch(u32 op)
 		_dbg_assert_msg_(CPU,0,"Trying to interpret instruction that can't be interpreted");
 		break;
 	}
-	js.compiling = false;
 }
 
 // If likely is set, discard the branch slot if NOT taken.
@@ -345,6 +420,7 @@ void Jit::BranchVFPUFlag(u32 op, Gen::CCFlags cc, bool likely)
 	}
 	int offset = (signed short)(op & 0xFFFF) << 2;
 	u32 targetAddr = js.compilerPC + offset + 4;
+	bool continueBranch = jo.continueBranches && !likely && CanContinueBranch(targetAddr);
 
 	u32 delaySlotOp = Memory::Read_Instruction(js.compilerPC + 4);
 	bool delaySlotIsNice = IsDelaySlotNiceVFPU(op, delaySlotOp);
@@ -372,6 +448,14 @@ void Jit::BranchVFPUFlag(u32 op, Gen::CCFlags cc, bool likely)
 		CompileDelaySlot(DELAYSLOT_FLUSH);
 	}
 
+	if (continueBranch)
+	{
+		// Take the branch, but stay inside this block.
+		CONDITIONAL_LOG_EXIT(targetAddr);
+		ContinueBranch(targetAddr, ptr);
+		return;
+	}
+
 	// Take the branch
 	CONDITIONAL_LOG_EXIT(targetAddr);
 	WriteExit(targetAddr, 0);
@@ -397,7 +481,6 @@ void Jit::Comp_VBranch(u32 op)
 		_dbg_assert_msg_(CPU,0,"Comp_VBranch: Invalid instruction");
 		break;
 	}
-	js.compiling = false;
 }
 
 void Jit::Comp_Jump(u32 op)
@@ -409,7 +492,25 @@ void Jit::Comp_Jump(u32 op)
 	}
 	u32 off = ((op & 0x3FFFFFF) << 2);
 	u32 targetAddr = (js.compilerPC & 0xF0000000) | off;
+
+	// A plain j forward, just keep compiling there with everything still in registers.
+	if (jo.continueJumps && (op >> 26) == 2 && CanContinueBranch(targetAddr))
+	{
+		CONDITIONAL_LOG_EXIT(targetAddr);
+		CompileDelaySlot(DELAYSLOT_NICE);
+		ContinueJump(targetAddr);
+		return;
+	}
+
 	CompileDelaySlot(DELAYSLOT_NICE);
+	if ((op >> 26) == 2 && IsLoopBranch(targetAddr))
+	{
+		CONDITIONAL_LOG_EXIT(targetAddr);
+		FlushLoopRegs();
+		WriteLoopBackEdge();
+		js.compiling = false;
+		return;
+	}
 	FlushAll();
 
 	switch (op >> 26) 
@@ -500,7 +601,30 @@ void Jit::Comp_Syscall(u32 op)
 	WriteDowncount(offset);
 	js.downcountAmount = -offset;
 
-	ABI_CallFunctionC((void *)&CallSyscall, op);
+	const HLEFunction *info = GetSyscallInfo(op);
+	if (info != NULL && info->func != NULL)
+	{
+		// Stats and profiling need CallSyscall's timing, so only call the function directly when they're off.
+		CMP(8, M(&g_Config.bShowDebugStats), Imm8(0));
+		FixupBranch slowPath = J_CC(CC_NZ);
+		CMP(8, M(&g_Config.bSyscallProfile), Imm8(0));
+		FixupBranch slowPathProfile = J_CC(CC_NZ);
+
+		ABI_CallFunction((void *)info->func);
+		CMP(32, M(&hleAfterSyscall), Imm32(0));
+		FixupBranch noFinish = J_CC(CC_Z);
+		u32 callno = (op >> 6) & 0xFFFFF;
+		ABI_CallFunctionCC((void *)&hleFinishSyscall, (callno & 0xFF000) >> 12, callno & 0xFFF);
+		FixupBranch done = J();
+
+		SetJumpTarget(slowPath);
+		SetJumpTarget(slowPathProfile);
+		ABI_CallFunctionC((void *)&CallSyscall, op);
+		SetJumpTarget(noFinish);
+		SetJumpTarget(done);
+	}
+	else
+		ABI_CallFunctionC((void *)&CallSyscall, op);
 
 	WriteSyscallExit();
 	js.compiling = false;
@@ -0,0 +1,305 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include "../../Debugger/Breakpoints.h"
+#include "../MIPSTables.h"
+#include "../IR/IRPasses.h"
+
+#include "Jit.h"
+#include "RegCache.h"
+
+// Compiles whole blocks from the optimized IR (see Core/MIPS/IR) instead of straight from MIPS.
+//
+// So far this covers the integer ALU ops and the block exits, plus anything the IR hands to
+// the interpreter.  A block using any other op (loads/stores, HI/LO, leftover temps, ...) is
+// compiled the usual way instead.
+
+namespace MIPSComp
+{
+
+static bool IsIRRegLowered(u8 reg)
+{
+	// The register cache only has the MIPS GPRs, not HI/LO or the IR temps.
+	return reg < NUM_MIPS_GPRS;
+}
+
+bool Jit::CanCompileIR(const IRBlock &block) const
+{
+	// Breakpoints are checked per MIPS instruction, which IR blocks don't have.
+	for (u32 i = 0; i < block.numInstructions; ++i)
+	{
+		if (CBreakPoints::IsAddressBreakPoint(block.emAddress + i * 4))
+			return false;
+	}
+
+	int exits = 0;
+	for (size_t i = 0; i < block.insts.size(); ++i)
+	{
+		const IRInst &inst = block.insts[i];
+		const u32 flags = GetIRMeta(inst.op).flags;
+		if ((flags & IRFLAG_DEST) && !IsIRRegLowered(inst.dest))
+			return false;
+		if ((flags & IRFLAG_SRC1) && !IsIRRegLowered(inst.src1))
+			return false;
+		if ((flags & IRFLAG_SRC2) && !IsIRRegLowered(inst.src2))
+			return false;
+
+		switch (inst.op)
+		{
+		case IROP_NOP:
+		case IROP_SETCONST:
+		case IROP_MOV:
+		case IROP_ADD:
+		case IROP_SUB:
+		case IROP_AND:
+		case IROP_OR:
+		case IROP_XOR:
+		case IROP_NOR:
+		case IROP_SLT:
+		case IROP_SLTU:
+		case IROP_ADDCONST:
+		case IROP_ANDCONST:
+		case IROP_ORCONST:
+		case IROP_XORCONST:
+		case IROP_SLTCONST:
+		case IROP_SLTUCONST:
+		case IROP_SHLIMM:
+		case IROP_SHRIMM:
+		case IROP_SARIMM:
+		case IROP_SETPCCONST:
+		case IROP_EXITTOREG:
+			break;
+
+		case IROP_INTERPRET:
+			// The VFPU prefix tracking in js assumes it sees every VFPU op.
+			if (MIPSGetInfo(inst.constant) & IS_VFPU)
+				return false;
+			break;
+
+		case IROP_EXITTOCONST:
+		case IROP_EXITTOCONSTIFEQ:
+		case IROP_EXITTOCONSTIFNEQ:
+		case IROP_EXITTOCONSTIFGTZ:
+		case IROP_EXITTOCONSTIFGEZ:
+		case IROP_EXITTOCONSTIFLTZ:
+		case IROP_EXITTOCONSTIFLEZ:
+			// Each one is a linkable exit, and a block only has room for two.
+			if (++exits > 2)
+				return false;
+			break;
+
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Jit::CompileIR(u32 em_address, JitBlock *b)
+{
+	IRBlock block;
+	irFrontend_.Translate(em_address, &block);
+	OptimizeIRBlock(&block);
+	block.Compact();
+	if (!CanCompileIR(block))
+		return false;
+
+	// Like the IR interpreter, every exit takes the cycles for the whole block.
+	js.downcountAmount = block.cycles;
+	js.numInstructions = block.numInstructions;
+	js.compilerPC = em_address + (block.numInstructions - 1) * 4;
+
+	int exitNum = 0;
+	for (size_t i = 0; i < block.insts.size(); ++i)
+	{
+		const IRInst &inst = block.insts[i];
+		CompIRInst(inst, exitNum);
+		// Anything after an unconditional exit can't run.
+		if (inst.op == IROP_EXITTOCONST || inst.op == IROP_EXITTOREG)
+			break;
+	}
+
+	b->codeSize = (u32)(GetCodePtr() - b->normalEntry);
+	NOP();
+	AlignCode4();
+	b->originalSize = block.numInstructions;
+	return true;
+}
+
+void Jit::CompIRInst(const IRInst &inst, int &exitNum)
+{
+	const u32 flags = GetIRMeta(inst.op).flags;
+
+	// Writes to ZERO are dropped, like the MIPS ops they came from.
+	if ((flags & IRFLAG_DEST) && inst.dest == 0)
+		return;
+
+	// Known inputs, known result.
+	if ((flags & IRFLAG_FOLDABLE) && (!(flags & IRFLAG_SRC1) || gpr.IsImmediate(inst.src1)) && (!(flags & IRFLAG_SRC2) || gpr.IsImmediate(inst.src2)))
+	{
+		const u32 a = (flags & IRFLAG_SRC1) ? gpr.GetImmediate32(inst.src1) : 0;
+		const u32 b = (flags & IRFLAG_SRC2) ? gpr.GetImmediate32(inst.src2) : 0;
+		gpr.SetImmediate32(inst.dest, EvalIRFoldable(inst.op, a, b, inst.constant));
+		return;
+	}
+
+	switch (inst.op)
+	{
+	case IROP_NOP:
+		break;
+
+	case IROP_SETCONST:
+		gpr.SetImmediate32(inst.dest, inst.constant);
+		break;
+
+	case IROP_MOV:
+		if (inst.dest != inst.src1)
+		{
+			gpr.Lock(inst.dest, inst.src1);
+			gpr.BindToRegister(inst.dest, false, true);
+			MOV(32, gpr.R(inst.dest), gpr.R(inst.src1));
+			gpr.UnlockAll();
+		}
+		break;
+
+	case IROP_ADD: CompIRArith(inst, &XEmitter::ADD); break;
+	case IROP_SUB: CompIRArith(inst, &XEmitter::SUB); break;
+	case IROP_AND: CompIRArith(inst, &XEmitter::AND); break;
+	case IROP_OR: CompIRArith(inst, &XEmitter::OR); break;
+	case IROP_XOR: CompIRArith(inst, &XEmitter::XOR); break;
+	case IROP_NOR:
+		CompIRArith(inst, &XEmitter::OR);
+		NOT(32, gpr.R(inst.dest));
+		break;
+
+	case IROP_ADDCONST: CompIRArith(inst, &XEmitter::ADD); break;
+	case IROP_ANDCONST: CompIRArith(inst, &XEmitter::AND); break;
+	case IROP_ORCONST: CompIRArith(inst, &XEmitter::OR); break;
+	case IROP_XORCONST: CompIRArith(inst, &XEmitter::XOR); break;
+
+	case IROP_SLT: CompIRCompare(inst, CC_L); break;
+	case IROP_SLTU: CompIRCompare(inst, CC_B); break;
+	case IROP_SLTCONST: CompIRCompare(inst, CC_L); break;
+	case IROP_SLTUCONST: CompIRCompare(inst, CC_B); break;
+
+	case IROP_SHLIMM: CompIRShiftImm(inst, &XEmitter::SHL); break;
+	case IROP_SHRIMM: CompIRShiftImm(inst, &XEmitter::SHR); break;
+	case IROP_SARIMM: CompIRShiftImm(inst, &XEmitter::SAR); break;
+
+	case IROP_SETPCCONST:
+		MOV(32, M(&mips_->pc), Imm32(inst.constant));
+		break;
+
+	case IROP_INTERPRET:
+		// Same as Comp_Generic(), except the IR already set the pc.
+		FlushAll();
+		ABI_CallFunctionC((void *)MIPSGetInterpretFunc(inst.constant), inst.constant);
+		break;
+
+	case IROP_EXITTOCONST:
+		FlushAll();
+		WriteExit(inst.constant, exitNum++);
+		break;
+
+	case IROP_EXITTOCONSTIFEQ: CompIRExitIf(inst, CC_NE, exitNum); break;
+	case IROP_EXITTOCONSTIFNEQ: CompIRExitIf(inst, CC_E, exitNum); break;
+	case IROP_EXITTOCONSTIFGTZ: CompIRExitIf(inst, CC_LE, exitNum); break;
+	case IROP_EXITTOCONSTIFGEZ: CompIRExitIf(inst, CC_L, exitNum); break;
+	case IROP_EXITTOCONSTIFLTZ: CompIRExitIf(inst, CC_GE, exitNum); break;
+	case IROP_EXITTOCONSTIFLEZ: CompIRExitIf(inst, CC_G, exitNum); break;
+
+	case IROP_EXITTOREG:
+		FlushAll();
+		MOV(32, R(EAX), gpr.R(inst.src1));
+		WriteExitDestInEAX();
+		break;
+
+	default:
+		_dbg_assert_msg_(JIT, 0, "IR op %s can't be lowered", GetIRMeta(inst.op).name);
+		break;
+	}
+}
+
+// Register operands not used by the op may be garbage, so only lock the real ones.
+static int IRLockSrc2(const IRInst &inst)
+{
+	return (GetIRMeta(inst.op).flags & IRFLAG_SRC2) != 0 ? inst.src2 : 0xff;
+}
+
+OpArg Jit::IRSrc2(const IRInst &inst)
+{
+	if ((GetIRMeta(inst.op).flags & IRFLAG_SRC2) != 0)
+		return gpr.R(inst.src2);
+	return Imm32(inst.constant);
+}
+
+void Jit::CompIRArith(const IRInst &inst, void (XEmitter::*arith)(int, const OpArg &, const OpArg &))
+{
+	gpr.Lock(inst.dest, inst.src1, IRLockSrc2(inst));
+	if (inst.dest == inst.src1)
+	{
+		gpr.BindToRegister(inst.dest, true, true);
+		(this->*arith)(32, gpr.R(inst.dest), IRSrc2(inst));
+	}
+	else
+	{
+		// Through EAX in case dest is also the second operand.
+		MOV(32, R(EAX), gpr.R(inst.src1));
+		(this->*arith)(32, R(EAX), IRSrc2(inst));
+		gpr.BindToRegister(inst.dest, false, true);
+		MOV(32, gpr.R(inst.dest), R(EAX));
+	}
+	gpr.UnlockAll();
+}
+
+void Jit::CompIRCompare(const IRInst &inst, CCFlags cc)
+{
+	gpr.Lock(inst.dest, inst.src1, IRLockSrc2(inst));
+	MOV(32, R(EAX), gpr.R(inst.src1));
+	CMP(32, R(EAX), IRSrc2(inst));
+	SETcc(cc, R(EAX));
+	MOVZX(32, 8, EAX, R(EAX));
+	gpr.BindToRegister(inst.dest, false, true);
+	MOV(32, gpr.R(inst.dest), R(EAX));
+	gpr.UnlockAll();
+}
+
+void Jit::CompIRShiftImm(const IRInst &inst, void (XEmitter::*shift)(int, OpArg, OpArg))
+{
+	gpr.Lock(inst.dest, inst.src1);
+	gpr.BindToRegister(inst.dest, inst.dest == inst.src1, true);
+	if (inst.dest != inst.src1)
+		MOV(32, gpr.R(inst.dest), gpr.R(inst.src1));
+	(this->*shift)(32, gpr.R(inst.dest), Imm8((u8)inst.constant));
+	gpr.UnlockAll();
+}
+
+void Jit::CompIRExitIf(const IRInst &inst, CCFlags notTakenCC, int &exitNum)
+{
+	// Both paths leave with everything flushed, so later ops start from a clean cache either way.
+	FlushAll();
+	MOV(32, R(EAX), gpr.R(inst.src1));
+	if ((GetIRMeta(inst.op).flags & IRFLAG_SRC2) != 0)
+		CMP(32, R(EAX), gpr.R(inst.src2));
+	else
+		CMP(32, R(EAX), Imm32(0));
+	FixupBranch notTaken = J_CC(notTakenCC, true);
+	WriteExit(inst.constant, exitNum++);
+	SetJumpTarget(notTaken);
+}
+
+}  // namespace MIPSComp
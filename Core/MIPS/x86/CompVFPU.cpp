@@ -54,6 +54,11 @@ static const float zero = 0.0f;
 const u32 GC_ALIGNED16( noSignMask[4] ) = {0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF, 0x7FFFFFFF};
 const u32 GC_ALIGNED16( signBitLower[4] ) = {0x80000000, 0, 0, 0};
 
+enum
+{
+	CMPUNORDSS = 3,
+};
+
 void Jit::Comp_VPFX(u32 op)
 {
 	CONDITIONAL_DISABLE;
@@ -734,4 +739,625 @@ void Jit::Comp_Vmmov(u32 op) {
 	fpr.ReleaseSpillLocks();
 }
 
+// True if any reg of the n x n matrix mregs is also in regs[0..count-1].
+static bool MatrixOverlaps(const u8 mregs[16], int n, const u8 regs[], int count)
+{
+	for (int a = 0; a < n; a++)
+	{
+		for (int b = 0; b < n; b++)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				if (mregs[a * 4 + b] == regs[i])
+					return true;
+			}
+		}
+	}
+	return false;
+}
+
+void Jit::Comp_Vmmul(u32 op) {
+	CONDITIONAL_DISABLE;
+
+	// The interpreter ignores prefixes, so we do too.
+	if (js.MayHavePrefix())
+		DISABLE;
+
+	MatrixSize sz = GetMtxSize(op);
+	int n = GetMatrixSide(sz);
+
+	u8 sregs[16], tregs[16], dregs[16];
+	GetMatrixRegs(sregs, sz, _VS);
+	GetMatrixRegs(tregs, sz, _VT);
+	GetMatrixRegs(dregs, sz, _VD);
+
+	bool overlap = false;
+	for (int c = 0; c < n; c++)
+	{
+		if (MatrixOverlaps(dregs, n, &sregs[c * 4], n) || MatrixOverlaps(dregs, n, &tregs[c * 4], n))
+			overlap = true;
+	}
+
+	// If the output overlaps an input, results go through temps until everything is read.
+	u8 tempregs[16];
+	for (int a = 0; a < n; a++)
+	{
+		for (int b = 0; b < n; b++)
+		{
+			// Need to start with +0.0f so it doesn't result in -0.0f.
+			XORPS(XMM0, R(XMM0));
+			for (int c = 0; c < n; c++)
+			{
+				// sum += s[b*4 + c] * t[a*4 + c];
+				MOVSS(XMM1, fpr.V(sregs[b * 4 + c]));
+				MULSS(XMM1, fpr.V(tregs[a * 4 + c]));
+				ADDSS(XMM0, R(XMM1));
+			}
+
+			u8 dreg = dregs[a * 4 + b];
+			if (overlap)
+			{
+				dreg = (u8) fpr.GetTempV();
+				tempregs[a * 4 + b] = dreg;
+			}
+			fpr.MapRegV(dreg, MAP_NOINIT | MAP_DIRTY);
+			MOVSS(fpr.VX(dreg), R(XMM0));
+			if (overlap)
+				fpr.StoreFromRegisterV(dreg);
+		}
+	}
+
+	if (overlap)
+	{
+		for (int a = 0; a < n; a++)
+		{
+			for (int b = 0; b < n; b++)
+			{
+				MOVSS(XMM0, fpr.V(tempregs[a * 4 + b]));
+				fpr.MapRegV(dregs[a * 4 + b], MAP_NOINIT | MAP_DIRTY);
+				MOVSS(fpr.VX(dregs[a * 4 + b]), R(XMM0));
+			}
+		}
+	}
+
+	fpr.ReleaseSpillLocks();
+}
+
+void Jit::Comp_Vmscl(u32 op) {
+	CONDITIONAL_DISABLE;
+
+	// The interpreter ignores prefixes, so we do too.
+	if (js.MayHavePrefix())
+		DISABLE;
+
+	MatrixSize sz = GetMtxSize(op);
+	int n = GetMatrixSide(sz);
+
+	u8 sregs[16], dregs[16], treg;
+	GetMatrixRegs(sregs, sz, _VS);
+	GetVectorRegs(&treg, V_Single, _VT);
+	GetMatrixRegs(dregs, sz, _VD);
+
+	// Scaling a matrix in place is fine, other overlaps go through temps.
+	bool overlap = false;
+	for (int a = 0; a < n; a++)
+	{
+		for (int b = 0; b < n; b++)
+		{
+			for (int c = 0; c < n; c++)
+			{
+				for (int d = 0; d < n; d++)
+				{
+					if (dregs[a * 4 + b] == sregs[c * 4 + d] && (a != c || b != d))
+						overlap = true;
+				}
+			}
+		}
+	}
+
+	// Read the scale first, it may be overwritten.
+	MOVSS(XMM1, fpr.V(treg));
+
+	u8 tempregs[16];
+	for (int a = 0; a < n; a++)
+	{
+		for (int b = 0; b < n; b++)
+		{
+			u8 dreg = dregs[a * 4 + b];
+			if (overlap)
+			{
+				dreg = (u8) fpr.GetTempV();
+				tempregs[a * 4 + b] = dreg;
+			}
+			fpr.MapRegV(dreg, (dreg == sregs[a * 4 + b] ? 0 : MAP_NOINIT) | MAP_DIRTY);
+			if (!fpr.V(sregs[a * 4 + b]).IsSimpleReg(fpr.VX(dreg)))
+				MOVSS(fpr.VX(dreg), fpr.V(sregs[a * 4 + b]));
+			MULSS(fpr.VX(dreg), R(XMM1));
+			if (overlap)
+				fpr.StoreFromRegisterV(dreg);
+		}
+	}
+
+	if (overlap)
+	{
+		for (int a = 0; a < n; a++)
+		{
+			for (int b = 0; b < n; b++)
+			{
+				MOVSS(XMM0, fpr.V(tempregs[a * 4 + b]));
+				fpr.MapRegV(dregs[a * 4 + b], MAP_NOINIT | MAP_DIRTY);
+				MOVSS(fpr.VX(dregs[a * 4 + b]), R(XMM0));
+			}
+		}
+	}
+
+	fpr.ReleaseSpillLocks();
+}
+
+void Jit::Comp_Vtfm(u32 op) {
+	CONDITIONAL_DISABLE;
+
+	// The interpreter ignores prefixes, so we do too.
+	if (js.MayHavePrefix())
+		DISABLE;
+
+	VectorSize sz = GetVecSize(op);
+	MatrixSize msz = GetMtxSize(op);
+	int n = GetNumVectorElements(sz);
+	int ins = (op >> 23) & 7;
+
+	// vhtfm: the last row of the matrix is added as is (t[n-1] is implicitly 1.0.)
+	bool homogenous = false;
+	if (n == ins)
+	{
+		n++;
+		sz = (VectorSize)((int)(sz) + 1);
+		msz = (MatrixSize)((int)(msz) + 1);
+		homogenous = true;
+	}
+	// Otherwise, n should already be ins + 1.
+	else if (n != ins + 1)
+		DISABLE;
+
+	u8 sregs[16], tregs[4], dregs[4];
+	GetMatrixRegs(sregs, msz, _VS);
+	GetVectorRegs(tregs, sz, _VT);
+	GetVectorRegs(dregs, sz, _VD);
+
+	bool overlap = MatrixOverlaps(sregs, n, dregs, n);
+	for (int i = 0; i < n; i++)
+	{
+		for (int k = 0; k < n; k++)
+		{
+			if (dregs[i] == tregs[k])
+				overlap = true;
+		}
+	}
+
+	u8 tempregs[4];
+	for (int i = 0; i < n; i++)
+	{
+		// Need to start with +0.0f so it doesn't result in -0.0f.
+		XORPS(XMM0, R(XMM0));
+		for (int k = 0; k < n; k++)
+		{
+			MOVSS(XMM1, fpr.V(sregs[i * 4 + k]));
+			if (!homogenous || k != n - 1)
+				MULSS(XMM1, fpr.V(tregs[k]));
+			ADDSS(XMM0, R(XMM1));
+		}
+
+		u8 dreg = dregs[i];
+		if (overlap)
+		{
+			dreg = (u8) fpr.GetTempV();
+			tempregs[i] = dreg;
+		}
+		fpr.MapRegV(dreg, MAP_NOINIT | MAP_DIRTY);
+		MOVSS(fpr.VX(dreg), R(XMM0));
+	}
+
+	if (overlap)
+	{
+		for (int i = 0; i < n; i++)
+		{
+			fpr.MapRegV(dregs[i], MAP_NOINIT | MAP_DIRTY);
+			MOVSS(fpr.VX(dregs[i]), fpr.V(tempregs[i]));
+		}
+	}
+
+	fpr.ReleaseSpillLocks();
+}
+
+void Jit::Comp_VCrossQuat(u32 op) {
+	CONDITIONAL_DISABLE;
+
+	// The interpreter ignores prefixes, so we do too.
+	if (js.MayHavePrefix())
+		DISABLE;
+
+	// d[i] is the sum of s[sidx] * t[tidx] for four terms, negated where neg is set.
+	struct CrossTerm
+	{
+		u8 sidx, tidx, neg;
+	};
+	static const CrossTerm crossTerms[3][4] = {
+		{{1, 2, 0}, {2, 1, 1}},
+		{{2, 0, 0}, {0, 2, 1}},
+		{{0, 1, 0}, {1, 0, 1}},
+	};
+	static const CrossTerm quatTerms[4][4] = {
+		{{0, 3, 0}, {1, 2, 0}, {2, 1, 1}, {3, 0, 0}},
+		{{0, 2, 1}, {1, 3, 0}, {2, 0, 0}, {3, 1, 0}},
+		{{0, 1, 0}, {1, 0, 1}, {2, 3, 0}, {3, 2, 0}},
+		{{0, 0, 1}, {1, 1, 1}, {2, 2, 1}, {3, 3, 0}},
+	};
+
+	VectorSize sz = GetVecSize(op);
+	const CrossTerm (*terms)[4];
+	int numTerms;
+	switch (sz)
+	{
+	case V_Triple:  // vcrsp.t
+		terms = crossTerms;
+		numTerms = 2;
+		break;
+	case V_Quad:  // vqmul.q
+		terms = quatTerms;
+		numTerms = 4;
+		break;
+	default:
+		DISABLE;
+	}
+
+	int n = GetNumVectorElements(sz);
+
+	u8 sregs[4], tregs[4], dregs[4];
+	GetVectorRegs(sregs, sz, _VS);
+	GetVectorRegs(tregs, sz, _VT);
+	GetVectorRegs(dregs, sz, _VD);
+
+	// Every output depends on every input, so any overlap needs temps.
+	X64Reg tempxregs[4];
+	bool overlap = false;
+	for (int i = 0; i < n; ++i)
+	{
+		if (!IsOverlapSafe(dregs[i], i, n, sregs, n, tregs))
+			overlap = true;
+	}
+	for (int i = 0; i < n; ++i)
+	{
+		int reg = overlap ? fpr.GetTempV() : dregs[i];
+		fpr.MapRegV(reg, MAP_NOINIT | MAP_DIRTY);
+		fpr.SpillLockV(reg);
+		tempxregs[i] = fpr.VX(reg);
+	}
+
+	for (int i = 0; i < n; ++i)
+	{
+		const CrossTerm &first = terms[i][0];
+		MOVSS(tempxregs[i], fpr.V(sregs[first.sidx]));
+		if (first.neg)
+			XORPS(tempxregs[i], M((void *)&signBitLower));
+		MULSS(tempxregs[i], fpr.V(tregs[first.tidx]));
+		for (int j = 1; j < numTerms; ++j)
+		{
+			const CrossTerm &term = terms[i][j];
+			MOVSS(XMM1, fpr.V(sregs[term.sidx]));
+			MULSS(XMM1, fpr.V(tregs[term.tidx]));
+			if (term.neg)
+				SUBSS(tempxregs[i], R(XMM1));
+			else
+				ADDSS(tempxregs[i], R(XMM1));
+		}
+	}
+
+	if (overlap)
+	{
+		for (int i = 0; i < n; ++i)
+		{
+			fpr.MapRegV(dregs[i], MAP_NOINIT | MAP_DIRTY);
+			MOVSS(fpr.VX(dregs[i]), R(tempxregs[i]));
+		}
+	}
+
+	fpr.ReleaseSpillLocks();
+}
+
+void Jit::Comp_Vcrs(u32 op) {
+	CONDITIONAL_DISABLE;
+
+	if (js.HasUnknownPrefix())
+		DISABLE;
+
+	VectorSize sz = GetVecSize(op);
+	if (sz != V_Triple)
+		DISABLE;
+
+	// No swizzles allowed, so no S/T prefixes here.
+	u8 sregs[4], tregs[4], dregs[4];
+	GetVectorRegs(sregs, sz, _VS);
+	GetVectorRegs(tregs, sz, _VT);
+	GetVectorRegsPrefixD(dregs, sz, _VD);
+
+	// d[0] = s[1] * t[2]; d[1] = s[2] * t[0]; d[2] = s[0] * t[1];
+	static const int sidx[3] = {1, 2, 0};
+	static const int tidx[3] = {2, 0, 1};
+
+	X64Reg tempxregs[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		// Any destination that is also a source, even in its own lane, needs a temp since it is mapped NOINIT.
+		int reg = IsOverlapSafe(dregs[i], i, 3, sregs, 3, tregs) ? dregs[i] : fpr.GetTempV();
+		fpr.MapRegV(reg, MAP_NOINIT | MAP_DIRTY);
+		fpr.SpillLockV(reg);
+		tempxregs[i] = fpr.VX(reg);
+	}
+
+	for (int i = 0; i < 3; ++i)
+	{
+		MOVSS(XMM0, fpr.V(sregs[sidx[i]]));
+		MULSS(XMM0, fpr.V(tregs[tidx[i]]));
+		MOVSS(tempxregs[i], R(XMM0));
+	}
+	for (int i = 0; i < 3; ++i)
+	{
+		if (!fpr.V(dregs[i]).IsSimpleReg(tempxregs[i]))
+		{
+			fpr.MapRegV(dregs[i], MAP_NOINIT | MAP_DIRTY);
+			MOVSS(fpr.VX(dregs[i]), R(tempxregs[i]));
+		}
+	}
+
+	ApplyPrefixD(dregs, sz);
+
+	fpr.ReleaseSpillLocks();
+}
+
+void Jit::Comp_VScl(u32 op) {
+	CONDITIONAL_DISABLE;
+
+	if (js.HasUnknownPrefix())
+		DISABLE;
+
+	VectorSize sz = GetVecSize(op);
+	int n = GetNumVectorElements(sz);
+
+	u8 sregs[4], dregs[4], treg;
+	GetVectorRegsPrefixS(sregs, sz, _VS);
+	// The T prefix applies to the scalar.
+	GetVectorRegsPrefixT(&treg, V_Single, _VT);
+	GetVectorRegsPrefixD(dregs, sz, _VD);
+
+	// Read the scale first, it may be overwritten.
+	MOVSS(XMM1, fpr.V(treg));
+
+	X64Reg tempxregs[4];
+	for (int i = 0; i < n; ++i)
+	{
+		if (!IsOverlapSafeAllowS(dregs[i], i, n, sregs))
+		{
+			int reg = fpr.GetTempV();
+			fpr.MapRegV(reg, MAP_NOINIT | MAP_DIRTY);
+			fpr.SpillLockV(reg);
+			tempxregs[i] = fpr.VX(reg);
+		}
+		else
+		{
+			fpr.MapRegV(dregs[i], (dregs[i] == sregs[i] ? 0 : MAP_NOINIT) | MAP_DIRTY);
+			fpr.SpillLockV(dregs[i]);
+			tempxregs[i] = fpr.VX(dregs[i]);
+		}
+	}
+
+	for (int i = 0; i < n; ++i)
+	{
+		if (!fpr.V(sregs[i]).IsSimpleReg(tempxregs[i]))
+			MOVSS(tempxregs[i], fpr.V(sregs[i]));
+		MULSS(tempxregs[i], R(XMM1));
+	}
+	for (int i = 0; i < n; ++i)
+	{
+		if (!fpr.V(dregs[i]).IsSimpleReg(tempxregs[i]))
+			MOVSS(fpr.V(dregs[i]), tempxregs[i]);
+	}
+
+	ApplyPrefixD(dregs, sz);
+
+	fpr.ReleaseSpillLocks();
+}
+
+void Jit::Comp_VHdp(u32 op) {
+	CONDITIONAL_DISABLE;
+
+	if (js.HasUnknownPrefix())
+		DISABLE;
+
+	VectorSize sz = GetVecSize(op);
+	int n = GetNumVectorElements(sz);
+
+	u8 sregs[4], tregs[4], dregs[1];
+	GetVectorRegsPrefixS(sregs, sz, _VS);
+	GetVectorRegsPrefixT(tregs, sz, _VT);
+	GetVectorRegsPrefixD(dregs, V_Single, _VD);
+
+	// Need to start with +0.0f so it doesn't result in -0.0f.
+	XORPS(XMM0, R(XMM0));
+	for (int i = 0; i < n - 1; i++)
+	{
+		// sum += s[i]*t[i];
+		MOVSS(XMM1, fpr.V(sregs[i]));
+		MULSS(XMM1, fpr.V(tregs[i]));
+		ADDSS(XMM0, R(XMM1));
+	}
+	// The last s is implicitly 1.0.
+	ADDSS(XMM0, fpr.V(tregs[n - 1]));
+
+	// A NaN result has its sign cleared.
+	MOVSS(XMM1, R(XMM0));
+	CMPSS(XMM1, R(XMM1), CMPUNORDSS);
+	ANDPS(XMM1, M((void *)&signBitLower));
+	ANDNPS(XMM1, R(XMM0));
+
+	fpr.MapRegsV(dregs, V_Single, MAP_NOINIT | MAP_DIRTY);
+	MOVSS(fpr.VX(dregs[0]), R(XMM1));
+
+	ApplyPrefixD(dregs, V_Single);
+
+	fpr.ReleaseSpillLocks();
+}
+
+void Jit::Comp_Vi2f(u32 op) {
+	CONDITIONAL_DISABLE;
+
+	if (js.HasUnknownPrefix())
+		DISABLE;
+
+	VectorSize sz = GetVecSize(op);
+	int n = GetNumVectorElements(sz);
+	int imm = (op >> 16) & 0x1f;
+
+	u8 sregs[4], dregs[4];
+	GetVectorRegsPrefixS(sregs, sz, _VS);
+	GetVectorRegsPrefixD(dregs, sz, _VD);
+
+	// 1.0f / (1 << imm), exactly, built from the exponent.
+	if (imm != 0)
+	{
+		MOV(32, R(EAX), Imm32((127 - imm) << 23));
+		MOVD_xmm(XMM1, R(EAX));
+	}
+
+	X64Reg tempxregs[4];
+	for (int i = 0; i < n; ++i)
+	{
+		if (!IsOverlapSafeAllowS(dregs[i], i, n, sregs))
+		{
+			int reg = fpr.GetTempV();
+			fpr.MapRegV(reg, MAP_NOINIT | MAP_DIRTY);
+			fpr.SpillLockV(reg);
+			tempxregs[i] = fpr.VX(reg);
+		}
+		else
+		{
+			fpr.MapRegV(dregs[i], (dregs[i] == sregs[i] ? 0 : MAP_NOINIT) | MAP_DIRTY);
+			fpr.SpillLockV(dregs[i]);
+			tempxregs[i] = fpr.VX(dregs[i]);
+		}
+	}
+
+	for (int i = 0; i < n; ++i)
+	{
+		// Only the low lane matters, but the conversion has to come from a register.
+		if (!fpr.V(sregs[i]).IsSimpleReg(tempxregs[i]))
+			MOVSS(tempxregs[i], fpr.V(sregs[i]));
+		CVTDQ2PS(tempxregs[i], R(tempxregs[i]));
+		if (imm != 0)
+			MULSS(tempxregs[i], R(XMM1));
+	}
+	for (int i = 0; i < n; ++i)
+	{
+		if (!fpr.V(dregs[i]).IsSimpleReg(tempxregs[i]))
+			MOVSS(fpr.V(dregs[i]), tempxregs[i]);
+	}
+
+	ApplyPrefixD(dregs, sz);
+
+	fpr.ReleaseSpillLocks();
+}
+
+void Jit::Comp_Vidt(u32 op) {
+	CONDITIONAL_DISABLE;
+
+	if (js.HasUnknownPrefix())
+		DISABLE;
+
+	int vd = _VD;
+	VectorSize sz = GetVecSize(op);
+	if (sz != V_Pair && sz != V_Quad)
+		DISABLE;
+	int n = GetNumVectorElements(sz);
+
+	u8 dregs[4];
+	GetVectorRegsPrefixD(dregs, sz, vd);
+	fpr.MapRegsV(dregs, sz, MAP_NOINIT | MAP_DIRTY);
+
+	for (int i = 0; i < n; ++i)
+	{
+		if ((vd & (n - 1)) == i)
+			MOVSS(fpr.VX(dregs[i]), M((void *) &one));
+		else
+			XORPS(fpr.VX(dregs[i]), R(fpr.VX(dregs[i])));
+	}
+
+	ApplyPrefixD(dregs, sz);
+
+	fpr.ReleaseSpillLocks();
+}
+
+void Jit::Comp_VMatrixInit(u32 op) {
+	CONDITIONAL_DISABLE;
+
+	// The interpreter ignores prefixes, so we do too.
+	if (js.MayHavePrefix())
+		DISABLE;
+
+	int type = (op >> 16) & 0xF;
+	// vmidt, vmzero, vmone
+	if (type != 3 && type != 6 && type != 7)
+		DISABLE;
+
+	MatrixSize sz = GetMtxSize(op);
+	int n = GetMatrixSide(sz);
+
+	u8 dregs[16];
+	GetMatrixRegs(dregs, sz, _VD);
+
+	for (int a = 0; a < n; a++)
+	{
+		for (int b = 0; b < n; b++)
+		{
+			u8 dreg = dregs[a * 4 + b];
+			fpr.MapRegV(dreg, MAP_NOINIT | MAP_DIRTY);
+			if (type == 7 || (type == 3 && a == b))
+				MOVSS(fpr.VX(dreg), M((void *) &one));
+			else
+				XORPS(fpr.VX(dreg), R(fpr.VX(dreg)));
+		}
+	}
+
+	fpr.ReleaseSpillLocks();
+}
+
+void Jit::Comp_Viim(u32 op) {
+	CONDITIONAL_DISABLE;
+
+	if (js.HasUnknownPrefix())
+		DISABLE;
+
+	// The value is known now, so it's just a constant load.
+	float f;
+	int type = (op >> 23) & 7;
+	if (type == 6)
+		f = (float)(s32)(s16)(op & 0xFFFF);  // viim
+	else if (type == 7)
+		f = Float16ToFloat32((u16)(op & 0xFFFF));  // vfim
+	else
+		DISABLE;
+
+	u32 bits;
+	memcpy(&bits, &f, sizeof(bits));
+
+	u8 dregs[1];
+	GetVectorRegsPrefixD(dregs, V_Single, _VT);
+	fpr.MapRegsV(dregs, V_Single, MAP_NOINIT | MAP_DIRTY);
+
+	MOV(32, R(EAX), Imm32(bits));
+	MOVD_xmm(fpr.VX(dregs[0]), R(EAX));
+
+	ApplyPrefixD(dregs, V_Single);
+
+	fpr.ReleaseSpillLocks();
+}
+
 }
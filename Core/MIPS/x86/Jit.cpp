@@ -16,11 +16,13 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <algorithm>
+#include <cstddef>
 #include <iterator>
 #include "Common/ChunkFile.h"
 #include "../../Core.h"
 #include "../../CoreTiming.h"
 #include "../../Config.h"
+#include "../../HLE/ReplaceTables.h"
 #include "../MIPS.h"
 #include "../MIPSCodeUtils.h"
 #include "../MIPSInt.h"
@@ -50,6 +52,8 @@ static u64 saved_flags;
 #endif
 
 const bool USE_JIT_MISSMAP = false;
+// Bump whenever block boundaries or compile assumptions change, the disk cache ignores older entries.
+static const u32 DISK_CACHE_VERSION = 3;
 static std::map<std::string, u32> notJitOps;
 
 template<typename A, typename B>
@@ -107,6 +111,11 @@ Jit::Jit(MIPSState *mips) : blocks(mips), mips_(mips)
 
 	// TODO: If it becomes possible to switch from the interpreter, this should be set right.
 	js.startDefaultPrefix = true;
+
+	jo.enableProfiling = g_Config.bJitProfile;
+	jo.useIR = g_Config.bJitIR;
+
+	InstallFastmemHandler();
 }
 
 void Jit::DoState(PointerWrap &p)
@@ -223,6 +232,51 @@ void Jit::Compile(u32 em_address)
 		// Let's try that one more time.  We won't get back here because we toggled the value.
 		Compile(em_address);
 	}
+	else if (diskCache_.IsOpen())
+	{
+		// Options like fastmem can be changed while running.
+		diskCache_.SetOptionsHash(DiskCacheOptionsHash());
+		diskCache_.RecordBlock(em_address, b->originalSize);
+	}
+}
+
+u32 Jit::DiskCacheOptionsHash() const
+{
+	// Only user options go in here, not compile state like js.startDefaultPrefix.
+	// Each has its own bits, so no two settings give the same value.
+	u32 hash = 0;
+	hash |= (jo.enableBlocklink ? 1 : 0) << 0;
+	hash |= (g_Config.bFastMemory ? 1 : 0) << 1;
+	hash |= (g_Config.bIgnoreBadMemAccess ? 1 : 0) << 2;
+	hash |= (jo.continueBranches ? 1 : 0) << 3;
+	hash |= (jo.continueJumps ? 1 : 0) << 4;
+	hash |= (jo.compileLoops ? 1 : 0) << 5;
+	hash |= (jo.useIR ? 1 : 0) << 6;
+	hash |= (jo.continueMaxInstructions & 0xFFFF) << 16;
+	return hash;
+}
+
+void Jit::LoadDiskCache(const std::string &filename)
+{
+	diskCache_.Open(filename, DISK_CACHE_VERSION, DiskCacheOptionsHash());
+
+	std::vector<u32> addresses;
+	diskCache_.GetValidBlocks(addresses);
+
+	// DoJit() compiles at the current pc, so borrow it.
+	const u32 savedPC = mips_->pc;
+	int compiled = 0;
+	for (size_t i = 0; i < addresses.size(); ++i)
+	{
+		if (blocks.GetBlockNumberFromStartAddress(addresses[i]) != -1)
+			continue;
+		mips_->pc = addresses[i];
+		Compile(addresses[i]);
+		++compiled;
+	}
+	mips_->pc = savedPC;
+
+	INFO_LOG(JIT, "JIT disk cache: precompiled %d blocks", compiled);
 }
 
 void Jit::RunLoopUntil(u64 globalticks)
@@ -240,6 +294,8 @@ const u8 *Jit::DoJit(u32 em_address, JitBlock *b)
 	js.curBlock = b;
 	js.compiling = true;
 	js.inDelaySlot = false;
+	js.numContinued = 0;
+	js.loop.active = false;
 	js.PrefixStart();
 
 	// We add a check before the block, used when entering from a linked block.
@@ -251,6 +307,23 @@ const u8 *Jit::DoJit(u32 em_address, JitBlock *b)
 	SetJumpTarget(skip);
 
 	b->normalEntry = GetCodePtr();
+	if (jo.enableProfiling)
+		WriteProfileEnter(b);
+
+	if (jo.enableReplacements)
+	{
+		const int replacement = GetReplacementFuncIndex(em_address);
+		if (replacement >= 0)
+		{
+			WriteReplacementFunc(replacement);
+
+			b->codeSize = (u32)(GetCodePtr() - b->normalEntry);
+			NOP();
+			AlignCode4();
+			b->originalSize = 1;
+			return b->normalEntry;
+		}
+	}
 
 	// TODO: this needs work
 	MIPSAnalyst::AnalysisResults analysis; // = MIPSAnalyst::Analyze(em_address);
@@ -258,9 +331,20 @@ const u8 *Jit::DoJit(u32 em_address, JitBlock *b)
 	gpr.Start(mips_, analysis);
 	fpr.Start(mips_, analysis);
 
+	// Falls through to the regular compiler if the block has ops the IR path can't lower yet.
+	if (jo.useIR && CompileIR(em_address, b))
+		return b->normalEntry;
+
+	// The profiler's enter/exit pairs (and their scratch regs) don't fit in a loop.
+	if (jo.compileLoops && !jo.enableProfiling)
+		StartLoop(em_address);
+
 	js.numInstructions = 0;
 	while (js.compiling)
 	{
+		if (js.numContinued != 0)
+			ResolveContinuedBranches();
+
 		// Jit breakpoints are quite fast, so let's do them in release too.
 		CheckJitBreakpoint(js.compilerPC, 0);
 
@@ -273,10 +357,15 @@ const u8 *Jit::DoJit(u32 em_address, JitBlock *b)
 		js.numInstructions++;
 	}
 
+	// Branches whose target we never reached (the block ended first) still need a way out.
+	if (js.numContinued != 0)
+		WriteContinuedBranchExits();
+
 	b->codeSize = (u32)(GetCodePtr() - b->normalEntry);
 	NOP();
 	AlignCode4();
-	b->originalSize = js.numInstructions;
+	// With regions, this covers everything from the start to the last op, including skipped code.
+	b->originalSize = (js.compilerPC - js.blockStart) / 4;
 	return b->normalEntry;
 }
 
@@ -314,6 +403,8 @@ void Jit::Comp_Generic(u32 op)
 
 void Jit::WriteExit(u32 destination, int exit_num)
 {
+	if (jo.enableProfiling)
+		WriteProfileExit();
 	WriteDowncount();
 
 	//If nobody has taken care of this yet (this can be removed when all branches are done)
@@ -334,10 +425,188 @@ void Jit::WriteExit(u32 destination, int exit_num)
 	}
 }
 
+void Jit::WriteIdleLoopExit(u32 destination)
+{
+	if (jo.enableProfiling)
+		WriteProfileExit();
+	WriteDowncount();
+
+	// Nothing can make the loop exit before the next event, so skip ahead to it.
+	ABI_CallFunctionC((void *) &CoreTiming::Idle, 0);
+	MOV(32, M(&mips_->pc), Imm32(destination));
+	// Idle() clobbered the flags, but the dispatcher wants them from the downcount.
+	CMP(32, M(&mips_->downcount), Imm8(0));
+	JMP(asm_.dispatcherCheckCoreState, true);
+}
+
+bool Jit::CanContinueBranch(u32 targetAddr) const
+{
+	// Only forward, past the delay slot, so the region is always compiled in address order.
+	if (targetAddr < js.compilerPC + 8 || targetAddr > js.compilerPC + 4 * jo.continueMaxInstructions)
+		return false;
+	if (js.inDelaySlot || js.numContinued >= JitState::MAX_CONTINUED_BRANCHES)
+		return false;
+	return Memory::IsValidAddress(targetAddr);
+}
+
+void Jit::ContinueBranch(u32 targetAddr, Gen::FixupBranch &notTaken)
+{
+	// We're on the taken path, registers already flushed.  Account for the cycles so far,
+	// the not taken path will do the same when it reaches the target.
+	WriteDowncount();
+
+	JitState::ContinuedBranch &cont = js.continued[js.numContinued++];
+	cont.target = targetAddr;
+	cont.ptr = J(true);
+	cont.prefixS = (js.prefixSFlag & JitState::PREFIX_KNOWN) ? js.prefixS : -1;
+	cont.prefixT = (js.prefixTFlag & JitState::PREFIX_KNOWN) ? js.prefixT : -1;
+	cont.prefixD = (js.prefixDFlag & JitState::PREFIX_KNOWN) ? js.prefixD : -1;
+
+	// Not taken: keep compiling after the delay slot, which the branch already compiled.
+	SetJumpTarget(notTaken);
+	js.compilerPC += 4;
+	js.numInstructions++;
+}
+
+void Jit::ContinueJump(u32 targetAddr)
+{
+	// Registers stay live, we just keep compiling at the target (after the delay slot.)
+	js.numInstructions++;
+	js.compilerPC = targetAddr - 4;
+}
+
+void Jit::ResolveContinuedBranches()
+{
+	bool found = false;
+	for (int i = 0; i < js.numContinued; ++i)
+		found = found || js.continued[i].target == js.compilerPC;
+	if (!found)
+		return;
+
+	// Join point: both paths must agree on register state and downcount.
+	FlushAll();
+	WriteDowncount();
+	js.downcountAmount = 0;
+
+	for (int i = 0; i < js.numContinued; )
+	{
+		JitState::ContinuedBranch &cont = js.continued[i];
+		if (cont.target != js.compilerPC)
+		{
+			++i;
+			continue;
+		}
+
+		SetJumpTarget(cont.ptr);
+		if (cont.prefixS != ((js.prefixSFlag & JitState::PREFIX_KNOWN) ? js.prefixS : (u32)-1) ||
+			cont.prefixT != ((js.prefixTFlag & JitState::PREFIX_KNOWN) ? js.prefixT : (u32)-1) ||
+			cont.prefixD != ((js.prefixDFlag & JitState::PREFIX_KNOWN) ? js.prefixD : (u32)-1))
+			js.PrefixUnknown();
+
+		js.continued[i] = js.continued[--js.numContinued];
+	}
+}
+
+void Jit::WriteContinuedBranchExits()
+{
+	for (int i = 0; i < js.numContinued; ++i)
+	{
+		// Downcount was already subtracted (and flags set) before the jump here.
+		SetJumpTarget(js.continued[i].ptr);
+		if (jo.enableProfiling)
+		{
+			WriteProfileExit();
+			// Need to set neg flag again.
+			SUB(32, M(&mips_->downcount), Imm32(0));
+		}
+		MOV(32, M(&mips_->pc), Imm32(js.continued[i].target));
+		JMP(asm_.dispatcher, true);
+	}
+	js.numContinued = 0;
+}
+
+void Jit::StartLoop(u32 em_address)
+{
+	MIPSAnalyst::LoopInfo info;
+	if (!MIPSAnalyst::AnalyzeLoop(em_address, jo.continueMaxInstructions, info))
+		return;
+
+	// Leave a couple of registers for temporaries, or the body will just spill the loop regs.
+	int count;
+	const int *order = gpr.GetAllocationOrder(count);
+	const int maxRegs = count - 2;
+
+	js.loop.active = true;
+	js.loop.backEdgeAddr = info.backEdgeAddr;
+	js.loop.numRegs = std::min(info.numRegs, maxRegs);
+	for (int i = 0; i < js.loop.numRegs; ++i)
+	{
+		js.loop.regs[i] = info.regs[i];
+		js.loop.xregs[i] = (X64Reg)order[i];
+	}
+	js.loop.prefixS = (js.prefixSFlag & JitState::PREFIX_KNOWN) ? js.prefixS : -1;
+	js.loop.prefixT = (js.prefixTFlag & JitState::PREFIX_KNOWN) ? js.prefixT : -1;
+	js.loop.prefixD = (js.prefixDFlag & JitState::PREFIX_KNOWN) ? js.prefixD : -1;
+
+	// Nothing is cached yet, so this just loads them.
+	FlushLoopRegs();
+	js.loop.body = GetCodePtr();
+}
+
+bool Jit::IsLoopBranch(u32 targetAddr) const
+{
+	if (!js.loop.active || js.compilerPC != js.loop.backEdgeAddr || targetAddr != js.blockStart)
+		return false;
+	if (js.numContinued != 0 || js.inDelaySlot)
+		return false;
+
+	// The body was compiled assuming the prefixes it started with.
+	return js.loop.prefixS == ((js.prefixSFlag & JitState::PREFIX_KNOWN) ? js.prefixS : (u32)-1) &&
+		js.loop.prefixT == ((js.prefixTFlag & JitState::PREFIX_KNOWN) ? js.prefixT : (u32)-1) &&
+		js.loop.prefixD == ((js.prefixDFlag & JitState::PREFIX_KNOWN) ? js.prefixD : (u32)-1);
+}
+
+void Jit::FlushLoopRegs()
+{
+	// Like FlushAll(), but leaves the loop regs in their host registers.  Only MOVs, so
+	// it can go between a compare and its jump.
+	fpr.Flush();
+	FlushPrefixV();
+
+	u32 loopRegs = 0;
+	for (int i = 0; i < js.loop.numRegs; ++i)
+		loopRegs |= 1 << js.loop.regs[i];
+	for (int i = 0; i < NUM_MIPS_GPRS; ++i)
+	{
+		if ((loopRegs & (1 << i)) == 0)
+			gpr.StoreFromRegister(i);
+	}
+	for (int i = 0; i < js.loop.numRegs; ++i)
+		gpr.BindToFixedRegister(js.loop.regs[i], js.loop.xregs[i]);
+}
+
+void Jit::WriteLoopBackEdge()
+{
+	// Registers are already where the body wants them, so go around again if there's time.
+	WriteDowncount();
+	J_CC(CC_NS, js.loop.body, true);
+
+	// The slice is over.  Leave like any other exit, the dispatcher sees the sign flag.
+	for (int i = 0; i < js.loop.numRegs; ++i)
+		MOV(32, M(&mips_->r[js.loop.regs[i]]), R(js.loop.xregs[i]));
+	MOV(32, M(&mips_->pc), Imm32(js.blockStart));
+	JMP(asm_.dispatcher, true);
+}
+
 void Jit::WriteExitDestInEAX()
 {
 	// TODO: Some wasted potential, dispatcher will always read this back into EAX.
 	MOV(32, M(&mips_->pc), R(EAX));
+	if (jo.enableProfiling)
+	{
+		WriteProfileExit();
+		MOV(32, R(EAX), M(&mips_->pc));
+	}
 	WriteDowncount();
 
 	// Validate the jump to avoid a crash?
@@ -374,12 +643,61 @@ void Jit::WriteExitDestInEAX()
 		JMP(asm_.dispatcher, true);
 }
 
+void Jit::WriteReplacementFunc(int index)
+{
+	// Called at the start of a block, nothing is mapped yet.
+	ADD(32, M(GetReplacementHitCounter(index)), Imm8(1));
+	ABI_CallFunction((void *) GetReplacementFunc(index)->replaceFunc);
+	SUB(32, M(&mips_->downcount), R(EAX));
+
+	// And straight back to the caller.
+	js.downcountAmount = 0;
+	MOV(32, R(EAX), M(&mips_->r[MIPS_REG_RA]));
+	WriteExitDestInEAX();
+}
+
 void Jit::WriteSyscallExit()
 {
+	if (jo.enableProfiling)
+		WriteProfileExit();
 	WriteDowncount();
 	JMP(asm_.dispatcherCheckCoreState, true);
 }
 
+// Block entry time, for WriteProfileExit().
+static u64 profileBlockStart;
+
+void Jit::WriteProfileEnter(JitBlock *b)
+{
+	// Nothing is mapped yet, so EAX, ECX and EDX are free.
+#ifdef _M_X64
+	MOV(64, R(RCX), ImmPtr(b));
+#else
+	MOV(32, R(ECX), ImmPtr(b));
+#endif
+	// runCount is 64-bit so hot blocks can't wrap, ADD/ADC works on both hosts like ticCounter below.
+	ADD(32, MDisp(ECX, offsetof(JitBlock, runCount)), Imm8(1));
+	ADC(32, MDisp(ECX, offsetof(JitBlock, runCount) + 4), Imm8(0));
+	RDTSC();
+	MOV(32, M(&profileBlockStart), R(EAX));
+	MOV(32, M((u8 *)&profileBlockStart + 4), R(EDX));
+}
+
+void Jit::WriteProfileExit()
+{
+	// Registers are flushed at exits, this just needs the 64-bit add of (now - start.)
+	RDTSC();
+	SUB(32, R(EAX), M(&profileBlockStart));
+	SBB(32, R(EDX), M((u8 *)&profileBlockStart + 4));
+#ifdef _M_X64
+	MOV(64, R(RCX), ImmPtr(js.curBlock));
+#else
+	MOV(32, R(ECX), ImmPtr(js.curBlock));
+#endif
+	ADD(32, MDisp(ECX, offsetof(JitBlock, ticCounter)), R(EAX));
+	ADC(32, MDisp(ECX, offsetof(JitBlock, ticCounter) + 4), R(EDX));
+}
+
 bool Jit::CheckJitBreakpoint(u32 addr, int downcountOffset)
 {
 	if (CBreakPoints::IsAddressBreakPoint(addr))
@@ -388,6 +706,8 @@ bool Jit::CheckJitBreakpoint(u32 addr, int downcountOffset)
 		MOV(32, M(&mips_->pc), Imm32(js.compilerPC));
 		ABI_CallFunction((void *)&JitBreakpoint);
 
+		if (jo.enableProfiling)
+			WriteProfileExit();
 		WriteDowncount(downcountOffset);
 		JMP(asm_.dispatcherCheckCoreState, true);
 
@@ -398,7 +718,7 @@ bool Jit::CheckJitBreakpoint(u32 addr, int downcountOffset)
 }
 
 Jit::JitSafeMem::JitSafeMem(Jit *jit, int raddr, s32 offset)
-	: jit_(jit), raddr_(raddr), offset_(offset), needsCheck_(false), needsSkip_(false)
+	: jit_(jit), raddr_(raddr), offset_(offset), needsCheck_(false), needsSkip_(false), fastAccess_(NULL)
 {
 	// This makes it more instructions, so let's play it safe and say we need a far jump.
 	far_ = !g_Config.bIgnoreBadMemAccess;
@@ -515,6 +835,9 @@ OpArg Jit::JitSafeMem::PrepareMemoryOpArg()
 #endif
 	}
 
+	// The caller writes the fast access right here.
+	fastAccess_ = jit_->GetCodePtr();
+
 #ifdef _M_IX86
 		return MDisp(xaddr_, (u32) Memory::base + offset_);
 #else
@@ -538,11 +861,22 @@ void Jit::JitSafeMem::PrepareSlowAccess()
 	jit_->SetJumpTarget(tooLow);
 }
 
+void Jit::JitSafeMem::PadFastAccess()
+{
+#ifdef _M_X64
+	// If the access faults, Jit::BackPatch() overwrites it with a 5 byte CALL.
+	// MOVSS is always long enough, a MOV from [RBX+reg] may not be.
+	const int size = (int)(jit_->GetCodePtr() - fastAccess_);
+	if (size < 5)
+		jit_->NOP(5 - size);
+#endif
+}
+
 bool Jit::JitSafeMem::PrepareSlowWrite()
 {
 	// If it's immediate, we only need a slow write on invalid.
 	if (iaddr_ != (u32) -1)
-		return !g_Config.bFastMemory && !Memory::IsValidAddress(iaddr_);
+		return !Memory::IsValidAddress(iaddr_);
 
 	if (!g_Config.bFastMemory)
 	{
@@ -550,7 +884,10 @@ bool Jit::JitSafeMem::PrepareSlowWrite()
 		return true;
 	}
 	else
+	{
+		PadFastAccess();
 		return false;
+	}
 }
 
 void Jit::JitSafeMem::DoSlowWrite(void *safeFunc, const OpArg src, int suboffset)
@@ -566,32 +903,32 @@ void Jit::JitSafeMem::DoSlowWrite(void *safeFunc, const OpArg src, int suboffset
 
 bool Jit::JitSafeMem::PrepareSlowRead(void *safeFunc)
 {
-	if (!g_Config.bFastMemory)
+	if (iaddr_ != (u32) -1)
 	{
-		if (iaddr_ != (u32) -1)
-		{
-			// No slow read necessary.
-			if (Memory::IsValidAddress(iaddr_))
-				return false;
-			jit_->MOV(32, R(EAX), Imm32(iaddr_));
-		}
-		else
-		{
-			PrepareSlowAccess();
-			jit_->LEA(32, EAX, MDisp(xaddr_, offset_));
-		}
-
-		jit_->ABI_CallFunctionA(jit_->thunks.ProtectFunction(safeFunc, 1), R(EAX));
-		needsCheck_ = true;
-		return true;
+		// No slow read necessary.
+		if (Memory::IsValidAddress(iaddr_))
+			return false;
+		jit_->MOV(32, R(EAX), Imm32(iaddr_));
+	}
+	else if (!g_Config.bFastMemory)
+	{
+		PrepareSlowAccess();
+		jit_->LEA(32, EAX, MDisp(xaddr_, offset_));
 	}
 	else
+	{
+		PadFastAccess();
 		return false;
+	}
+
+	jit_->ABI_CallFunctionA(jit_->thunks.ProtectFunction(safeFunc, 1), R(EAX));
+	needsCheck_ = true;
+	return true;
 }
 
 void Jit::JitSafeMem::NextSlowRead(void *safeFunc, int suboffset)
 {
-	_dbg_assert_msg_(JIT, !g_Config.bFastMemory, "NextSlowRead() called in fast memory mode?");
+	_dbg_assert_msg_(JIT, !g_Config.bFastMemory || iaddr_ != (u32) -1, "NextSlowRead() called in fast memory mode?");
 
 	// For simplicity, do nothing for 0.  We already read in PrepareSlowRead().
 	if (suboffset == 0)
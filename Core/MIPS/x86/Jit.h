@@ -26,6 +26,8 @@
 #endif
 
 #include "Common/x64Emitter.h"
+#include "../JitCommon/JitDiskCache.h"
+#include "../IR/IRFrontend.h"
 #include "JitCache.h"
 #include "RegCache.h"
 #include "RegCacheFPU.h"
@@ -36,14 +38,42 @@ namespace MIPSComp
 // This is called when Jit hits a breakpoint.
 void JitBreakpoint();
 
+// Catches host faults from fastmem loads/stores in jit code, see Jit::BackPatch().
+// Only does anything on x64.  Safe to call more than once.
+void InstallFastmemHandler();
+
 struct JitOptions
 {
 	JitOptions()
 	{
 		enableBlocklink = true;
+		continueBranches = true;
+		continueJumps = true;
+		continueMaxInstructions = 64;
+		skipIdleLoops = true;
+		compileLoops = true;
+		enableReplacements = true;
+		enableProfiling = false;
+		useIR = false;
 	}
 
 	bool enableBlocklink;
+	// Compile short forward branches and jumps into the same block (a region),
+	// instead of exiting to the dispatcher or a linked block.
+	bool continueBranches;
+	bool continueJumps;
+	int continueMaxInstructions;
+	// Loops that just poll memory (see MIPSAnalyst::IsIdleLoop) skip ahead to the next event.
+	bool skipIdleLoops;
+	// A block that is a small loop (see MIPSAnalyst::AnalyzeLoop) jumps back to itself,
+	// keeping its most used GPRs in host registers, until the slice runs out.
+	bool compileLoops;
+	// Call native versions of known library functions, see ReplaceTables.h.
+	bool enableReplacements;
+	// Count runs and host time (rdtsc) per block, see JitBlockCache::WriteProfileReport().
+	bool enableProfiling;
+	// Compile blocks from the optimized IR (see Core/MIPS/IR) when all their ops can be lowered.
+	bool useIR;
 };
 
 struct JitState
@@ -56,6 +86,17 @@ struct JitState
 		PREFIX_KNOWN_DIRTY = 0x11,
 	};
 
+	// A forward branch inside the current region, waiting for the compiler to reach its target.
+	struct ContinuedBranch
+	{
+		u32 target;
+		Gen::FixupBranch ptr;
+		u32 prefixS;
+		u32 prefixT;
+		u32 prefixD;
+	};
+	enum { MAX_CONTINUED_BRANCHES = 8 };
+
 	u32 compilerPC;
 	u32 blockStart;
 	bool cancel;
@@ -65,6 +106,25 @@ struct JitState
 	bool compiling;	// TODO: get rid of this in favor of using analysis results to determine end of block
 	JitBlock *curBlock;
 
+	ContinuedBranch continued[MAX_CONTINUED_BRANCHES];
+	int numContinued;
+
+	// The block is a loop from blockStart to backEdgeAddr.  On every edge back to the start,
+	// regs[i] is in xregs[i] and everything else is flushed.
+	struct LoopState
+	{
+		bool active;
+		u32 backEdgeAddr;
+		const u8 *body;
+		int regs[NUM_X_REGS];
+		Gen::X64Reg xregs[NUM_X_REGS];
+		int numRegs;
+		u32 prefixS;
+		u32 prefixT;
+		u32 prefixD;
+	};
+	LoopState loop;
+
 	// VFPU prefix magic
 	bool startDefaultPrefix;
 	u32 prefixS;
@@ -193,6 +253,17 @@ public:
 	void Comp_Mftv(u32 op);
 	void Comp_Vmtvc(u32 op);
 	void Comp_Vmmov(u32 op);
+	void Comp_Vmmul(u32 op);
+	void Comp_Vmscl(u32 op);
+	void Comp_Vtfm(u32 op);
+	void Comp_VCrossQuat(u32 op);
+	void Comp_Vcrs(u32 op);
+	void Comp_VScl(u32 op);
+	void Comp_VHdp(u32 op);
+	void Comp_Vi2f(u32 op);
+	void Comp_Vidt(u32 op);
+	void Comp_VMatrixInit(u32 op);
+	void Comp_Viim(u32 op);
 
 	void Comp_DoNothing(u32 op);
 
@@ -216,7 +287,15 @@ public:
 
 	void ClearCache();
 	void ClearCacheAt(u32 em_address);
+
+	// Opens the persistent block list and precompiles everything that still matches RAM.
+	void LoadDiskCache(const std::string &filename);
+
+	// Called from the fault handler when a fastmem access at codePtr hit unmapped memory.
+	// Replaces the access with a call to a slow path, after which it can be run again.
+	bool BackPatch(u8 *codePtr, bool isWrite);
 private:
+	u32 DiskCacheOptionsHash() const;
 	void FlushAll();
 	void FlushPrefixV();
 	void WriteDowncount(int offset = 0);
@@ -226,7 +305,24 @@ private:
 	void EatInstruction(u32 op);
 
 	void WriteExit(u32 destination, int exit_num);
+	// Taken path of an idle loop's branch: CoreTiming::Idle(), then back to the dispatcher.
+	void WriteIdleLoopExit(u32 destination);
+	void WriteReplacementFunc(int index);
+	// Regions: internal edges for short forward branches and jumps.
+	bool CanContinueBranch(u32 targetAddr) const;
+	void ContinueBranch(u32 targetAddr, Gen::FixupBranch &notTaken);
+	void ContinueJump(u32 targetAddr);
+	void ResolveContinuedBranches();
+	void WriteContinuedBranchExits();
+	// Loops: a block that branches back to its own start without leaving.
+	void StartLoop(u32 em_address);
+	bool IsLoopBranch(u32 targetAddr) const;
+	void FlushLoopRegs();
+	void WriteLoopBackEdge();
 	void WriteExitDestInEAX();
+	// Profiling: the exit one clobbers EAX, EDX and flags, so goes before WriteDowncount().
+	void WriteProfileEnter(JitBlock *b);
+	void WriteProfileExit();
 //	void WriteRfiExitDestInEAX();
 	void WriteSyscallExit();
 	bool CheckJitBreakpoint(u32 addr, int downcountOffset);
@@ -250,7 +346,19 @@ private:
 	void CompFPTriArith(u32 op, void (XEmitter::*arith)(X64Reg reg, OpArg), bool orderMatters);
 	void CompFPComp(int lhs, int rhs, u8 compare, bool allowNaN = false);
 
+	// IR lowering, see CompIR.cpp.
+	bool CompileIR(u32 em_address, JitBlock *b);
+	bool CanCompileIR(const IRBlock &block) const;
+	void CompIRInst(const IRInst &inst, int &exitNum);
+	OpArg IRSrc2(const IRInst &inst);
+	void CompIRArith(const IRInst &inst, void (XEmitter::*arith)(int, const OpArg &, const OpArg &));
+	void CompIRCompare(const IRInst &inst, CCFlags cc);
+	void CompIRShiftImm(const IRInst &inst, void (XEmitter::*shift)(int, OpArg, OpArg));
+	void CompIRExitIf(const IRInst &inst, CCFlags notTakenCC, int &exitNum);
+
 	JitBlockCache blocks;
+	IRFrontend irFrontend_;
+	JitDiskCache diskCache_;
 	JitOptions jo;
 	JitState js;
 
@@ -292,6 +400,7 @@ private:
 	private:
 		OpArg PrepareMemoryOpArg();
 		void PrepareSlowAccess();
+		void PadFastAccess();
 
 		Jit *jit_;
 		int raddr_;
@@ -303,6 +412,7 @@ private:
 		X64Reg xaddr_;
 		FixupBranch tooLow_, tooHigh_, skip_;
 		const u8 *safe_;
+		const u8 *fastAccess_;
 	};
 	friend class JitSafeMem;
 };
@@ -0,0 +1,262 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+// In fastmem mode, loads and stores are a single MOV from [RBX + addr + offset]
+// without any range checks.  Most of the 4 GB behind Memory::base is unmapped,
+// so a bad access faults.  The handler below decodes the faulting MOV, writes a
+// small slow path which goes through Memory::Read_U32 etc., and replaces the
+// MOV with a CALL to it.  Then execution resumes at the CALL.
+
+#include <algorithm>
+#include <cstring>
+
+#include "Common/ABI.h"
+#include "Common/x64Analyzer.h"
+#include "Core/MemMap.h"
+#include "Core/MIPS/JitCommon/JitCommon.h"
+#include "Jit.h"
+
+#if defined(_M_X64) && (defined(_WIN32) || defined(__linux__) || defined(__APPLE__))
+#define FASTMEM_HANDLER
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <signal.h>
+#include <ucontext.h>
+#endif
+#endif
+
+using namespace Gen;
+
+namespace MIPSComp
+{
+
+#ifdef FASTMEM_HANDLER
+
+static bool handlerInstalled = false;
+
+static bool HandleFault(u8 *codePtr, uintptr_t accessAddress, bool isWrite)
+{
+	if (!MIPSComp::jit || !Memory::base)
+		return false;
+
+	// Fastmem addresses are base + a 32-bit address + a 16-bit signed offset.
+	const uintptr_t base = (uintptr_t)Memory::base;
+	if (accessAddress < base - 0x8000 || accessAddress >= base + 0x100000000ULL + 0x8000)
+		return false;
+
+	return MIPSComp::jit->BackPatch(codePtr, isWrite);
+}
+
+#ifdef _WIN32
+
+static LONG NTAPI FastmemExceptionHandler(PEXCEPTION_POINTERS pPtrs)
+{
+	if (pPtrs->ExceptionRecord->ExceptionCode != EXCEPTION_ACCESS_VIOLATION)
+		return EXCEPTION_CONTINUE_SEARCH;
+
+	const bool isWrite = pPtrs->ExceptionRecord->ExceptionInformation[0] == 1;
+	const uintptr_t accessAddress = (uintptr_t)pPtrs->ExceptionRecord->ExceptionInformation[1];
+	if (HandleFault((u8 *)pPtrs->ContextRecord->Rip, accessAddress, isWrite))
+		return EXCEPTION_CONTINUE_EXECUTION;
+	return EXCEPTION_CONTINUE_SEARCH;
+}
+
+void InstallFastmemHandler()
+{
+	if (handlerInstalled)
+		return;
+	AddVectoredExceptionHandler(TRUE, &FastmemExceptionHandler);
+	handlerInstalled = true;
+}
+
+#else
+
+static struct sigaction oldSegvAction;
+#ifdef __APPLE__
+static struct sigaction oldBusAction;
+#endif
+
+static void FastmemSignalHandler(int sig, siginfo_t *info, void *rawContext)
+{
+	ucontext_t *context = (ucontext_t *)rawContext;
+#ifdef __APPLE__
+	u8 *codePtr = (u8 *)context->uc_mcontext->__ss.__rip;
+	const bool isWrite = (context->uc_mcontext->__es.__err & 2) != 0;
+#else
+	u8 *codePtr = (u8 *)context->uc_mcontext.gregs[REG_RIP];
+	const bool isWrite = (context->uc_mcontext.gregs[REG_ERR] & 2) != 0;
+#endif
+
+	// The instruction was patched, so just return and run it again.
+	if (HandleFault(codePtr, (uintptr_t)info->si_addr, isWrite))
+		return;
+
+	struct sigaction *old = &oldSegvAction;
+#ifdef __APPLE__
+	if (sig == SIGBUS)
+		old = &oldBusAction;
+#endif
+
+	if (old->sa_flags & SA_SIGINFO)
+		old->sa_sigaction(sig, info, rawContext);
+	else if (old->sa_handler != SIG_DFL && old->sa_handler != SIG_IGN)
+		old->sa_handler(sig);
+	else
+	{
+		// Not ours: put the old action back, the access will fault again and crash as usual.
+		sigaction(sig, old, NULL);
+	}
+}
+
+void InstallFastmemHandler()
+{
+	if (handlerInstalled)
+		return;
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_sigaction = &FastmemSignalHandler;
+	action.sa_flags = SA_SIGINFO;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGSEGV, &action, &oldSegvAction);
+#ifdef __APPLE__
+	sigaction(SIGBUS, &action, &oldBusAction);
+#endif
+	handlerInstalled = true;
+}
+
+#endif
+
+bool Jit::BackPatch(u8 *codePtr, bool isWrite)
+{
+	if (!IsInCodeSpace(codePtr))
+		return false;
+
+	InstructionInfo info;
+	if (!DisassembleMov(codePtr, info, isWrite ? OP_ACCESS_WRITE : OP_ACCESS_READ))
+	{
+		ERROR_LOG(JIT, "Fastmem: unable to decode the faulting access at %p", codePtr);
+		return false;
+	}
+
+	// Only what JitSafeMem writes: [RBX + reg + disp], no immediates, no 64-bit.
+	if (info.otherReg != RBX || info.scaledReg == -1 || info.scaledReg == RSP || info.hasImmediate || info.operandSize == 8)
+	{
+		ERROR_LOG(JIT, "Fastmem: unexpected faulting access at %p", codePtr);
+		return false;
+	}
+	if (!isWrite && !info.isSSE && info.operandSize != 4 && !info.zeroExtend && !info.signExtend)
+	{
+		ERROR_LOG(JIT, "Fastmem: unexpected faulting load at %p", codePtr);
+		return false;
+	}
+
+	// JitSafeMem pads short accesses with NOPs, so there's always room for the CALL.
+	const int patchSize = std::max(info.instructionSize, 5);
+	for (int i = info.instructionSize; i < patchSize; ++i)
+	{
+		if (codePtr[i] != 0x90)
+		{
+			ERROR_LOG(JIT, "Fastmem: no room to patch the access at %p", codePtr);
+			return false;
+		}
+	}
+
+	// The slow path goes after the last block, and is thrown away with the rest on ClearCache().
+	if (GetSpaceLeft() < 0x1000)
+	{
+		ERROR_LOG(JIT, "Fastmem: out of code space for the access at %p", codePtr);
+		return false;
+	}
+
+	void *func;
+	switch (info.operandSize)
+	{
+	case 1:
+		func = isWrite ? (void *) &Memory::Write_U8 : (void *) &Memory::Read_U8;
+		break;
+	case 2:
+		func = isWrite ? (void *) &Memory::Write_U16 : (void *) &Memory::Read_U16;
+		break;
+	default:
+		func = isWrite ? (void *) &Memory::Write_U32 : (void *) &Memory::Read_U32;
+		break;
+	}
+
+	const X64Reg reg = (X64Reg)info.regOperandReg;
+	const u8 *trampoline = GetCodePtr();
+
+	// Just like the slow path in JitSafeMem, EAX is free and the thunk saves the rest.
+	// We came here by CALL from code with an aligned stack, so push 3 to realign.
+	PUSH(ABI_PARAM1);
+	PUSH(ABI_PARAM2);
+	SUB(64, R(RSP), Imm8(8));
+	LEA(32, EAX, MDisp((X64Reg)info.scaledReg, info.displacement));
+	if (isWrite)
+	{
+		if (info.isSSE)
+		{
+			MOVD_xmm(R(ABI_PARAM1), reg);
+			ABI_CallFunctionAA(thunks.ProtectFunction(func, 2), R(ABI_PARAM1), R(EAX));
+		}
+		else
+			ABI_CallFunctionAA(thunks.ProtectFunction(func, 2), R(reg), R(EAX));
+	}
+	else
+		ABI_CallFunctionA(thunks.ProtectFunction(func, 1), R(EAX));
+	ADD(64, R(RSP), Imm8(8));
+	POP(ABI_PARAM2);
+	POP(ABI_PARAM1);
+
+	if (!isWrite)
+	{
+		if (info.isSSE)
+			MOVD_xmm(reg, R(EAX));
+		else if (info.zeroExtend)
+			MOVZX(32, info.operandSize * 8, reg, R(EAX));
+		else if (info.signExtend)
+			MOVSX(32, info.operandSize * 8, reg, R(EAX));
+		else
+			MOV(32, R(reg), R(EAX));
+	}
+	RET();
+
+	XEmitter patch(codePtr);
+	patch.CALL(trampoline);
+	if (patchSize > 5)
+		patch.NOP(patchSize - 5);
+
+	INFO_LOG(JIT, "Fastmem: patched %s at %p (%d bytes) to use the slow path", isWrite ? "write" : "read", codePtr, info.operandSize);
+	return true;
+}
+
+#else
+
+void InstallFastmemHandler()
+{
+}
+
+bool Jit::BackPatch(u8 *codePtr, bool isWrite)
+{
+	return false;
+}
+
+#endif
+
+}  // namespace MIPSComp
@@ -22,6 +22,8 @@
 // performance hit, it's not enabled by default, but it's useful for
 // locating performance issues.
 
+#include <algorithm>
+
 #include "Common.h"
 
 #ifdef _WIN32
@@ -35,6 +37,7 @@
 #include "../MIPS.h"
 #include "../MIPSTables.h"
 #include "../MIPSAnalyst.h"
+#include "../../Debugger/SymbolMap.h"
 
 #include "x64Emitter.h"
 #include "x64Analyzer.h"
@@ -80,6 +83,7 @@ void JitBlockCache::Init()
 #endif
 	blocks = new JitBlock[MAX_NUM_BLOCKS];
 	blockCodePointers = new const u8*[MAX_NUM_BLOCKS];
+	blockIndex.Init(MAX_NUM_BLOCKS);
 	Clear();
 }
 
@@ -90,6 +94,7 @@ void JitBlockCache::Shutdown()
 	blocks = 0;
 	blockCodePointers = 0;
 	num_blocks = 0;
+	blockIndex.Shutdown();
 #if defined USE_OPROFILE && USE_OPROFILE
 	op_close_agent(agent);
 #endif
@@ -108,12 +113,12 @@ JitBlockCache::~JitBlockCache()
 // is full and when saving and loading states.
 void JitBlockCache::Clear()
 {
+	// Everything goes, so no need to unlink or unindex blocks one at a time.
+	blockIndex.Clear();
 	for (int i = 0; i < num_blocks; i++)
 	{
 		DestroyBlock(i, false);
 	}
-	links_to.clear();
-	block_map.clear();
 	num_blocks = 0;
 	memset(blockCodePointers, 0, sizeof(u8*)*MAX_NUM_BLOCKS);
 }
@@ -169,6 +174,8 @@ int JitBlockCache::AllocateBlock(u32 em_address)
 	b.linkStatus[0] = false;
 	b.linkStatus[1] = false;
 	b.blockNum = num_blocks;
+	b.runCount = 0;
+	b.ticCounter = 0;
 	num_blocks++; //commit the current block
 	return num_blocks - 1;
 }
@@ -186,13 +193,13 @@ void JitBlockCache::FinalizeBlock(int block_num, bool block_link, const u8 *code
 	// Yeah, this'll work fine for PSP too I think.
 	u32 pAddr = b.originalAddress & 0x1FFFFFFF;
 
-	block_map[std::make_pair(pAddr + 4 * b.originalSize - 1, pAddr)] = block_num;
+	blockIndex.AddBlock(block_num, pAddr, pAddr + 4 * b.originalSize);
 	if (block_link)
 	{
 		for (int i = 0; i < 2; i++)
 		{
 			if (b.exitAddress[i] != INVALID_EXIT) 
-				links_to.insert(std::pair<u32, int>(b.exitAddress[i], block_num));
+				blockIndex.AddLink(b.exitAddress[i], block_num, i);
 		}
 			
 		LinkBlock(block_num);
@@ -295,38 +302,22 @@ void JitBlockCache::LinkBlockExits(int i)
 	}
 }
 
-using namespace std;
-
 void JitBlockCache::LinkBlock(int i)
 {
 	LinkBlockExits(i);
 	JitBlock &b = blocks[i];
-	pair<multimap<u32, int>::iterator, multimap<u32, int>::iterator> ppp;
-	// equal_range(b) returns pair<iterator,iterator> representing the range
-	// of element with key b
-	ppp = links_to.equal_range(b.originalAddress);
-	if (ppp.first == ppp.second)
-		return;
-	for (multimap<u32, int>::iterator iter = ppp.first; iter != ppp.second; ++iter) {
-		// PanicAlert("Linking block %i to block %i", iter->second, i);
-		LinkBlockExits(iter->second);
+	for (int link = blockIndex.FirstLinkTo(b.originalAddress); link != -1; link = blockIndex.NextLinkTo(link, b.originalAddress)) {
+		// PanicAlert("Linking block %i to block %i", JitBlockIndex::LinkBlock(link), i);
+		LinkBlockExits(JitBlockIndex::LinkBlock(link));
 	}
 }
 
 void JitBlockCache::UnlinkBlock(int i)
 {
 	JitBlock &b = blocks[i];
-	pair<multimap<u32, int>::iterator, multimap<u32, int>::iterator> ppp;
-	ppp = links_to.equal_range(b.originalAddress);
-	if (ppp.first == ppp.second)
-		return;
-	for (multimap<u32, int>::iterator iter = ppp.first; iter != ppp.second; ++iter) {
-		JitBlock &sourceBlock = blocks[iter->second];
-		for (int e = 0; e < 2; e++)
-		{
-			if (sourceBlock.exitAddress[e] == b.originalAddress)
-				sourceBlock.linkStatus[e] = false;
-		}
+	for (int link = blockIndex.FirstLinkTo(b.originalAddress); link != -1; link = blockIndex.NextLinkTo(link, b.originalAddress)) {
+		JitBlock &sourceBlock = blocks[JitBlockIndex::LinkBlock(link)];
+		sourceBlock.linkStatus[JitBlockIndex::LinkExit(link)] = false;
 	}
 }
 
@@ -345,6 +336,7 @@ void JitBlockCache::DestroyBlock(int block_num, bool invalidate)
 		return;
 	}
 	b.invalid = true;
+	blockIndex.RemoveBlock(block_num);
 	if ((int)Memory::ReadUnchecked_U32(b.originalAddress) == (MIPS_EMUHACK_OPCODE | block_num))
 		Memory::WriteUnchecked_U32(b.originalFirstOpcode, b.originalAddress);
 
@@ -371,15 +363,59 @@ void JitBlockCache::InvalidateICache(u32 address, const u32 length)
 	u32 pAddr = address & 0x1FFFFFFF;
 
 	// destroy JIT blocks
-	// !! this works correctly under assumption that any two overlapping blocks end at the same address
-	std::map<pair<u32,u32>, u32>::iterator it1 = block_map.lower_bound(std::make_pair(pAddr, 0)), it2 = it1;
-	while (it2 != block_map.end() && it2->first.second < pAddr + length)
+	invalidated.clear();
+	blockIndex.GetBlocksInRange(pAddr, length, invalidated);
+	for (size_t i = 0; i < invalidated.size(); ++i)
+		DestroyBlock(invalidated[i], true);
+}
+
+struct JitBlockTicsGreater
+{
+	JitBlockTicsGreater(const JitBlock *blocks) : blocks_(blocks) {}
+	bool operator ()(int a, int b) const
 	{
-		DestroyBlock(it2->second, true);
-		it2++;
+		return blocks_[a].ticCounter > blocks_[b].ticCounter;
 	}
-	if (it1 != it2)
+
+	const JitBlock *blocks_;
+};
+
+void JitBlockCache::WriteProfileReport(FILE *file, int maxBlocks)
+{
+	std::vector<int> order;
+	u64 totalTics = 0;
+	for (int i = 0; i < num_blocks; ++i)
 	{
-		block_map.erase(it1, it2);
+		if (blocks[i].runCount == 0)
+			continue;
+		order.push_back(i);
+		totalTics += blocks[i].ticCounter;
+	}
+	std::sort(order.begin(), order.end(), JitBlockTicsGreater(blocks));
+
+	fprintf(file, "JIT block profile: %d of %d blocks ran, %llu host ticks in blocks\n", (int)order.size(), num_blocks, (unsigned long long)totalTics);
+
+	const int count = std::min(maxBlocks, (int)order.size());
+	for (int n = 0; n < count; ++n)
+	{
+		const JitBlock &b = blocks[order[n]];
+		const double percent = totalTics == 0 ? 0.0 : (100.0 * b.ticCounter) / totalTics;
+
+		char symbol[256];
+		int sym = symbolMap.GetSymbolNum(b.originalAddress);
+		if (sym != -1)
+			snprintf(symbol, sizeof(symbol), "%s+%x", symbolMap.GetSymbolName(sym), b.originalAddress - symbolMap.GetSymbolAddr(sym));
+		else
+			snprintf(symbol, sizeof(symbol), "(unknown)");
+
+		fprintf(file, "\n#%d %08x %s: %.2f%%, %llu ticks, %llu runs, %llu ticks/run%s\n", n + 1, b.originalAddress, symbol, percent,
+			(unsigned long long)b.ticCounter, (unsigned long long)b.runCount, (unsigned long long)(b.ticCounter / b.runCount), b.invalid ? " (invalidated)" : "");
+		for (u32 i = 0; i < b.originalSize; ++i)
+		{
+			const u32 addr = b.originalAddress + i * 4;
+			char disasm[256];
+			MIPSDisAsm(Memory::Read_Instruction(addr), addr, disasm, true);
+			fprintf(file, "  %08x  %s\n", addr, disasm);
+		}
 	}
 }
@@ -17,11 +17,12 @@
 
 #pragma once
 
-#include <map>
+#include <cstdio>
 #include <vector>
 #include <string>
 
 #include "../MIPSAnalyst.h"
+#include "../JitCommon/JitBlockIndex.h"
 
 // Define this in order to get VTune profile support for the Jit generated code.
 // Add the VTune include/lib directories to the project directories to get this to build.
@@ -54,7 +55,7 @@ struct JitBlock
 	u32 originalFirstOpcode; //to be able to restore
 	u32 codeSize; 
 	u32 originalSize;
-	int runCount;	// for profiling.
+	u64 runCount;	// for profiling (JitOptions::enableProfiling.)
 	int blockNum;
 	int flags;
 
@@ -62,13 +63,7 @@ struct JitBlock
 	bool linkStatus[2];
 	bool ContainsAddress(u32 em_address);
 
-#ifdef _WIN32
-	// we don't really need to save start and stop
-	// TODO (mb2): ticStart and ticStop -> "local var" mean "in block" ... low priority ;)
-	u64 ticStart;		// for profiling - time.
-	u64 ticStop;		// for profiling - time.
-	u64 ticCounter;	// for profiling - time.
-#endif
+	u64 ticCounter;	// for profiling - host time stamp counter ticks spent in the block.
 
 #ifdef USE_VTUNE
 	char blockName[32];
@@ -83,8 +78,8 @@ class JitBlockCache
 	const u8 **blockCodePointers;
 	JitBlock *blocks;
 	int num_blocks;
-	std::multimap<u32, int> links_to;
-	std::map<std::pair<u32,u32>, u32> block_map; // (end_addr, start_addr) -> number
+	JitBlockIndex blockIndex;
+	std::vector<int> invalidated;
 
 	int MAX_NUM_BLOCKS;
 
@@ -123,6 +118,10 @@ public:
 	// This one is slow so should only be used for one-shots from the debugger UI, not for anything during runtime.
 	void GetBlockNumbersFromAddress(u32 em_address, std::vector<int> *block_numbers);
 
+	// Lists the blocks that took the most host time, with disassembly.
+	// Only has data if the blocks were compiled with JitOptions::enableProfiling.
+	void WriteProfileReport(FILE *file, int maxBlocks);
+
 	u32 GetOriginalFirstOp(int block_num);
 	CompiledCode GetCompiledCodeFromBlock(int block_num);
 
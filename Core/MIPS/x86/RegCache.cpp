@@ -254,6 +254,34 @@ void GPRRegCache::BindToRegister(int i, bool doLoad, bool makeDirty) {
 	}
 }
 
+void GPRRegCache::BindToFixedRegister(int i, X64Reg xr) {
+	if (regs[i].away && regs[i].location.IsSimpleReg() && RX(i) == xr) {
+		xregs[xr].dirty = true;
+		return;
+	}
+
+	FlushR(xr);
+	const OpArg oldLoc = regs[i].location;
+	if (regs[i].away && oldLoc.IsSimpleReg()) {
+		X64Reg oldxr = oldLoc.GetSimpleReg();
+		xregs[oldxr].free = true;
+		xregs[oldxr].dirty = false;
+		xregs[oldxr].mipsReg = -1;
+	}
+
+	// Force ZERO to be 0.
+	if (i == 0)
+		emit->MOV(32, ::Gen::R(xr), Imm32(0));
+	else
+		emit->MOV(32, ::Gen::R(xr), oldLoc);
+
+	xregs[xr].free = false;
+	xregs[xr].mipsReg = i;
+	xregs[xr].dirty = true;
+	regs[i].away = true;
+	regs[i].location = ::Gen::R(xr);
+}
+
 void GPRRegCache::StoreFromRegister(int i) {
 	if (regs[i].away) {
 		bool doStore;
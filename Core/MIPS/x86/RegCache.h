@@ -68,6 +68,9 @@ public:
 	void KillImmediate(int preg, bool doLoad, bool makeDirty);
 
 	void BindToRegister(int preg, bool doLoad = true, bool makeDirty = true);
+	// Puts preg in xr and marks it dirty, flushing whatever was there.  Only emits MOVs,
+	// so flags survive.  Used to give loop registers the same home on every iteration.
+	void BindToFixedRegister(int preg, X64Reg xr);
 	void StoreFromRegister(int preg);
 
 	const OpArg &R(int preg) const {return regs[preg].location;}
@@ -90,11 +93,12 @@ public:
 	bool IsImmediate(int preg) const;
 	u32 GetImmediate32(int preg) const;
 
+	const int *GetAllocationOrder(int &count);
+
 	MIPSState *mips;
 
 private:
 	X64Reg GetFreeXReg();
-	const int *GetAllocationOrder(int &count);
 
 	MIPSCachedReg regs[NUM_MIPS_GPRS];
 	X64CachedReg xregs[NUM_X_REGS];
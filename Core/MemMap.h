@@ -250,6 +250,24 @@ inline void Write_Float(float f, u32 address)
 void GetString(std::string& _string, const u32 _Address);
 u8* GetPointer(const u32 address);
 bool IsValidAddress(const u32 address);
+// True if every byte in [address, address + size) is mapped, within one contiguous block.
+bool IsValidRange(const u32 address, const u32 size);
+
+// Only for addresses already checked with IsValidAddress() or IsValidRange().
+// Those accept the same mirrors as GetPointer(), not all of which are mapped at base,
+// so this resolves them the same way (just without the logging.)
+inline u8 *GetPointerUnchecked(const u32 address) {
+#ifdef SAFE_MEMORY
+	return GetPointer(address);
+#else
+	if ((address & 0x0E000000) == 0x08000000)
+		return m_pRAM + (address & RAM_MASK);
+	else if ((address & 0x0F800000) == 0x04000000)
+		return m_pVRAM + (address & VRAM_MASK);
+	else
+		return m_pScratchPad + (address & SCRATCHPAD_MASK);
+#endif
+}
 
 inline const char* GetCharPointer(const u32 address) {
   return (const char *)GetPointer(address);
@@ -277,5 +295,64 @@ const char *GetAddressName(u32 address);
 
 };
 
+// A typed view of guest memory.  Check IsValid() once, then access the struct in place
+// instead of going through Read_U32/ReadStruct (which validate every access and copy.)
+// Has no constructor so it can be used in unions and passed around like the u32 it wraps.
+template <typename T>
+struct PSPPointer
+{
+	u32 ptr;
+
+	static PSPPointer<T> Create(u32 address)
+	{
+		PSPPointer<T> p;
+		p.ptr = address;
+		return p;
+	}
+
+	inline T &operator*() const
+	{
+		return *(T *)Memory::GetPointerUnchecked(ptr);
+	}
+
+	inline T &operator[](int i) const
+	{
+		return *((T *)Memory::GetPointerUnchecked(ptr) + i);
+	}
+
+	inline T *operator->() const
+	{
+		return (T *)Memory::GetPointerUnchecked(ptr);
+	}
+
+	inline PSPPointer<T> operator+(int i) const
+	{
+		return Create(ptr + i * sizeof(T));
+	}
+
+	inline PSPPointer<T> &operator+=(int i)
+	{
+		ptr += i * sizeof(T);
+		return *this;
+	}
+
+	inline PSPPointer<T> &operator=(u32 address)
+	{
+		ptr = address;
+		return *this;
+	}
+
+	inline operator u32() const
+	{
+		return ptr;
+	}
+
+	// Validates count consecutive Ts, for use as an array.
+	inline bool IsValid(u32 count = 1) const
+	{
+		return Memory::IsValidRange(ptr, (u32)sizeof(T) * count);
+	}
+};
+
 #endif
 
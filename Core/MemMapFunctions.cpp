@@ -151,6 +151,27 @@ bool IsValidAddress(const u32 address)
 		return false;
 }
 
+bool IsValidRange(const u32 address, const u32 size)
+{
+	if (!IsValidAddress(address))
+		return false;
+	if (size == 0)
+		return true;
+
+	const u32 last = address + size - 1;
+	if (last < address || !IsValidAddress(last))
+		return false;
+
+	// Both ends valid isn't enough, they also have to be in the same mirror (so that
+	// GetPointerUnchecked() gives one contiguous block for the whole range.)
+	if ((address & 0x0E000000) == 0x08000000)
+		return ((address ^ last) & ~RAM_MASK) == 0;
+	else if ((address & 0x0F800000) == 0x04000000)
+		return ((address ^ last) & ~VRAM_MASK) == 0;
+	else
+		return ((address ^ last) & ~SCRATCHPAD_MASK) == 0;
+}
+
 u32 Read_Opcode(u32 _Address)
 {
 	if (_Address == 0x00000000)
@@ -39,20 +39,6 @@
 #include "HLE/sceKernelMemory.h"
 #include "ELF/ParamSFO.h"
 
-BlockDevice *constructBlockDevice(const char *filename)
-{
-	// Check for CISO
-	FILE *f = fopen(filename, "rb");
-	char buffer[4];
-	auto size = fread(buffer, 1, 4, f); //size_t
-	fclose(f);
-	if (!memcmp(buffer, "CISO", 4) && size == 4)
-		return new CISOFileBlockDevice(filename);
-	else
-		return new FileBlockDevice(filename);
-}
-
-
 bool Load_PSP_ISO(const char *filename, std::string *error_string)
 {
 	ISOFileSystem *umd2 = new ISOFileSystem(&pspFileSystem, constructBlockDevice(filename));
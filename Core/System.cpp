@@ -40,12 +40,34 @@
 #include "Loaders.h"
 #include "ELF/ParamSFO.h"
 #include "../Common/LogManager.h"
+#include "../Common/FileUtil.h"
 
 MetaFileSystem pspFileSystem;
 ParamSFOData g_paramSFO;
 static CoreParameter coreParameter;
 static PSPMixer *mixer;
 
+static void PSP_LoadJitDiskCache()
+{
+#if !defined(ARM)
+	const std::string discID = g_paramSFO.GetValueString("DISC_ID");
+	if (discID.empty())
+	{
+		INFO_LOG(JIT, "No DISC_ID, not using the JIT disk cache");
+		return;
+	}
+
+	char temp[256];
+	sprintf(temp, "ms0:/PSP/PPSSPP_CACHE/%s_%s.jitcache", discID.c_str(), g_paramSFO.GetValueString("DISC_VERSION").c_str());
+	std::string hostPath;
+	if (!pspFileSystem.GetHostPath(std::string(temp), hostPath))
+		return;
+
+	File::CreateFullPath(hostPath.substr(0, hostPath.find_last_of("/\\") + 1));
+	MIPSComp::jit->LoadDiskCache(hostPath);
+#endif
+}
+
 bool PSP_Init(const CoreParameter &coreParam, std::string *error_string)
 {
 	INFO_LOG(HLE, "PPSSPP %s", PPSSPP_GIT_VERSION);
@@ -69,6 +91,7 @@ bool PSP_Init(const CoreParameter &coreParam, std::string *error_string)
 	}
 
 	CoreTiming::Init();
+	CoreTiming::SetEventBatchCycles(g_Config.iEventBatchCycles);
 
 	// Init all the HLE modules
 	HLEInit();
@@ -88,6 +111,9 @@ bool PSP_Init(const CoreParameter &coreParam, std::string *error_string)
 	}
 
 	// Setup JIT here.
+	if (MIPSComp::jit && g_Config.bJitDiskCache)
+		PSP_LoadJitDiskCache();
+
 	if (coreParameter.startPaused)
 		coreState = CORE_STEPPING;
 	else
@@ -174,7 +174,7 @@ void MenuScreen::render() {
 
 	if (UIButton(GEN_ID, vlinear, w, "Load...", ALIGN_RIGHT)) {
 #if defined(USING_QT_UI)
-		QString fileName = QFileDialog::getOpenFileName(NULL, "Load ROM", g_Config.currentDirectory.c_str(), "PSP ROMs (*.iso *.cso *.pbp *.elf)");
+		QString fileName = QFileDialog::getOpenFileName(NULL, "Load ROM", g_Config.currentDirectory.c_str(), "PSP ROMs (*.iso *.cso *.psz *.pbp *.elf)");
 		if (QFile::exists(fileName)) {
 			QDir newPath;
 			g_Config.currentDirectory = newPath.filePath(fileName).toStdString();
@@ -184,10 +184,11 @@ void MenuScreen::render() {
 #else
 		FileSelectScreenOptions options;
 		options.allowChooseDirectory = true;
-		options.filter = "iso:cso:pbp:elf:prx:";
+		options.filter = "iso:cso:psz:pbp:elf:prx:";
 		options.folderIcon = I_ICON_FOLDER;
 		options.iconMapping["iso"] = I_ICON_UMD;
 		options.iconMapping["cso"] = I_ICON_UMD;
+		options.iconMapping["psz"] = I_ICON_UMD;
 		options.iconMapping["pbp"] = I_ICON_EXE;
 		options.iconMapping["elf"] = I_ICON_EXE;
 		screenManager()->switchScreen(new FileSelectScreen(options));
@@ -3,12 +3,15 @@
 // To build on non-windows systems, just run CMake in the SDL directory, it will build both a normal ppsspp and the headless version.
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "Core/Config.h"
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
 #include "Core/System.h"
 #include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/JitCommon/JitCommon.h"
+#include "Core/HLE/HLE.h"
 #include "Core/Host.h"
 #include "Log.h"
 #include "LogManager.h"
@@ -71,20 +74,46 @@ void printUsage(const char *progname, const char *reason)
 
 	fprintf(stderr, "  -i                    use the interpreter\n");
 	fprintf(stderr, "  -j                    use jit (default)\n");
+	fprintf(stderr, "  --ir                  use the IR interpreter\n");
+	fprintf(stderr, "  --cached              use the cached interpreter\n");
+	fprintf(stderr, "  --jitprofile[=FILE]   write the slowest jit blocks to stderr or FILE at exit\n");
+	fprintf(stderr, "  --syscallprofile[=FILE]  write syscall counts and time histograms as CSV to stderr or FILE (JSON if FILE ends in .json)\n");
+	fprintf(stderr, "  --syscallprofile-every=N  also rewrite the syscall profile every N frames\n");
 	fprintf(stderr, "  -c, --compare         compare with output in file.expected\n");
 	fprintf(stderr, "\nSee headless.txt for details.\n");
 }
 
+void WriteSyscallProfile(const char *filename)
+{
+	FILE *profileFile = filename ? fopen(filename, "w") : stderr;
+	if (!profileFile)
+	{
+		fprintf(stderr, "Unable to write syscall profile to %s\n", filename);
+		return;
+	}
+
+	const size_t len = filename ? strlen(filename) : 0;
+	const bool json = len >= 5 && !strcmp(filename + len - 5, ".json");
+	WriteSyscallProfileReport(profileFile, json);
+	if (profileFile != stderr)
+		fclose(profileFile);
+}
+
 int main(int argc, const char* argv[])
 {
 	bool fullLog = false;
-	bool useJit = true;
+	CPUCore cpuCore = CPU_JIT;
 	bool autoCompare = false;
 	bool useGraphics = false;
 	
 	const char *bootFilename = 0;
 	const char *mountIso = 0;
 	const char *screenshotFilename = 0;
+	bool jitProfile = false;
+	const char *jitProfileFilename = 0;
+	bool syscallProfile = false;
+	const char *syscallProfileFilename = 0;
+	int syscallProfileFrames = 0;
 	bool readMount = false;
 
 	for (int i = 1; i < argc; i++)
@@ -100,15 +129,38 @@ int main(int argc, const char* argv[])
 		else if (!strcmp(argv[i], "-l") || !strcmp(argv[i], "--log"))
 			fullLog = true;
 		else if (!strcmp(argv[i], "-i"))
-			useJit = false;
+			cpuCore = CPU_INTERPRETER;
 		else if (!strcmp(argv[i], "-j"))
-			useJit = true;
+			cpuCore = CPU_JIT;
+		else if (!strcmp(argv[i], "--ir"))
+			cpuCore = CPU_IRINTERPRETER;
+		else if (!strcmp(argv[i], "--cached"))
+			cpuCore = CPU_CACHEDINTERPRETER;
 		else if (!strcmp(argv[i], "-c") || !strcmp(argv[i], "--compare"))
 			autoCompare = true;
 		else if (!strcmp(argv[i], "--graphics"))
 			useGraphics = true;
 		else if (!strncmp(argv[i], "--screenshot=", strlen("--screenshot=")) && strlen(argv[i]) > strlen("--screenshot="))
 			screenshotFilename = argv[i] + strlen("--screenshot=");
+		else if (!strcmp(argv[i], "--jitprofile"))
+			jitProfile = true;
+		else if (!strncmp(argv[i], "--jitprofile=", strlen("--jitprofile=")) && strlen(argv[i]) > strlen("--jitprofile="))
+		{
+			jitProfile = true;
+			jitProfileFilename = argv[i] + strlen("--jitprofile=");
+		}
+		else if (!strcmp(argv[i], "--syscallprofile"))
+			syscallProfile = true;
+		else if (!strncmp(argv[i], "--syscallprofile=", strlen("--syscallprofile=")) && strlen(argv[i]) > strlen("--syscallprofile="))
+		{
+			syscallProfile = true;
+			syscallProfileFilename = argv[i] + strlen("--syscallprofile=");
+		}
+		else if (!strncmp(argv[i], "--syscallprofile-every=", strlen("--syscallprofile-every=")) && strlen(argv[i]) > strlen("--syscallprofile-every="))
+		{
+			syscallProfile = true;
+			syscallProfileFrames = atoi(argv[i] + strlen("--syscallprofile-every="));
+		}
 		else if (bootFilename == 0)
 			bootFilename = argv[i];
 		else
@@ -156,7 +208,7 @@ int main(int argc, const char* argv[])
 	coreParameter.fileToStart = bootFilename;
 	coreParameter.mountIso = mountIso ? mountIso : "";
 	coreParameter.startPaused = false;
-	coreParameter.cpuCore = useJit ? CPU_JIT : CPU_INTERPRETER;
+	coreParameter.cpuCore = cpuCore;
 	coreParameter.gpuCore = headlessHost->isGLWorking() ? GPU_GLES : GPU_NULL;
 	coreParameter.enableSound = false;
 	coreParameter.headLess = true;
@@ -166,6 +218,8 @@ int main(int argc, const char* argv[])
 	g_Config.bEnableSound = false;
 	g_Config.bFirstRun = false;
 	g_Config.bIgnoreBadMemAccess = true;
+	g_Config.bJitProfile = jitProfile;
+	g_Config.bSyscallProfile = syscallProfile;
 
 #if defined(ANDROID)
 #elif defined(BLACKBERRY) || defined(__SYMBIAN32__)
@@ -187,6 +241,7 @@ int main(int argc, const char* argv[])
 	if (screenshotFilename != 0)
 		headlessHost->SetComparisonScreenshot(screenshotFilename);
 
+	int frames = 0;
 	coreState = CORE_RUNNING;
 	while (coreState == CORE_RUNNING)
 	{
@@ -200,7 +255,29 @@ int main(int argc, const char* argv[])
 			coreState = CORE_RUNNING;
 			headlessHost->SwapBuffers();
 		}
+
+		if (syscallProfileFrames > 0 && ++frames % syscallProfileFrames == 0)
+			WriteSyscallProfile(syscallProfileFilename);
+	}
+
+#if !defined(ARM)
+	if (jitProfile && MIPSComp::jit)
+	{
+		FILE *profileFile = jitProfileFilename ? fopen(jitProfileFilename, "w") : stderr;
+		if (profileFile)
+		{
+			MIPSComp::jit->GetBlockCache()->WriteProfileReport(profileFile, 50);
+			if (profileFile != stderr)
+				fclose(profileFile);
+		}
+		else
+			fprintf(stderr, "Unable to write jit profile to %s\n", jitProfileFilename);
 	}
+#endif
+
+	// Has to happen before shutdown, which unloads the module tables.
+	if (syscallProfile)
+		WriteSyscallProfile(syscallProfileFilename);
 
 	host->ShutdownGL();
 	PSP_Shutdown();
@@ -0,0 +1,284 @@
+// Converts ISO and CSO images to PSZ, and measures how fast images can be read back.
+// Built next to PPSSPPHeadless, run it without arguments for usage.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "base/timeutil.h"
+#include "Core/FileSystems/BlockDevices.h"
+
+extern "C"
+{
+#include "zlib.h"
+};
+
+#include "../ext/snappy/snappy-c.h"
+
+enum CodecChoice
+{
+	CHOICE_STORE,
+	CHOICE_DEFLATE,
+	CHOICE_SNAPPY,
+	CHOICE_AUTO,
+};
+
+void printUsage(const char *progname, const char *reason)
+{
+	if (reason != NULL)
+		fprintf(stderr, "Error: %s\n\n", reason);
+	fprintf(stderr, "PPSSPP image tool\n");
+	fprintf(stderr, "Usage:\n");
+	fprintf(stderr, "  %s input.iso|input.cso output.psz [options]\n", progname);
+	fprintf(stderr, "  %s --bench image [image ...]\n\n", progname);
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "  --block-size=KB\t\tblock size, 16 to 128, default 64\n");
+	fprintf(stderr, "  --codec=store|deflate|snappy|auto\tdefault auto: deflate only where it is clearly smaller\n");
+	fprintf(stderr, "  --bench-seconds=N\t\tminimum time to spend reading each image, default 2\n");
+}
+
+static bool DeflateBlock(z_stream *zstream, const u8 *in, u32 inSize, std::vector<u8> &out)
+{
+	deflateReset(zstream);
+	out.resize(deflateBound(zstream, inSize));
+	zstream->next_in = (Bytef *)in;
+	zstream->avail_in = inSize;
+	zstream->next_out = &out[0];
+	zstream->avail_out = (uInt)out.size();
+	if (deflate(zstream, Z_FINISH) != Z_STREAM_END)
+		return false;
+	out.resize(out.size() - zstream->avail_out);
+	return true;
+}
+
+static bool SnappyBlock(const u8 *in, u32 inSize, std::vector<u8> &out)
+{
+	size_t outSize = snappy_max_compressed_length(inSize);
+	out.resize(outSize);
+	if (snappy_compress((const char *)in, inSize, (char *)&out[0], &outSize) != SNAPPY_OK)
+		return false;
+	out.resize(outSize);
+	return true;
+}
+
+static bool WriteAll(FILE *f, const void *data, size_t size)
+{
+	return size == 0 || fwrite(data, 1, size, f) == size;
+}
+
+int Convert(const char *inFilename, const char *outFilename, u32 blockSize, CodecChoice choice)
+{
+	BlockDevice *input = constructBlockDevice(inFilename);
+	const u32 numSectors = input->GetNumBlocks();
+	if (numSectors == 0)
+	{
+		fprintf(stderr, "Unable to read %s\n", inFilename);
+		delete input;
+		return 1;
+	}
+
+	FILE *out = fopen(outFilename, "wb");
+	if (out == NULL)
+	{
+		fprintf(stderr, "Unable to create %s\n", outFilename);
+		delete input;
+		return 1;
+	}
+
+	PSZHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "PSZI", 4);
+	header.headerSize = sizeof(PSZHeader);
+	header.version = PSZ_VERSION;
+	header.blockSize = blockSize;
+	header.totalBytes = (u64)numSectors * 2048;
+	header.numBlocks = (u32)((header.totalBytes + blockSize - 1) / blockSize);
+
+	// The index is written again at the end, once the offsets are known.
+	std::vector<u64> index(header.numBlocks + 1, 0);
+	bool success = WriteAll(out, &header, sizeof(header)) && WriteAll(out, &index[0], index.size() * sizeof(u64));
+	u64 pos = sizeof(header) + index.size() * sizeof(u64);
+
+	z_stream zstream;
+	memset(&zstream, 0, sizeof(zstream));
+	if (deflateInit2(&zstream, 9, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		success = false;
+
+	const u32 sectorsPerBlock = blockSize / 2048;
+	std::vector<u8> raw(blockSize), deflated, snappied;
+	u32 codecCounts[3] = {0, 0, 0};
+	for (u32 block = 0; success && block < header.numBlocks; ++block)
+	{
+		u32 sectors = sectorsPerBlock;
+		if ((block + 1) * sectorsPerBlock > numSectors)
+			sectors = numSectors - block * sectorsPerBlock;
+		const u32 rawSize = sectors * 2048;
+		if (!input->ReadBlocks(block * sectorsPerBlock, sectors, &raw[0]))
+		{
+			fprintf(stderr, "Read error in block %d\n", block);
+			success = false;
+			break;
+		}
+
+		int codec = PSZ_CODEC_STORE;
+		const u8 *data = &raw[0];
+		u32 dataSize = rawSize;
+		if (choice == CHOICE_SNAPPY || choice == CHOICE_AUTO)
+		{
+			if (SnappyBlock(&raw[0], rawSize, snappied) && snappied.size() < dataSize)
+			{
+				codec = PSZ_CODEC_SNAPPY;
+				data = &snappied[0];
+				dataSize = (u32)snappied.size();
+			}
+		}
+		if (choice == CHOICE_DEFLATE || choice == CHOICE_AUTO)
+		{
+			// Deflate decodes several times slower, so in auto mode it has to save at least 1/8 over snappy.
+			const u32 limit = choice == CHOICE_AUTO ? dataSize - dataSize / 8 : dataSize;
+			if (DeflateBlock(&zstream, &raw[0], rawSize, deflated) && deflated.size() < limit)
+			{
+				codec = PSZ_CODEC_DEFLATE;
+				data = &deflated[0];
+				dataSize = (u32)deflated.size();
+			}
+		}
+
+		index[block] = pos | ((u64)codec << PSZ_CODEC_SHIFT);
+		codecCounts[codec]++;
+		success = WriteAll(out, data, dataSize);
+		pos += dataSize;
+
+		if ((block & 63) == 0 || block + 1 == header.numBlocks)
+		{
+			fprintf(stderr, "\r%d / %d blocks", block + 1, header.numBlocks);
+			fflush(stderr);
+		}
+	}
+	fprintf(stderr, "\n");
+	index[header.numBlocks] = pos;
+
+	if (success)
+	{
+		fseek(out, sizeof(header), SEEK_SET);
+		success = WriteAll(out, &index[0], index.size() * sizeof(u64));
+	}
+	if (fclose(out) != 0)
+		success = false;
+	deflateEnd(&zstream);
+	delete input;
+
+	if (!success)
+	{
+		fprintf(stderr, "Failed to write %s\n", outFilename);
+		remove(outFilename);
+		return 1;
+	}
+
+	printf("%s: %lld -> %lld bytes (%.1f%%), %d stored, %d deflate, %d snappy\n", outFilename,
+		(long long)header.totalBytes, (long long)pos, pos * 100.0 / header.totalBytes,
+		codecCounts[PSZ_CODEC_STORE], codecCounts[PSZ_CODEC_DEFLATE], codecCounts[PSZ_CODEC_SNAPPY]);
+	return 0;
+}
+
+int Bench(const char *filename, double minSeconds)
+{
+	BlockDevice *device = constructBlockDevice(filename);
+	const u32 numSectors = device->GetNumBlocks();
+	if (numSectors == 0)
+	{
+		fprintf(stderr, "Unable to read %s\n", filename);
+		delete device;
+		return 1;
+	}
+
+	// Reads like ISOFileSystem does for a big file, 32KB at a time.
+	const int runSectors = 16;
+	std::vector<u8> buffer(runSectors * 2048);
+	u64 bytes = 0;
+	int passes = 0;
+	bool success = true;
+	time_update();
+	const double startTime = time_now_d();
+	double elapsed = 0.0;
+	do
+	{
+		for (u32 sector = 0; sector < numSectors; sector += runSectors)
+		{
+			int count = runSectors;
+			if (sector + count > numSectors)
+				count = numSectors - sector;
+			success = device->ReadBlocks(sector, count, &buffer[0]) && success;
+			bytes += count * 2048;
+		}
+		++passes;
+		time_update();
+		elapsed = time_now_d() - startTime;
+	}
+	while (elapsed < minSeconds);
+	delete device;
+
+	printf("%s: %d passes, %.1f MB/s%s\n", filename, passes, bytes / elapsed / (1024.0 * 1024.0), success ? "" : " (read errors)");
+	return success ? 0 : 1;
+}
+
+int main(int argc, const char *argv[])
+{
+	bool bench = false;
+	double benchSeconds = 2.0;
+	u32 blockSize = 64 * 1024;
+	CodecChoice choice = CHOICE_AUTO;
+	std::vector<const char *> files;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--bench"))
+			bench = true;
+		else if (!strncmp(argv[i], "--bench-seconds=", strlen("--bench-seconds=")))
+			benchSeconds = atof(argv[i] + strlen("--bench-seconds="));
+		else if (!strncmp(argv[i], "--block-size=", strlen("--block-size=")))
+			blockSize = (u32)atoi(argv[i] + strlen("--block-size=")) * 1024;
+		else if (!strcmp(argv[i], "--codec=store"))
+			choice = CHOICE_STORE;
+		else if (!strcmp(argv[i], "--codec=deflate"))
+			choice = CHOICE_DEFLATE;
+		else if (!strcmp(argv[i], "--codec=snappy"))
+			choice = CHOICE_SNAPPY;
+		else if (!strcmp(argv[i], "--codec=auto"))
+			choice = CHOICE_AUTO;
+		else if (argv[i][0] == '-')
+		{
+			printUsage(argv[0], "Unknown option");
+			return 1;
+		}
+		else
+			files.push_back(argv[i]);
+	}
+
+	if (bench)
+	{
+		if (files.empty())
+		{
+			printUsage(argv[0], "No images to benchmark");
+			return 1;
+		}
+		int result = 0;
+		for (size_t i = 0; i < files.size(); ++i)
+			result |= Bench(files[i], benchSeconds);
+		return result;
+	}
+
+	if (files.size() != 2)
+	{
+		printUsage(argv[0], files.empty() ? NULL : "Need an input and an output image");
+		return 1;
+	}
+	if (blockSize < PSZ_MIN_BLOCK_SIZE || blockSize > PSZ_MAX_BLOCK_SIZE || (blockSize & (blockSize - 1)) != 0)
+	{
+		printUsage(argv[0], "Block size must be a power of 2 between 16 and 128 KB");
+		return 1;
+	}
+	return Convert(files[0], files[1], blockSize, choice);
+}
@@ -28,11 +28,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
+#include <vector>
 
 #include "Common/ArmEmitter.h"
+#include "Common/ChunkFile.h"
+#include "Common/StdThread.h"
+#include "Core/CoreTiming.h"
+#include "Core/HLE/sceKernel.h"
+#include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/IR/IRPasses.h"
+#include "Core/MIPS/JitCommon/JitBlockIndex.h"
 #include "ext/disarm.h"
 
 #define EXPECT_EQ_STR(a, b) if ((a) != (b)) { printf(__FUNCTION__ ": Test Fail\n%s\nvs\n%s\n", a.c_str(), b.c_str()); return false; }
+#define EXPECT_TRUE(a) if (!(a)) { printf("%s: Test Fail\n%s\n", __FUNCTION__, #a); return false; }
 
 bool TestArmEmitter() {
 	using namespace ArmGen;
@@ -51,8 +60,310 @@ bool TestArmEmitter() {
 	return true;
 }
 
+bool TestJitBlockIndex() {
+	const int NUM_BLOCKS = 65536;
+	const u32 BASE = 0x08804000;
+
+	// Blocks of 8 instructions, back to back, each exiting to the next one and to the start.
+	JitBlockIndex index;
+	index.Init(NUM_BLOCKS);
+	for (int i = 0; i < NUM_BLOCKS; ++i) {
+		index.AddBlock(i, BASE + i * 32, BASE + i * 32 + 32);
+		index.AddLink(BASE + i * 32 + 32, i, 0);
+		index.AddLink(BASE, i, 1);
+	}
+
+	std::vector<int> found;
+	index.GetBlocksInRange(BASE + 40, 64, found);
+	EXPECT_TRUE(found.size() == 3 && found[0] == 1 && found[1] == 2 && found[2] == 3);
+
+	int links = 0;
+	for (int l = index.FirstLinkTo(BASE); l != -1; l = index.NextLinkTo(l, BASE))
+		++links;
+	EXPECT_TRUE(links == NUM_BLOCKS);
+	int l = index.FirstLinkTo(BASE + 64);
+	EXPECT_TRUE(l != -1 && JitBlockIndex::LinkBlock(l) == 1 && JitBlockIndex::LinkExit(l) == 0);
+	EXPECT_TRUE(index.NextLinkTo(l, BASE + 64) == -1);
+
+	index.RemoveBlock(2);
+	found.clear();
+	index.GetBlocksInRange(BASE + 40, 64, found);
+	EXPECT_TRUE(found.size() == 2);
+
+	// A range running past the top of the address space mustn't wrap around to RAM.
+	found.clear();
+	index.GetBlocksInRange(0xFFFFF000, 0x08810000, found);
+	EXPECT_TRUE(found.empty());
+
+	printf("TestJitBlockIndex: Success\n");
+	return true;
+}
+
+static std::vector<u64> coreTimingFired;
+
+static void CoreTimingTestCallback(u64 userdata, int cyclesLate) {
+	coreTimingFired.push_back(userdata);
+}
+
+static void CoreTimingRunAll() {
+	for (int i = 0; i < 100000 && CoreTiming::IsScheduled(0); ++i) {
+		currentMIPS->downcount = 0;
+		CoreTiming::Advance();
+	}
+}
+
+bool TestCoreTiming() {
+	const int NUM_EVENTS = 10000;
+
+	currentMIPS = &mipsr4k;
+	CoreTiming::Init();
+	int type = CoreTiming::RegisterEvent("TestEvent", &CoreTimingTestCallback);
+	EXPECT_TRUE(type == 0);
+
+	// Distinct times in a scrambled order, then every odd one cancelled.
+	coreTimingFired.clear();
+	for (int i = 0; i < NUM_EVENTS; ++i)
+		CoreTiming::ScheduleEvent(1000 + ((i * 7919) % NUM_EVENTS) * 100, type, i);
+	for (int i = 1; i < NUM_EVENTS; i += 2)
+		EXPECT_TRUE(CoreTiming::UnscheduleEvent(type, i) != 0);
+	EXPECT_TRUE(CoreTiming::UnscheduleEvent(type, 1) == 0);
+
+	// Save and load, the queue has to come back the same.
+	u8 *ptr = 0;
+	PointerWrap measure(&ptr, PointerWrap::MODE_MEASURE);
+	CoreTiming::DoState(measure);
+	std::vector<u8> state((size_t)ptr);
+	ptr = &state[0];
+	PointerWrap save(&ptr, PointerWrap::MODE_WRITE);
+	CoreTiming::DoState(save);
+	CoreTiming::ClearPendingEvents();
+	ptr = &state[0];
+	PointerWrap load(&ptr, PointerWrap::MODE_READ);
+	CoreTiming::DoState(load);
+
+	CoreTimingRunAll();
+	EXPECT_TRUE(coreTimingFired.size() == NUM_EVENTS / 2);
+	for (size_t i = 1; i < coreTimingFired.size(); ++i) {
+		EXPECT_TRUE((coreTimingFired[i] & 1) == 0);
+		EXPECT_TRUE((coreTimingFired[i - 1] * 7919) % NUM_EVENTS < (coreTimingFired[i] * 7919) % NUM_EVENTS);
+	}
+
+	// Same time, they run in the order they were scheduled.
+	coreTimingFired.clear();
+	for (int i = 0; i < 3; ++i)
+		CoreTiming::ScheduleEvent(500, type, i);
+	CoreTimingRunAll();
+	EXPECT_TRUE(coreTimingFired.size() == 3 && coreTimingFired[0] == 0 && coreTimingFired[1] == 1 && coreTimingFired[2] == 2);
+
+	// With batching, events due close together run in one slice instead of one each.
+	coreTimingFired.clear();
+	CoreTiming::SetEventBatchCycles(1000);
+	for (int i = 0; i < 100; ++i)
+		CoreTiming::ScheduleEvent(5000 + i * 10, type, i);
+	u64 slicesBefore, eventsBefore, slicesAfter, eventsAfter;
+	CoreTiming::GetSliceStats(slicesBefore, eventsBefore);
+	CoreTimingRunAll();
+	CoreTiming::GetSliceStats(slicesAfter, eventsAfter);
+	CoreTiming::SetEventBatchCycles(0);
+	EXPECT_TRUE(coreTimingFired.size() == 100 && eventsAfter - eventsBefore == 100);
+	EXPECT_TRUE(slicesAfter - slicesBefore <= 2);
+
+	// Without batching, scheduling doesn't cut the slice, and an empty queue adds 10000 as before.
+	const int oldSliceLength = CoreTiming::slicelength;
+	currentMIPS->downcount = 0;
+	CoreTiming::Advance();
+	EXPECT_TRUE(currentMIPS->downcount == oldSliceLength + 10000 && CoreTiming::slicelength == oldSliceLength);
+	CoreTiming::ScheduleEvent(100, type, 0);
+	EXPECT_TRUE(currentMIPS->downcount == oldSliceLength + 10000);
+	CoreTimingRunAll();
+
+	// With batching, empty slices double until something is scheduled, which also cuts the slice.
+	CoreTiming::SetEventBatchCycles(1000);
+	CoreTiming::ScheduleEvent(100, type, 0);
+	CoreTimingRunAll();
+	const int emptySlice = currentMIPS->downcount;
+	currentMIPS->downcount = 0;
+	CoreTiming::Advance();
+	EXPECT_TRUE(currentMIPS->downcount == emptySlice * 2);
+	currentMIPS->downcount = 0;
+	CoreTiming::Advance();
+	EXPECT_TRUE(currentMIPS->downcount == emptySlice * 4);
+	CoreTiming::ScheduleEvent(100, type, 0);
+	EXPECT_TRUE(currentMIPS->downcount == 100);
+	CoreTimingRunAll();
+	EXPECT_TRUE(currentMIPS->downcount == emptySlice);
+	CoreTiming::SetEventBatchCycles(0);
+
+	// Everything cancelled before it's due, nothing is left behind.
+	for (int i = 0; i < NUM_EVENTS; ++i)
+		CoreTiming::ScheduleEvent((i * 7919) % NUM_EVENTS, type, i);
+	for (int i = 0; i < NUM_EVENTS; ++i)
+		CoreTiming::UnscheduleEvent(type, i);
+	EXPECT_TRUE(!CoreTiming::IsScheduled(type));
+
+	CoreTiming::Shutdown();
+
+	printf("TestCoreTiming: Success\n");
+	return true;
+}
+
+static const int TS_THREADS = 4;
+static const int TS_POSTS = 20000;
+
+static void CoreTimingPostEvents(int thread) {
+	for (int i = 0; i < TS_POSTS; ++i)
+		CoreTiming::ScheduleEvent_Threadsafe(0, 0, ((u64)thread << 32) | i);
+}
+
+bool TestCoreTimingThreadsafe() {
+	currentMIPS = &mipsr4k;
+	CoreTiming::Init();
+	int type = CoreTiming::RegisterEvent("TestThreadsafeEvent", &CoreTimingTestCallback);
+	EXPECT_TRUE(type == 0);
+
+	// Several threads post at once (more than the ring holds), while this one keeps draining.
+	coreTimingFired.clear();
+	std::vector<std::thread *> threads;
+	for (int t = 0; t < TS_THREADS; ++t)
+		threads.push_back(new std::thread(&CoreTimingPostEvents, t));
+	for (int i = 0; i < 100000000 && coreTimingFired.size() < TS_THREADS * TS_POSTS; ++i) {
+		currentMIPS->downcount = 0;
+		CoreTiming::Advance();
+	}
+	for (int t = 0; t < TS_THREADS; ++t) {
+		threads[t]->join();
+		delete threads[t];
+	}
+
+	EXPECT_TRUE(coreTimingFired.size() == TS_THREADS * TS_POSTS);
+	std::vector<int> seen(TS_THREADS * TS_POSTS, 0);
+	for (size_t i = 0; i < coreTimingFired.size(); ++i) {
+		const u64 thread = coreTimingFired[i] >> 32;
+		const u64 post = coreTimingFired[i] & 0xFFFFFFFF;
+		EXPECT_TRUE(thread < TS_THREADS && post < TS_POSTS);
+		seen[thread * TS_POSTS + post]++;
+	}
+	for (size_t i = 0; i < seen.size(); ++i)
+		EXPECT_TRUE(seen[i] == 1);
+
+	CoreTiming::Shutdown();
+
+	printf("TestCoreTimingThreadsafe: Success\n");
+	return true;
+}
+
+static void AddIR(MIPSComp::IRBlock &block, MIPSComp::IROp op, u8 dest, u8 src1, u8 src2, u32 constant) {
+	MIPSComp::IRInst inst = {(u8)op, dest, src1, src2, constant};
+	block.insts.push_back(inst);
+}
+
+static int CountIR(const MIPSComp::IRBlock &block, MIPSComp::IROp op) {
+	int count = 0;
+	for (size_t i = 0; i < block.insts.size(); ++i)
+		count += block.insts[i].op == op ? 1 : 0;
+	return count;
+}
+
+class PoolTestObject : public KernelObject {
+public:
+	static u32 GetMissingErrorCode() { return SCE_KERNEL_ERROR_UNKNOWN_SEMID; }
+	static int GetStaticIDType() { return SCE_KERNEL_TMID_Semaphore; }
+	int GetIDType() const { return SCE_KERNEL_TMID_Semaphore; }
+};
+
+class PoolOtherTestObject : public KernelObject {
+public:
+	static u32 GetMissingErrorCode() { return SCE_KERNEL_ERROR_UNKNOWN_MBXID; }
+	static int GetStaticIDType() { return SCE_KERNEL_TMID_Mbox; }
+	int GetIDType() const { return SCE_KERNEL_TMID_Mbox; }
+};
+
+bool TestKernelObjectPool() {
+	const int NUM_OBJECTS = 1000;
+	KernelObjectPool *pool = new KernelObjectPool();
+	std::vector<SceUID> ids;
+	u32 error;
+
+	// Handles come out lowest first, and freed ones get reused in the same order.
+	for (int i = 0; i < NUM_OBJECTS; ++i) {
+		if (i % 10 == 0)
+			ids.push_back(pool->Create(new PoolOtherTestObject()));
+		else
+			ids.push_back(pool->Create(new PoolTestObject()));
+		EXPECT_TRUE(i == 0 || ids[i] == ids[i - 1] + 1);
+	}
+	EXPECT_TRUE(pool->GetCount() == NUM_OBJECTS);
+	EXPECT_TRUE(pool->Destroy<PoolTestObject>(ids[5]) == 0);
+	EXPECT_TRUE(pool->Destroy<PoolTestObject>(ids[3]) == 0);
+	EXPECT_TRUE(pool->Create(new PoolTestObject()) == ids[3]);
+	EXPECT_TRUE(pool->Create(new PoolTestObject()) == ids[5]);
+
+	// Lookups check the type.
+	EXPECT_TRUE(pool->Get<PoolTestObject>(ids[1], error) != 0 && error == 0);
+	EXPECT_TRUE(pool->Get<PoolTestObject>(ids[10], error) == 0 && error == SCE_KERNEL_ERROR_UNKNOWN_SEMID);
+	EXPECT_TRUE(pool->Get<PoolOtherTestObject>(ids[10], error) != 0 && error == 0);
+	EXPECT_TRUE(pool->Get<PoolOtherTestObject>(0x7fffffff, error) == 0 && error == SCE_KERNEL_ERROR_UNKNOWN_MBXID);
+	EXPECT_TRUE(pool->Destroy<PoolOtherTestObject>(ids[1]) == SCE_KERNEL_ERROR_UNKNOWN_MBXID);
+
+	// Only the objects of that type get visited.
+	int numOther = 0;
+	for (SceUID id = pool->GetFirstOfType(SCE_KERNEL_TMID_Mbox); id != 0; id = pool->GetNextOfType(id)) {
+		EXPECT_TRUE(id == ids[numOther * 10]);
+		++numOther;
+	}
+	EXPECT_TRUE(numOther == NUM_OBJECTS / 10);
+	EXPECT_TRUE(pool->GetFirstOfType(SCE_KERNEL_TMID_Thread) == 0);
+
+	pool->Clear();
+	EXPECT_TRUE(pool->GetCount() == 0);
+	EXPECT_TRUE(pool->GetFirstOfType(SCE_KERNEL_TMID_Mbox) == 0);
+	delete pool;
+
+	printf("TestKernelObjectPool: Success\n");
+	return true;
+}
+
+bool TestIRPasses() {
+	using namespace MIPSComp;
+
+	// lui a0, 0x0880; addiu a0, a0, 0x100; sw a1, 0(a0); lw a2, 0(a0)
+	// mult a1, a2; mult a2, a2; mflo v0; beq a0, zero, somewhere; nop
+	IRBlock block;
+	AddIR(block, IROP_SETCONST, 4, 0, 0, 0x08800000);
+	AddIR(block, IROP_ADDCONST, 4, 4, 0, 0x100);
+	AddIR(block, IROP_STORE32, 0, 4, 5, 0);
+	AddIR(block, IROP_LOAD32, 6, 4, 0, 0);
+	AddIR(block, IROP_MULT, 0, 5, 6, 0);
+	AddIR(block, IROP_MULT, 0, 6, 6, 0);
+	AddIR(block, IROP_MOV, 2, IRREG_LO, 0, 0);
+	AddIR(block, IROP_MOV, IRREG_TEMP0, 4, 0, 0);
+	AddIR(block, IROP_EXITTOCONSTIFEQ, 0, IRREG_TEMP0, 0, 0x08804000);
+	AddIR(block, IROP_EXITTOCONST, 0, 0, 0, 0x08801000);
+
+	OptimizeIRBlock(&block);
+
+	// a0 is folded into one constant and the store address, the load becomes a move,
+	// the first mult is dead, and the branch is known not to be taken.
+	EXPECT_TRUE(CountIR(block, IROP_ADDCONST) == 0);
+	EXPECT_TRUE(block.insts[0].op == IROP_SETCONST && block.insts[0].dest == 4 && block.insts[0].constant == 0x08800100);
+	EXPECT_TRUE(block.insts[1].op == IROP_STORE32 && block.insts[1].src1 == IRREG_ZERO && block.insts[1].constant == 0x08800100);
+	EXPECT_TRUE(CountIR(block, IROP_LOAD32) == 0);
+	EXPECT_TRUE(CountIR(block, IROP_MULT) == 1);
+	EXPECT_TRUE(CountIR(block, IROP_EXITTOCONSTIFEQ) == 0);
+	EXPECT_TRUE(block.insts.back().op == IROP_EXITTOCONST && block.insts.back().constant == 0x08801000);
+	EXPECT_TRUE(block.insts.size() == 6);
+
+	printf("TestIRPasses: Success\n");
+	return true;
+}
+
 int main(int argc, const char *argv[])
 {
 	TestArmEmitter();
+	TestJitBlockIndex();
+	TestIRPasses();
+	TestCoreTiming();
+	TestCoreTimingThreadsafe();
+	TestKernelObjectPool();
 	return 0;
 }
\ No newline at end of file